@@ -0,0 +1,118 @@
+/**
+ * @file AdaptiveTimeouts.cpp
+ *
+ * This module contains the implementation of the AdaptiveTimeouts class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "AdaptiveTimeouts.hpp"
+
+#include <fstream>
+#include <sstream>
+
+void AdaptiveTimeouts::Configure(const Configuration& configuration) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    configuration_ = configuration;
+}
+
+void AdaptiveTimeouts::Record(
+    const std::string& destination,
+    Phase phase,
+    uint64_t microseconds
+) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    auto& histogram = histories_[destination].phases[static_cast< size_t >(phase)];
+    histogram.Record(microseconds);
+    if (histogram.GetCount() >= configuration_.decayThreshold) {
+        histogram.Decay();
+    }
+}
+
+std::chrono::milliseconds AdaptiveTimeouts::GetTimeout(
+    const std::string& destination,
+    Phase phase
+) const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    auto timeout = configuration_.initial;
+    const auto historiesEntry = histories_.find(destination);
+    if (historiesEntry != histories_.end()) {
+        const auto& histogram = historiesEntry->second.phases[static_cast< size_t >(phase)];
+        if (histogram.GetCount() >= configuration_.minimumSamples) {
+            timeout = std::chrono::milliseconds(
+                (std::chrono::milliseconds::rep)(
+                    (double)histogram.GetPercentile(configuration_.percentile)
+                    * configuration_.multiplier
+                    / 1000.0
+                )
+            );
+        }
+    }
+    if (timeout < configuration_.floor) {
+        timeout = configuration_.floor;
+    }
+    if (timeout > configuration_.ceiling) {
+        timeout = configuration_.ceiling;
+    }
+    return timeout;
+}
+
+bool AdaptiveTimeouts::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return true;
+    }
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    std::string line;
+    while (std::getline(file, line)) {
+        // Each line is: DESTINATION PHASE BUCKET:COUNT BUCKET:COUNT ...
+        std::istringstream fields(line);
+        std::string destination;
+        size_t phase;
+        if (
+            !(fields >> destination >> phase)
+            || (phase >= static_cast< size_t >(Phase::Count))
+        ) {
+            return false;
+        }
+        auto& histogram = histories_[destination].phases[phase];
+        size_t bucket;
+        char separator;
+        uint64_t count;
+        while (fields >> bucket >> separator >> count) {
+            if (
+                (separator != ':')
+                || (bucket >= LatencyHistogram::BUCKETS)
+            ) {
+                return false;
+            }
+            histogram.Record(LatencyHistogram::BucketUpperBound(bucket), count);
+        }
+    }
+    return true;
+}
+
+bool AdaptiveTimeouts::Save(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    for (const auto& historiesEntry: histories_) {
+        for (size_t phase = 0; phase < static_cast< size_t >(Phase::Count); ++phase) {
+            const auto& histogram = historiesEntry.second.phases[phase];
+            if (histogram.GetCount() == 0) {
+                continue;
+            }
+            file << historiesEntry.first << ' ' << phase;
+            for (size_t bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket) {
+                const auto count = histogram.GetBucketCount(bucket);
+                if (count > 0) {
+                    file << ' ' << bucket << ':' << count;
+                }
+            }
+            file << '\n';
+        }
+    }
+    return (bool)file;
+}
@@ -0,0 +1,174 @@
+#ifndef NEWMAN_ADAPTIVE_TIMEOUTS_HPP
+#define NEWMAN_ADAPTIVE_TIMEOUTS_HPP
+
+/**
+ * @file AdaptiveTimeouts.hpp
+ *
+ * This module declares the AdaptiveTimeouts class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+#include "LatencyHistogram.hpp"
+#include "Stats.hpp"
+
+/**
+ * This is used to choose how long to wait for each phase of an SMTP
+ * session with each SMTP server, based on how long that phase has
+ * taken with that server in the past.
+ *
+ * The timeout for a phase is a multiple of a high percentile of its
+ * past durations, limited by a floor and a ceiling.  Until enough
+ * durations have been measured, a default timeout is used.
+ */
+class AdaptiveTimeouts {
+    // Types
+public:
+    /**
+     * This holds the parameters used to compute timeouts.
+     */
+    struct Configuration {
+        /**
+         * This is the percentile of past durations on which
+         * timeouts are based.
+         */
+        double percentile = 99.0;
+
+        /**
+         * This is the factor by which the percentile
+         * is multiplied to get the timeout.
+         */
+        double multiplier = 3.0;
+
+        /**
+         * This is the shortest timeout which may be used.
+         */
+        std::chrono::milliseconds floor = std::chrono::milliseconds(500);
+
+        /**
+         * This is the longest timeout which may be used.
+         */
+        std::chrono::milliseconds ceiling = std::chrono::milliseconds(60000);
+
+        /**
+         * This is the timeout used until enough durations
+         * have been measured.
+         */
+        std::chrono::milliseconds initial = std::chrono::milliseconds(5000);
+
+        /**
+         * This is the number of durations which need to be measured
+         * before they're used to compute the timeout.
+         */
+        uint64_t minimumSamples = 20;
+
+        /**
+         * Once this many durations of a phase have been counted,
+         * the older ones are given half the weight of new ones.
+         */
+        uint64_t decayThreshold = 1000;
+    };
+
+    // Public methods
+public:
+    /**
+     * Set the parameters used to compute timeouts.
+     *
+     * @param[in] configuration
+     *     These are the parameters to use to compute timeouts.
+     */
+    void Configure(const Configuration& configuration);
+
+    /**
+     * Record how long a phase of an SMTP session took.
+     *
+     * @param[in] destination
+     *     This identifies the SMTP server.
+     *
+     * @param[in] phase
+     *     This identifies the phase of the SMTP session.
+     *
+     * @param[in] microseconds
+     *     This is the duration of the phase, in microseconds.
+     */
+    void Record(
+        const std::string& destination,
+        Phase phase,
+        uint64_t microseconds
+    );
+
+    /**
+     * Return how long to wait for a phase of an SMTP session to complete.
+     *
+     * @param[in] destination
+     *     This identifies the SMTP server.
+     *
+     * @param[in] phase
+     *     This identifies the phase of the SMTP session.
+     *
+     * @return
+     *     The timeout to use for the phase is returned.
+     */
+    std::chrono::milliseconds GetTimeout(
+        const std::string& destination,
+        Phase phase
+    ) const;
+
+    /**
+     * Load durations recorded by an earlier run from the given file.
+     *
+     * @param[in] path
+     *     This is the path to the file from which to load durations.
+     *
+     * @return
+     *     An indication of whether or not the durations were loaded
+     *     is returned.  A file which doesn't exist is not an error.
+     */
+    bool Load(const std::string& path);
+
+    /**
+     * Save all durations recorded to the given file.
+     *
+     * @param[in] path
+     *     This is the path to the file in which to save durations.
+     *
+     * @return
+     *     An indication of whether or not the durations were saved
+     *     is returned.
+     */
+    bool Save(const std::string& path) const;
+
+    // Private properties
+private:
+    /**
+     * This holds the durations measured for each phase of SMTP sessions
+     * with one SMTP server.
+     */
+    struct History {
+        LatencyHistogram phases[static_cast< size_t >(Phase::Count)];
+    };
+
+    /**
+     * These are the parameters used to compute timeouts.
+     */
+    Configuration configuration_;
+
+    /**
+     * These are the durations measured for each SMTP server,
+     * keyed by destination.
+     */
+    std::map< std::string, History > histories_;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex_;
+};
+
+#endif /* NEWMAN_ADAPTIVE_TIMEOUTS_HPP */
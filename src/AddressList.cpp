@@ -0,0 +1,298 @@
+/**
+ * @file AddressList.cpp
+ *
+ * This module contains the implementation of the functions used
+ * to extract e-mail addresses from address-list headers.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "AddressList.hpp"
+
+#include <stdint.h>
+#include <unordered_set>
+
+namespace {
+
+    /**
+     * This is the lookup table used to classify the characters of
+     * an address-list header value.
+     */
+    struct CharacterClasses {
+        /**
+         * This is set for characters which begin or end a structural
+         * element of an address list (quoted string, comment, angle-addr,
+         * group, or address separator).  Everything else can be skipped
+         * over in bulk.
+         */
+        bool special[256] = {};
+
+        /**
+         * This is set for white space characters, including the carriage
+         * returns and line feeds left behind by folding.
+         */
+        bool whiteSpace[256] = {};
+
+        CharacterClasses() {
+            for (const auto c: std::string("\"()<>,:;\\")) {
+                special[static_cast< unsigned char >(c)] = true;
+            }
+            for (const auto c: std::string(" \t\r\n")) {
+                whiteSpace[static_cast< unsigned char >(c)] = true;
+            }
+        }
+    };
+
+    const CharacterClasses& GetCharacterClasses() {
+        static const CharacterClasses classes;
+        return classes;
+    }
+
+    /**
+     * This is the state kept while scanning one element (mailbox)
+     * of an address list.
+     */
+    struct Element {
+        /**
+         * These delimit the non-white-space text of the element found
+         * outside of comments and angle brackets.
+         */
+        const char* tokenBegin = nullptr;
+        const char* tokenEnd = nullptr;
+
+        /**
+         * These delimit the text found inside angle brackets, if any.
+         */
+        const char* angleBegin = nullptr;
+        const char* angleEnd = nullptr;
+
+        void Extend(const char* begin, const char* end) {
+            if (tokenBegin == nullptr) {
+                tokenBegin = begin;
+            }
+            tokenEnd = end;
+        }
+
+        void Finish(std::vector< AddressView >& addresses) {
+            AddressView address;
+            if (angleBegin != nullptr) {
+                const auto& classes = GetCharacterClasses();
+                while (
+                    (angleBegin < angleEnd)
+                    && classes.whiteSpace[static_cast< unsigned char >(*angleBegin)]
+                ) {
+                    ++angleBegin;
+                }
+                while (
+                    (angleEnd > angleBegin)
+                    && classes.whiteSpace[static_cast< unsigned char >(angleEnd[-1])]
+                ) {
+                    --angleEnd;
+                }
+                address.begin = angleBegin;
+                address.length = (size_t)(angleEnd - angleBegin);
+            } else if (tokenBegin != nullptr) {
+                address.begin = tokenBegin;
+                address.length = (size_t)(tokenEnd - tokenBegin);
+            }
+            if (address.length > 0) {
+                addresses.push_back(address);
+            }
+            *this = Element();
+        }
+    };
+
+    /**
+     * Return a pointer just past the end of the quoted string or comment
+     * beginning at the given position.
+     *
+     * @param[in] p
+     *     This points to the opening quote or parenthesis.
+     *
+     * @param[in] end
+     *     This points just past the end of the header value.
+     *
+     * @return
+     *     A pointer just past the closing quote or parenthesis is returned.
+     *     If the header value ends first, the end of the header value
+     *     is returned.
+     */
+    const char* SkipQuotedStringOrComment(const char* p, const char* end) {
+        const bool comment = (*p == '(');
+        size_t depth = 1;
+        ++p;
+        while (p < end) {
+            const auto c = *p++;
+            if (c == '\\') {
+                if (p < end) {
+                    ++p;
+                }
+            } else if (comment && (c == '(')) {
+                ++depth;
+            } else if (
+                (comment && (c == ')'))
+                || (!comment && (c == '"'))
+            ) {
+                if (--depth == 0) {
+                    break;
+                }
+            }
+        }
+        return p;
+    }
+
+    /**
+     * Compute a hash of the given address without regard to case.
+     */
+    struct AddressViewHash {
+        size_t operator()(const AddressView& address) const {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < address.length; ++i) {
+                const auto c = address.begin[i];
+                const auto lower = ((c >= 'A') && (c <= 'Z')) ? (c - 'A' + 'a') : c;
+                hash = (
+                    hash
+                    ^ static_cast< uint32_t >(static_cast< unsigned char >(lower))
+                ) * 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    /**
+     * Compare the given addresses without regard to case.
+     */
+    struct AddressViewEqual {
+        bool operator()(const AddressView& lhs, const AddressView& rhs) const {
+            if (lhs.length != rhs.length) {
+                return false;
+            }
+            for (size_t i = 0; i < lhs.length; ++i) {
+                auto l = lhs.begin[i];
+                auto r = rhs.begin[i];
+                if ((l >= 'A') && (l <= 'Z')) {
+                    l = l - 'A' + 'a';
+                }
+                if ((r >= 'A') && (r <= 'Z')) {
+                    r = r - 'A' + 'a';
+                }
+                if (l != r) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+}
+
+void ParseAddressList(
+    const std::string& value,
+    std::vector< AddressView >& addresses
+) {
+    const auto& classes = GetCharacterClasses();
+    const char* p = value.data();
+    const char* const end = p + value.length();
+    Element element;
+    while (p < end) {
+        // Skip over ordinary text in bulk, noting where its non-white-space
+        // part begins and ends.
+        const char* runBegin = nullptr;
+        const char* runEnd = nullptr;
+        while (
+            (p < end)
+            && !classes.special[static_cast< unsigned char >(*p)]
+        ) {
+            if (!classes.whiteSpace[static_cast< unsigned char >(*p)]) {
+                if (runBegin == nullptr) {
+                    runBegin = p;
+                }
+                runEnd = p + 1;
+            }
+            ++p;
+        }
+        if (runBegin != nullptr) {
+            element.Extend(runBegin, runEnd);
+        }
+        if (p == end) {
+            break;
+        }
+        switch (*p) {
+            case '"': {
+                const auto quoteEnd = SkipQuotedStringOrComment(p, end);
+                element.Extend(p, quoteEnd);
+                p = quoteEnd;
+            } break;
+
+            case '(': {
+                p = SkipQuotedStringOrComment(p, end);
+            } break;
+
+            case '<': {
+                element.angleBegin = ++p;
+                while (
+                    (p < end)
+                    && (*p != '>')
+                ) {
+                    ++p;
+                }
+                element.angleEnd = p;
+                if (p < end) {
+                    ++p;
+                }
+            } break;
+
+            case ':': { // group display name ends; its mailboxes follow
+                element = Element();
+                ++p;
+            } break;
+
+            case ',':
+            case ';': {
+                element.Finish(addresses);
+                ++p;
+            } break;
+
+            default: {
+                ++p;
+            } break;
+        }
+    }
+    element.Finish(addresses);
+}
+
+Envelope BuildEnvelope(const WellKnownHeaderValues& wellKnownHeaders) {
+    Envelope envelope;
+    std::vector< AddressView > senders;
+    ParseAddressList(
+        wellKnownHeaders[
+            wellKnownHeaders.Has(WellKnownHeader::Sender)
+            ? WellKnownHeader::Sender
+            : WellKnownHeader::From
+        ],
+        senders
+    );
+    if (!senders.empty()) {
+        envelope.mailFrom = senders[0];
+    }
+    std::vector< AddressView > addresses;
+    for (const auto header: {
+        WellKnownHeader::To,
+        WellKnownHeader::Cc,
+        WellKnownHeader::Bcc,
+    }) {
+        ParseAddressList(wellKnownHeaders[header], addresses);
+    }
+    std::unordered_set< AddressView, AddressViewHash, AddressViewEqual > seen(
+        addresses.size() * 2
+    );
+    envelope.recipients.reserve(addresses.size());
+    for (const auto& address: addresses) {
+        if (seen.insert(address).second) {
+            envelope.recipients.push_back(address);
+        } else {
+            ++envelope.duplicatesRemoved;
+        }
+    }
+    return envelope;
+}
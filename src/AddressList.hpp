@@ -0,0 +1,106 @@
+#ifndef NEWMAN_ADDRESS_LIST_HPP
+#define NEWMAN_ADDRESS_LIST_HPP
+
+/**
+ * @file AddressList.hpp
+ *
+ * This module declares the functions used to extract e-mail addresses
+ * from address-list headers (To, Cc, Bcc, etc.), as described in
+ * RFC 5322 (https://tools.ietf.org/html/rfc5322#section-3.4).
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "WellKnownHeaders.hpp"
+
+/**
+ * This refers to an e-mail address within the text of a header,
+ * without copying it.  It's only valid while the header text
+ * it refers to is neither modified nor destroyed.
+ */
+struct AddressView {
+    /**
+     * This points to the first character of the address.
+     */
+    const char* begin = nullptr;
+
+    /**
+     * This is the number of characters in the address.
+     */
+    size_t length = 0;
+
+    /**
+     * Make a copy of the address.
+     *
+     * @return
+     *     A copy of the address is returned.
+     */
+    std::string ToString() const {
+        return std::string(begin, length);
+    }
+};
+
+/**
+ * This holds the addresses to use in the SMTP envelope of an e-mail,
+ * as views into the well-known header values of the e-mail.
+ */
+struct Envelope {
+    /**
+     * This is the address of the mailbox which sent the e-mail.
+     * It has zero length if the e-mail has no sender.
+     */
+    AddressView mailFrom;
+
+    /**
+     * These are the addresses of all recipients of the e-mail,
+     * with duplicates (compared without regard to case) removed,
+     * in the order they first appear.
+     */
+    std::vector< AddressView > recipients;
+
+    /**
+     * This is the number of duplicate recipient addresses
+     * which were removed.
+     */
+    size_t duplicatesRemoved = 0;
+};
+
+/**
+ * Extract the addresses of all the mailboxes in the given address-list
+ * header value.  Display names, comments, group names, and folding white
+ * space are skipped, and the value is scanned only once.
+ *
+ * @param[in] value
+ *     This is the address-list header value to parse.
+ *
+ * @param[in,out] addresses
+ *     This is where to append views of the extracted addresses.
+ */
+void ParseAddressList(
+    const std::string& value,
+    std::vector< AddressView >& addresses
+);
+
+/**
+ * Build the SMTP envelope of an e-mail from its well-known headers.
+ * The recipients are taken from the To, Cc, and Bcc headers, and the
+ * sender from the Sender header, or the From header if there is
+ * no Sender header.
+ *
+ * @note
+ *     The returned envelope refers to the text of the given header values,
+ *     so they must outlive it and not be modified while it's in use.
+ *
+ * @param[in] wellKnownHeaders
+ *     These are the well-known headers of the e-mail.
+ *
+ * @return
+ *     The envelope of the e-mail is returned.
+ */
+Envelope BuildEnvelope(const WellKnownHeaderValues& wellKnownHeaders);
+
+#endif /* NEWMAN_ADDRESS_LIST_HPP */
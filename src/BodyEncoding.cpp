@@ -0,0 +1,392 @@
+/**
+ * @file BodyEncoding.cpp
+ *
+ * This module contains the implementation of the functions used
+ * to prepare the bodies of e-mails for sending.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "BodyEncoding.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <Hash/Sha2.hpp>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the size of a SHA-256 digest, in bytes.
+     */
+    constexpr size_t DIGEST_SIZE = 32;
+
+    /**
+     * This is a group of tasks handed to the worker threads.
+     */
+    struct Job {
+        /**
+         * This is the number of tasks in the group.
+         */
+        size_t numTasks = 0;
+
+        /**
+         * This is the function to call to perform the task at
+         * the position given to it.
+         */
+        const std::function< void(size_t task) >* task = nullptr;
+
+        /**
+         * This is the position of the next task to start.
+         */
+        size_t nextTask = 0;
+
+        /**
+         * This is the number of tasks finished.
+         */
+        size_t tasksDone = 0;
+    };
+
+    /**
+     * This holds threads, one fewer than the processor has cores,
+     * which are started the first time they're needed and kept
+     * for the rest of the program, to help perform jobs.
+     */
+    class WorkerPool {
+        // Lifecycle management
+    public:
+        ~WorkerPool() noexcept {
+            {
+                std::lock_guard< decltype(mutex_) > lock(mutex_);
+                stop_ = true;
+                wakeCondition_.notify_all();
+            }
+            for (auto& worker: workers_) {
+                worker.join();
+            }
+        }
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool(WorkerPool&&) noexcept = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+        WorkerPool& operator=(WorkerPool&&) noexcept = delete;
+
+        // Public methods
+    public:
+        WorkerPool() {
+            const auto numCores = (size_t)std::thread::hardware_concurrency();
+            for (size_t i = 1; i < numCores; ++i) {
+                workers_.emplace_back([this]{ Work(); });
+            }
+        }
+
+        /**
+         * Return whether or not there are any threads to help
+         * perform jobs.
+         */
+        bool HasWorkers() const {
+            return !workers_.empty();
+        }
+
+        /**
+         * Perform the given job, with the help of any workers not busy
+         * with other jobs, and return once all its tasks are done.
+         * Tasks are started in order.
+         */
+        void Perform(Job& job) {
+            std::unique_lock< decltype(mutex_) > lock(mutex_);
+            jobs_.push_back(&job);
+            wakeCondition_.notify_all();
+            while (job.nextTask < job.numTasks) {
+                PerformNextTask(job, lock);
+            }
+            const auto queued = std::find(jobs_.begin(), jobs_.end(), &job);
+            if (queued != jobs_.end()) {
+                (void)jobs_.erase(queued);
+            }
+            jobDoneCondition_.wait(
+                lock,
+                [&job]{ return job.tasksDone == job.numTasks; }
+            );
+        }
+
+        // Private methods
+    private:
+        /**
+         * Start the next task of the given job, perform it without
+         * holding the given lock, and count it as done.
+         */
+        void PerformNextTask(
+            Job& job,
+            std::unique_lock< std::mutex >& lock
+        ) {
+            const auto task = job.nextTask++;
+            lock.unlock();
+            (*job.task)(task);
+            lock.lock();
+            if (++job.tasksDone == job.numTasks) {
+                jobDoneCondition_.notify_all();
+            }
+        }
+
+        /**
+         * Help perform queued jobs until the pool is destroyed.
+         */
+        void Work() {
+            std::unique_lock< decltype(mutex_) > lock(mutex_);
+            for (;;) {
+                wakeCondition_.wait(
+                    lock,
+                    [this]{ return stop_ || !jobs_.empty(); }
+                );
+                if (stop_) {
+                    return;
+                }
+                const auto job = jobs_.front();
+                if (job->nextTask >= job->numTasks) {
+                    jobs_.pop_front();
+                    continue;
+                }
+                PerformNextTask(*job, lock);
+            }
+        }
+
+        // Private properties
+    private:
+        /**
+         * This is used to synchronize access to the pool and its jobs.
+         */
+        std::mutex mutex_;
+
+        /**
+         * This is used to wake up workers when there are jobs
+         * or the pool is being destroyed.
+         */
+        std::condition_variable wakeCondition_;
+
+        /**
+         * This is used to wake up threads waiting for their jobs
+         * to be done.
+         */
+        std::condition_variable jobDoneCondition_;
+
+        /**
+         * These are the jobs which may have tasks not yet started.
+         */
+        std::deque< Job* > jobs_;
+
+        /**
+         * This indicates whether or not the pool is being destroyed.
+         */
+        bool stop_ = false;
+
+        /**
+         * These are the threads which help perform jobs.
+         */
+        std::vector< std::thread > workers_;
+    };
+
+    /**
+     * Perform the given number of tasks, with the help of the worker
+     * threads kept for the purpose, and return once they're all done.
+     * Tasks are started in order.  A single task, or any tasks on a
+     * processor with a single core, are performed on the calling
+     * thread alone.
+     *
+     * @param[in] numTasks
+     *     This is the number of tasks to perform.
+     *
+     * @param[in] task
+     *     This is the function to call to perform the task at
+     *     the position given to it.
+     */
+    void PerformTasks(
+        size_t numTasks,
+        const std::function< void(size_t task) >& task
+    ) {
+        static WorkerPool workerPool;
+        if (
+            (numTasks <= 1)
+            || !workerPool.HasWorkers()
+        ) {
+            for (size_t i = 0; i < numTasks; ++i) {
+                task(i);
+            }
+            return;
+        }
+        Job job;
+        job.numTasks = numTasks;
+        job.task = &task;
+        workerPool.Perform(job);
+    }
+
+    /**
+     * Return the number of chunks into which a body of the given size
+     * is broken.  Even an empty body has one (empty) chunk.
+     */
+    size_t CountChunks(size_t size) {
+        return std::max(
+            (size + BODY_CHUNK_SIZE - 1) / BODY_CHUNK_SIZE,
+            (size_t)1
+        );
+    }
+
+    /**
+     * Store the SHA-256 digest of the given chunk of the given body
+     * in its place among the given digests of the chunks.
+     */
+    void DigestChunk(
+        const std::string& body,
+        size_t chunk,
+        std::vector< uint8_t >& chunkDigests
+    ) {
+        const auto begin = body.begin() + std::min(chunk * BODY_CHUNK_SIZE, body.length());
+        const auto end = body.begin() + std::min((chunk + 1) * BODY_CHUNK_SIZE, body.length());
+        const auto digest = Hash::Sha256(std::vector< uint8_t >(begin, end));
+        (void)memcpy(chunkDigests.data() + chunk * DIGEST_SIZE, digest.data(), DIGEST_SIZE);
+    }
+
+    /**
+     * Return the digest of a body made from the given digests
+     * of its chunks.
+     */
+    std::string CombineChunkDigests(const std::vector< uint8_t >& chunkDigests) {
+        const auto digest = Hash::Sha256(chunkDigests);
+        return std::string(digest.begin(), digest.end());
+    }
+
+}
+
+std::string DigestBody(const std::string& body) {
+    const auto numChunks = CountChunks(body.length());
+    std::vector< uint8_t > chunkDigests(numChunks * DIGEST_SIZE);
+    PerformTasks(
+        numChunks,
+        [&](size_t chunk){
+            DigestChunk(body, chunk, chunkDigests);
+        }
+    );
+    return CombineChunkDigests(chunkDigests);
+}
+
+std::string EncodeBody(
+    const std::string& text,
+    std::string& digest
+) {
+    // A carriage return goes before each line feed, so count the line
+    // feeds of each chunk of the text to find where each chunk goes
+    // in the body.  Like every line, the last line of the body ends
+    // with a carriage return and line feed, even if the last line
+    // of the text doesn't end with a line feed.
+    const auto numTextChunks = CountChunks(text.length());
+    std::vector< size_t > offsets(numTextChunks + 1);
+    PerformTasks(
+        numTextChunks,
+        [&](size_t chunk){
+            const auto begin = text.begin() + std::min(chunk * BODY_CHUNK_SIZE, text.length());
+            const auto end = text.begin() + std::min((chunk + 1) * BODY_CHUNK_SIZE, text.length());
+            offsets[chunk + 1] = (end - begin) + std::count(begin, end, '\n');
+        }
+    );
+    for (size_t chunk = 0; chunk < numTextChunks; ++chunk) {
+        offsets[chunk + 1] += offsets[chunk];
+    }
+    const auto addLastLineEnding = (
+        !text.empty()
+        && (text.back() != '\n')
+    );
+    std::string body(offsets[numTextChunks] + (addLastLineEnding ? 2 : 0), '\0');
+
+    // Convert every chunk of the text first, and then hash every chunk
+    // of the body.  Since tasks start in order, a chunk of the body is
+    // only waited on once the chunks of text making it up have started
+    // converting, so it's hashed as soon as they're done, while any
+    // later chunks are still converting.
+    const auto numBodyChunks = CountChunks(body.length());
+    std::vector< uint8_t > chunkDigests(numBodyChunks * DIGEST_SIZE);
+    std::vector< bool > converted(numTextChunks, false);
+    std::mutex mutex;
+    std::condition_variable convertedChanged;
+    const std::function< void(size_t task) > convertOrHash = [&](size_t task){
+        if (task < numTextChunks) {
+            const auto chunk = task;
+            const auto begin = text.data() + std::min(chunk * BODY_CHUNK_SIZE, text.length());
+            const auto end = text.data() + std::min((chunk + 1) * BODY_CHUNK_SIZE, text.length());
+            auto output = &body[offsets[chunk]];
+            for (auto input = begin; input < end;) {
+                auto lineEnd = (const char*)memchr(input, '\n', end - input);
+                if (lineEnd == nullptr) {
+                    lineEnd = end;
+                }
+                (void)memcpy(output, input, lineEnd - input);
+                output += lineEnd - input;
+                input = lineEnd;
+                if (input < end) {
+                    *output++ = '\r';
+                    *output++ = '\n';
+                    ++input;
+                }
+            }
+            if (
+                (chunk + 1 == numTextChunks)
+                && addLastLineEnding
+            ) {
+                *output++ = '\r';
+                *output++ = '\n';
+            }
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            converted[chunk] = true;
+            convertedChanged.notify_all();
+        } else {
+            const auto chunk = task - numTextChunks;
+            const auto bodyEnd = std::min((chunk + 1) * BODY_CHUNK_SIZE, body.length());
+            const auto firstTextChunk = (
+                std::upper_bound(
+                    offsets.begin(),
+                    offsets.end() - 1,
+                    chunk * BODY_CHUNK_SIZE
+                ) - offsets.begin() - 1
+            );
+            const auto lastTextChunk = (
+                std::lower_bound(
+                    offsets.begin(),
+                    offsets.end() - 1,
+                    bodyEnd
+                ) - offsets.begin() - 1
+            );
+            {
+                std::unique_lock< decltype(mutex) > lock(mutex);
+                convertedChanged.wait(
+                    lock,
+                    [&]{
+                        for (auto i = firstTextChunk; i <= lastTextChunk; ++i) {
+                            if ((i >= 0) && !converted[i]) {
+                                return false;
+                            }
+                        }
+                        return true;
+                    }
+                );
+            }
+            DigestChunk(body, chunk, chunkDigests);
+        }
+    };
+    if (
+        (numTextChunks == 1)
+        && (numBodyChunks == 1)
+    ) {
+        // There's nothing to do at the same time, so don't bother
+        // handing anything to other threads.
+        convertOrHash(0);
+        convertOrHash(1);
+    } else {
+        PerformTasks(numTextChunks + numBodyChunks, convertOrHash);
+    }
+    digest = CombineChunkDigests(chunkDigests);
+    return body;
+}
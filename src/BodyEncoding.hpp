@@ -0,0 +1,63 @@
+#ifndef NEWMAN_BODY_ENCODING_HPP
+#define NEWMAN_BODY_ENCODING_HPP
+
+/**
+ * @file BodyEncoding.hpp
+ *
+ * This module declares functions used to prepare the bodies of e-mails
+ * for sending.  Large bodies are broken into chunks which are worked on
+ * by all the processor's cores at once, so that the time taken to get
+ * a large body ready shrinks with the number of cores.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <stddef.h>
+#include <string>
+
+/**
+ * This is the size, in bytes, of the chunks into which bodies are
+ * broken to be worked on at the same time.
+ */
+constexpr size_t BODY_CHUNK_SIZE = 1048576;
+
+/**
+ * Compute the digest used to tell the given body apart from others.
+ *
+ * This is the SHA-256 digest of the SHA-256 digests of the chunks of
+ * the body, each chunk but the last being BODY_CHUNK_SIZE bytes long,
+ * so that the chunks can be hashed at the same time.
+ *
+ * @param[in] body
+ *     This is the body to digest.
+ *
+ * @return
+ *     The digest of the body is returned.
+ */
+std::string DigestBody(const std::string& body);
+
+/**
+ * Make the body to send from the given text read from the file
+ * of an e-mail, ending each line with a carriage return and line feed,
+ * and compute the digest of the body (as DigestBody does) along the way.
+ *
+ * The text is converted a chunk at a time, with chunks converted at
+ * the same time, and each chunk of the body is hashed as soon as
+ * it's ready, while later chunks are still being converted.
+ *
+ * @param[in] text
+ *     This is the text read from the file, in which each line ends
+ *     with a line feed (the last line may not).
+ *
+ * @param[out] digest
+ *     This is where to store the digest of the body.
+ *
+ * @return
+ *     The body to send is returned.
+ */
+std::string EncodeBody(
+    const std::string& text,
+    std::string& digest
+);
+
+#endif /* NEWMAN_BODY_ENCODING_HPP */
@@ -0,0 +1,70 @@
+/**
+ * @file BodyStore.cpp
+ *
+ * This module contains the implementation of the BodyStore class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "BodyEncoding.hpp"
+#include "BodyStore.hpp"
+
+#include <algorithm>
+
+constexpr size_t BodyStore::MIN_SWEEP_THRESHOLD;
+
+auto BodyStore::Intern(std::string&& body) -> Body {
+    const auto digest = DigestBody(body);
+    return Intern(std::move(body), digest);
+}
+
+auto BodyStore::Intern(
+    std::string&& body,
+    const std::string& digest
+) -> Body {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    auto& entry = bodies_[digest];
+    auto stored = entry.lock();
+    ++internCount_;
+    if (stored != nullptr) {
+        bytesSaved_ += body.length();
+        return stored;
+    }
+    stored = std::make_shared< const std::string >(std::move(body));
+    entry = stored;
+
+    // Forget bodies no longer in use whenever the number of entries
+    // doubles, so that the cost of doing so is spread thinly.
+    if (bodies_.size() >= sweepThreshold_) {
+        for (auto it = bodies_.begin(); it != bodies_.end();) {
+            if (it->second.expired()) {
+                it = bodies_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        sweepThreshold_ = std::max(MIN_SWEEP_THRESHOLD, 2 * bodies_.size());
+    }
+    return stored;
+}
+
+size_t BodyStore::GetUniqueCount() const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    size_t count = 0;
+    for (const auto& entry: bodies_) {
+        if (!entry.second.expired()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+uint64_t BodyStore::GetInternCount() const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    return internCount_;
+}
+
+uint64_t BodyStore::GetBytesSaved() const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    return bytesSaved_;
+}
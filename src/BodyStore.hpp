@@ -0,0 +1,135 @@
+#ifndef NEWMAN_BODY_STORE_HPP
+#define NEWMAN_BODY_STORE_HPP
+
+/**
+ * @file BodyStore.hpp
+ *
+ * This module declares the BodyStore class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+/**
+ * This holds the bodies of e-mails, addressed by a hash of their
+ * content, so that e-mails whose bodies are identical (for example,
+ * the e-mails of a campaign, which differ only in their headers)
+ * share one copy of the body.
+ *
+ * Bodies are reference-counted: each e-mail holds a shared pointer to
+ * its body, and the store only holds weak pointers, so a body is freed
+ * as soon as the last e-mail using it is done with it.
+ */
+class BodyStore {
+    // Types
+public:
+    /**
+     * This is the type used to refer to a body held by the store.
+     */
+    using Body = std::shared_ptr< const std::string >;
+
+    // Constants
+public:
+    /**
+     * This is the number of entries the store may have before
+     * it first forgets bodies no longer in use.
+     */
+    static constexpr size_t MIN_SWEEP_THRESHOLD = 1024;
+
+    // Public methods
+public:
+    /**
+     * Return the stored body identical to the given one,
+     * storing the given body if there isn't one.
+     *
+     * @param[in] body
+     *     This is the body to store.
+     *
+     * @return
+     *     A reference to the stored body is returned.
+     */
+    Body Intern(std::string&& body);
+
+    /**
+     * Return the stored body identical to the given one,
+     * storing the given body if there isn't one.
+     *
+     * @param[in] body
+     *     This is the body to store.
+     *
+     * @param[in] digest
+     *     This is the digest of the body, as computed by DigestBody.
+     *
+     * @return
+     *     A reference to the stored body is returned.
+     */
+    Body Intern(
+        std::string&& body,
+        const std::string& digest
+    );
+
+    /**
+     * Return the number of distinct bodies held by the store
+     * which are still in use.
+     *
+     * @return
+     *     The number of distinct bodies in use is returned.
+     */
+    size_t GetUniqueCount() const;
+
+    /**
+     * Return the number of bodies given to the store,
+     * whether or not they were identical to one already stored.
+     *
+     * @return
+     *     The number of bodies given to the store is returned.
+     */
+    uint64_t GetInternCount() const;
+
+    /**
+     * Return the number of bytes not stored because a body
+     * was identical to one already stored.
+     *
+     * @return
+     *     The number of bytes saved by sharing bodies is returned.
+     */
+    uint64_t GetBytesSaved() const;
+
+    // Private properties
+private:
+    /**
+     * These are the bodies held by the store, keyed by
+     * the digest of their content.
+     */
+    std::unordered_map< std::string, std::weak_ptr< const std::string > > bodies_;
+
+    /**
+     * This is the number of bytes not stored because a body
+     * was identical to one already stored.
+     */
+    uint64_t bytesSaved_ = 0;
+
+    /**
+     * This is the number of bodies given to the store.
+     */
+    uint64_t internCount_ = 0;
+
+    /**
+     * This is the number of entries at which the store next
+     * forgets bodies no longer in use.
+     */
+    size_t sweepThreshold_ = MIN_SWEEP_THRESHOLD;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex_;
+};
+
+#endif /* NEWMAN_BODY_STORE_HPP */
@@ -0,0 +1,69 @@
+/**
+ * @file BufferPool.cpp
+ *
+ * This module contains the implementation of the BufferPool class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "BufferPool.hpp"
+
+#include <algorithm>
+
+constexpr size_t BufferPool::DEFAULT_BUFFER_SIZE;
+constexpr size_t BufferPool::DEFAULT_MAX_FREE;
+
+std::string BufferPool::Stats::ToString() const {
+    return (
+        std::to_string(inUse) + " in use (peak " + std::to_string(peakInUse)
+        + "), " + std::to_string(free) + " free, "
+        + std::to_string((inUse + free) * bufferSize) + " bytes held, "
+        + std::to_string(allocations) + " allocated for "
+        + std::to_string(acquisitions) + " uses"
+    );
+}
+
+void BufferPool::Configure(
+    size_t bufferSize,
+    size_t maxFree
+) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    bufferSize_ = bufferSize;
+    maxFree_ = maxFree;
+    free_.clear();
+}
+
+std::vector< uint8_t > BufferPool::Acquire() {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    ++stats_.acquisitions;
+    ++stats_.inUse;
+    stats_.peakInUse = std::max(stats_.peakInUse, stats_.inUse);
+    if (free_.empty()) {
+        ++stats_.allocations;
+        return std::vector< uint8_t >(bufferSize_);
+    }
+    auto buffer = std::move(free_.back());
+    free_.pop_back();
+    return buffer;
+}
+
+void BufferPool::Release(std::vector< uint8_t >&& buffer) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    if (stats_.inUse > 0) {
+        --stats_.inUse;
+    }
+    if (
+        (buffer.size() == bufferSize_)
+        && (free_.size() < maxFree_)
+    ) {
+        free_.push_back(std::move(buffer));
+    }
+}
+
+auto BufferPool::GetStats() const -> Stats {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    auto stats = stats_;
+    stats.bufferSize = bufferSize_;
+    stats.free = free_.size();
+    return stats;
+}
@@ -0,0 +1,160 @@
+#ifndef NEWMAN_BUFFER_POOL_HPP
+#define NEWMAN_BUFFER_POOL_HPP
+
+/**
+ * @file BufferPool.hpp
+ *
+ * This module declares the BufferPool class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * This is a pool of same-sized buffers shared by many connections,
+ * so that a connection only holds a buffer while it's actually moving
+ * data, rather than for as long as it's open.  With many idle sessions,
+ * this keeps the memory used for buffers in proportion to the number
+ * of busy sessions rather than the number of open ones.
+ *
+ * Buffers given back are kept for reuse, up to a limit, beyond which
+ * they're freed.
+ */
+class BufferPool {
+    // Types
+public:
+    /**
+     * This holds statistics about how the pool has been used.
+     */
+    struct Stats {
+        /**
+         * This is the size of each buffer, in bytes.
+         */
+        size_t bufferSize = 0;
+
+        /**
+         * This is the number of buffers currently taken from the pool.
+         */
+        size_t inUse = 0;
+
+        /**
+         * This is the largest number of buffers taken from the pool
+         * at the same time.
+         */
+        size_t peakInUse = 0;
+
+        /**
+         * This is the number of buffers kept for reuse.
+         */
+        size_t free = 0;
+
+        /**
+         * This is the number of times a buffer was taken from the pool.
+         */
+        uint64_t acquisitions = 0;
+
+        /**
+         * This is the number of times a new buffer had to be allocated
+         * because none was available for reuse.
+         */
+        uint64_t allocations = 0;
+
+        /**
+         * Render the statistics in a human-readable form.
+         *
+         * @return
+         *     The statistics in human-readable form are returned.
+         */
+        std::string ToString() const;
+    };
+
+    // Constants
+public:
+    /**
+     * This is the default size of each buffer, in bytes.
+     */
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 65536;
+
+    /**
+     * This is the default number of buffers kept for reuse.
+     */
+    static constexpr size_t DEFAULT_MAX_FREE = 8;
+
+    // Public methods
+public:
+    /**
+     * Set the size of the buffers and how many to keep for reuse.
+     * Buffers of another size given back afterwards are freed.
+     *
+     * @param[in] bufferSize
+     *     This is the size of each buffer, in bytes.
+     *
+     * @param[in] maxFree
+     *     This is the maximum number of buffers to keep for reuse.
+     */
+    void Configure(
+        size_t bufferSize,
+        size_t maxFree
+    );
+
+    /**
+     * Take a buffer from the pool, allocating one if none
+     * is available for reuse.
+     *
+     * @return
+     *     The buffer is returned.  Its contents are unspecified.
+     */
+    std::vector< uint8_t > Acquire();
+
+    /**
+     * Give back a buffer taken from the pool.
+     *
+     * @param[in] buffer
+     *     This is the buffer to give back.
+     */
+    void Release(std::vector< uint8_t >&& buffer);
+
+    /**
+     * Return statistics about how the pool has been used.
+     *
+     * @return
+     *     Statistics about how the pool has been used are returned.
+     */
+    Stats GetStats() const;
+
+    // Private properties
+private:
+    /**
+     * This is the size of each buffer, in bytes.
+     */
+    size_t bufferSize_ = DEFAULT_BUFFER_SIZE;
+
+    /**
+     * This is the maximum number of buffers to keep for reuse.
+     */
+    size_t maxFree_ = DEFAULT_MAX_FREE;
+
+    /**
+     * These are the buffers kept for reuse.
+     */
+    std::vector< std::vector< uint8_t > > free_;
+
+    /**
+     * These are the statistics about how the pool has been used.
+     * The buffer size and number of free buffers are filled in
+     * when the statistics are requested.
+     */
+    Stats stats_;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex_;
+};
+
+#endif /* NEWMAN_BUFFER_POOL_HPP */
@@ -0,0 +1,312 @@
+/**
+ * @file DeliveryIndex.cpp
+ *
+ * This module contains the implementation of the DeliveryIndex class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "DeliveryIndex.hpp"
+
+#include <algorithm>
+#include <Hash/Sha2.hpp>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif /* not _WIN32 */
+
+namespace {
+
+    /**
+     * This is written at the beginning of every index file, to identify
+     * the format (and its version).
+     */
+    constexpr char SIGNATURE[8] = {'N', 'W', 'M', 'N', 'I', 'D', 'X', '1'};
+
+    /**
+     * This is the number of bytes in each record of the index file:
+     * the key followed by the time it was added, in seconds since
+     * the UNIX epoch, both as little-endian 64-bit integers.
+     */
+    constexpr size_t RECORD_SIZE = 16;
+
+    /**
+     * Store the given number in the given buffer in little-endian order.
+     */
+    void PutUint64(uint8_t* buffer, uint64_t value) {
+        for (size_t i = 0; i < 8; ++i) {
+            buffer[i] = (uint8_t)(value >> (i * 8));
+        }
+    }
+
+    /**
+     * Return the number stored in little-endian order in the given buffer.
+     */
+    uint64_t GetUint64(const uint8_t* buffer) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            value |= ((uint64_t)buffer[i] << (i * 8));
+        }
+        return value;
+    }
+
+    /**
+     * Return the current time, in seconds since the UNIX epoch.
+     */
+    int64_t Now() {
+        return (int64_t)std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * Write the given record to the given file.
+     *
+     * @return
+     *     An indication of whether or not the record was written
+     *     is returned.
+     */
+    bool WriteRecord(FILE* file, DeliveryIndex::Key key, int64_t added) {
+        uint8_t record[RECORD_SIZE];
+        PutUint64(record, key);
+        PutUint64(record + 8, (uint64_t)added);
+        return (fwrite(record, sizeof(record), 1, file) == 1);
+    }
+
+    /**
+     * Make sure everything written to the given file has reached
+     * the disk, so that it survives a crash.
+     *
+     * @return
+     *     An indication of whether or not the file was flushed
+     *     is returned.
+     */
+    bool Sync(FILE* file) {
+        if (fflush(file) != 0) {
+            return false;
+        }
+#ifndef _WIN32
+        return (fsync(fileno(file)) == 0);
+#else /* _WIN32 */
+        return true;
+#endif /* not _WIN32 / _WIN32 */
+    }
+
+}
+
+/**
+ * This contains the private properties of a DeliveryIndex instance.
+ */
+struct DeliveryIndex::Impl {
+    /**
+     * These are the keys in the index, along with when each was added,
+     * in seconds since the UNIX epoch.
+     */
+    std::unordered_map< Key, int64_t > keys;
+
+    /**
+     * This is the file to which added keys are appended,
+     * or nullptr if the index isn't open.
+     */
+    FILE* file = nullptr;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * Read the keys in the given file which were added no earlier
+     * than the given time.
+     *
+     * @param[in] fileName
+     *     This is the path to the file holding the index.
+     *
+     * @param[in] oldest
+     *     This is the earliest time, in seconds since the UNIX epoch,
+     *     at which a key may have been added and still be kept.
+     *
+     * @param[out] exists
+     *     This is where to store whether or not the file exists.
+     *
+     * @return
+     *     The number of records dropped because they were too old,
+     *     repeated, or cut short (by a crash while one was being
+     *     appended) is returned, or -1 if the file isn't a valid index
+     *     or couldn't be read.
+     */
+    long Load(
+        const std::string& fileName,
+        int64_t oldest,
+        bool& exists
+    ) {
+        const auto input = fopen(fileName.c_str(), "rb");
+        exists = (input != nullptr);
+        if (input == nullptr) {
+            return 0;
+        }
+        char signature[sizeof(SIGNATURE)];
+        if (
+            (fread(signature, sizeof(signature), 1, input) != 1)
+            || (memcmp(signature, SIGNATURE, sizeof(SIGNATURE)) != 0)
+        ) {
+            (void)fclose(input);
+            return -1;
+        }
+        long dropped = 0;
+        uint8_t record[RECORD_SIZE];
+        for (;;) {
+            const auto amountRead = fread(record, 1, sizeof(record), input);
+            if (amountRead < sizeof(record)) {
+                if (ferror(input)) {
+                    (void)fclose(input);
+                    return -1;
+                }
+                if (amountRead > 0) {
+                    // The file must be rewritten without this record,
+                    // or records appended after it would be misaligned.
+                    ++dropped;
+                }
+                break;
+            }
+            const auto key = GetUint64(record);
+            const auto added = (int64_t)GetUint64(record + 8);
+            if (added < oldest) {
+                ++dropped;
+            } else {
+                auto& entry = keys[key];
+                if (entry != 0) {
+                    ++dropped;
+                }
+                entry = std::max(entry, added);
+            }
+        }
+        (void)fclose(input);
+        return dropped;
+    }
+
+    /**
+     * Write all the keys in the index to a new file, and replace
+     * the given file with it.
+     *
+     * @param[in] fileName
+     *     This is the path to the file holding the index.
+     *
+     * @return
+     *     An indication of whether or not the file was replaced
+     *     is returned.
+     */
+    bool Rewrite(const std::string& fileName) {
+        const auto temporaryFileName = fileName + ".new";
+        const auto output = fopen(temporaryFileName.c_str(), "wb");
+        if (output == nullptr) {
+            return false;
+        }
+        bool success = (fwrite(SIGNATURE, sizeof(SIGNATURE), 1, output) == 1);
+        for (const auto& entry: keys) {
+            if (!success) {
+                break;
+            }
+            success = WriteRecord(output, entry.first, entry.second);
+        }
+        success = Sync(output) && success;
+        (void)fclose(output);
+        if (
+            !success
+            || (rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+        ) {
+            (void)remove(temporaryFileName.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+DeliveryIndex::~DeliveryIndex() noexcept {
+    if (impl_->file != nullptr) {
+        (void)fclose(impl_->file);
+    }
+}
+
+DeliveryIndex::DeliveryIndex()
+    : impl_(new Impl())
+{
+}
+
+auto DeliveryIndex::MakeKey(
+    const std::string& kind,
+    const std::string& text
+) -> Key {
+    std::vector< uint8_t > input(kind.begin(), kind.end());
+    input.push_back(0);
+    input.insert(input.end(), text.begin(), text.end());
+    const auto digest = Hash::Sha256(input);
+    Key key = 0;
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        key = (key << 8) | digest[i];
+    }
+    return key;
+}
+
+bool DeliveryIndex::Open(
+    const std::string& fileName,
+    std::chrono::seconds retention
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->file != nullptr) {
+        (void)fclose(impl_->file);
+        impl_->file = nullptr;
+    }
+    impl_->keys.clear();
+    bool exists;
+    const auto dropped = impl_->Load(
+        fileName,
+        Now() - (int64_t)retention.count(),
+        exists
+    );
+    if (dropped < 0) {
+        return false;
+    }
+
+    // Rewrite the file if it's missing or has records no longer needed,
+    // so that it doesn't grow without limit, or if its last record was
+    // cut short, so that records appended to it line up.
+    if (
+        (dropped > 0)
+        || !exists
+    ) {
+        if (!impl_->Rewrite(fileName)) {
+            return false;
+        }
+    }
+    impl_->file = fopen(fileName.c_str(), "ab");
+    return (impl_->file != nullptr);
+}
+
+bool DeliveryIndex::Contains(Key key) const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return (impl_->keys.find(key) != impl_->keys.end());
+}
+
+bool DeliveryIndex::Add(Key key) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    const auto added = Now();
+    impl_->keys[key] = added;
+    if (impl_->file == nullptr) {
+        return false;
+    }
+    return (
+        WriteRecord(impl_->file, key, added)
+        && Sync(impl_->file)
+    );
+}
+
+size_t DeliveryIndex::GetSize() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->keys.size();
+}
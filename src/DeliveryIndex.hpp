@@ -0,0 +1,140 @@
+#ifndef NEWMAN_DELIVERY_INDEX_HPP
+#define NEWMAN_DELIVERY_INDEX_HPP
+
+/**
+ * @file DeliveryIndex.hpp
+ *
+ * This module declares the DeliveryIndex class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * This keeps a persistent record of e-mails which SMTP servers have
+ * accepted, so that e-mails already delivered can be skipped when
+ * Newman is run again (for example, after it was killed between the
+ * server accepting an e-mail and the caller learning about it).
+ *
+ * E-mails are identified by 64-bit keys derived from their Message-ID
+ * header and from a hash of their recipients and body.  Each key is kept
+ * with the time it was added, and keys older than the retention window
+ * are dropped.  The index is held in memory as a hash table, so checking
+ * a key takes constant time, and keys are appended to the file as they're
+ * added, so nothing is lost if Newman is killed afterwards.
+ */
+class DeliveryIndex {
+    // Types
+public:
+    /**
+     * This is the type of value used to identify a delivered e-mail.
+     */
+    using Key = uint64_t;
+
+    // Lifecycle management
+public:
+    ~DeliveryIndex() noexcept;
+    DeliveryIndex(const DeliveryIndex&) = delete;
+    DeliveryIndex(DeliveryIndex&&) noexcept = delete;
+    DeliveryIndex& operator=(const DeliveryIndex&) = delete;
+    DeliveryIndex& operator=(DeliveryIndex&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     */
+    DeliveryIndex();
+
+    /**
+     * Derive the key identifying an e-mail from the given text.
+     *
+     * @param[in] kind
+     *     This identifies what the text is (for example, "message-id"),
+     *     so that different kinds of text never produce the same key.
+     *
+     * @param[in] text
+     *     This is the text from which to derive the key.
+     *
+     * @return
+     *     The key derived from the given text is returned.
+     */
+    static Key MakeKey(
+        const std::string& kind,
+        const std::string& text
+    );
+
+    /**
+     * Load the index from the given file, creating it if it doesn't
+     * exist, dropping any keys older than the given retention window,
+     * and keep the file open to record keys added afterwards.
+     *
+     * @param[in] fileName
+     *     This is the path to the file holding the index.
+     *
+     * @param[in] retention
+     *     This is how long to keep each key.
+     *
+     * @return
+     *     An indication of whether or not the index was
+     *     opened successfully is returned.
+     */
+    bool Open(
+        const std::string& fileName,
+        std::chrono::seconds retention
+    );
+
+    /**
+     * Check whether or not the given key is in the index.
+     *
+     * @param[in] key
+     *     This is the key to look up.
+     *
+     * @return
+     *     An indication of whether or not the given key
+     *     is in the index is returned.
+     */
+    bool Contains(Key key) const;
+
+    /**
+     * Add the given key to the index, and record it in the file
+     * before returning.
+     *
+     * @param[in] key
+     *     This is the key to add.
+     *
+     * @return
+     *     An indication of whether or not the key was recorded
+     *     in the file is returned.
+     */
+    bool Add(Key key);
+
+    /**
+     * Return the number of keys in the index.
+     *
+     * @return
+     *     The number of keys in the index is returned.
+     */
+    size_t GetSize() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_DELIVERY_INDEX_HPP */
@@ -0,0 +1,77 @@
+/**
+ * @file DispatchWindow.cpp
+ *
+ * This module contains the implementation of the DispatchWindow class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "DispatchWindow.hpp"
+
+#include <algorithm>
+
+void DispatchWindow::Configure(const Configuration& configuration) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    configuration_ = configuration;
+}
+
+void DispatchWindow::RecordArrival(
+    const std::string& destination,
+    std::chrono::microseconds now
+) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    auto& arrivals = arrivals_[destination];
+    if (arrivals.count > 0) {
+        const auto gap = (double)(now - arrivals.last).count();
+        if (arrivals.count == 1) {
+            arrivals.meanGap = gap;
+        } else {
+            arrivals.meanGap += configuration_.smoothing * (gap - arrivals.meanGap);
+        }
+    }
+    arrivals.last = now;
+    ++arrivals.count;
+}
+
+std::chrono::microseconds DispatchWindow::GetDelay(
+    const std::string& destination,
+    std::chrono::microseconds setupTime
+) const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    const auto arrivals = arrivals_.find(destination);
+    if (
+        (configuration_.maxDelay.count() == 0)
+        || (configuration_.maxMessages <= 1)
+        || (arrivals == arrivals_.end())
+        || (arrivals->second.count < 2)
+    ) {
+        return std::chrono::microseconds(0);
+    }
+
+    // Holding e-mails for longer than it takes to set up another
+    // session gains nothing, and holding them when the next one isn't
+    // expected before the window closes only delays them.
+    double limit = (double)std::chrono::duration_cast< std::chrono::microseconds >(
+        configuration_.maxDelay
+    ).count();
+    if (setupTime.count() > 0) {
+        limit = std::min(limit, (double)setupTime.count());
+    }
+    const auto meanGap = arrivals->second.meanGap;
+    if (meanGap >= limit) {
+        return std::chrono::microseconds(0);
+    }
+
+    // Hold them long enough for the window to fill, if it's expected to.
+    return std::chrono::microseconds(
+        (std::chrono::microseconds::rep)std::min(
+            limit,
+            meanGap * (double)(configuration_.maxMessages - 1)
+        )
+    );
+}
+
+bool DispatchWindow::IsFull(size_t waiting) const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    return (waiting >= configuration_.maxMessages);
+}
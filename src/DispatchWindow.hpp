@@ -0,0 +1,156 @@
+#ifndef NEWMAN_DISPATCH_WINDOW_HPP
+#define NEWMAN_DISPATCH_WINDOW_HPP
+
+/**
+ * @file DispatchWindow.hpp
+ *
+ * This module declares the DispatchWindow class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * This is used to decide how long to hold e-mails arriving for an SMTP
+ * server before opening a session to send them, so that e-mails which
+ * arrive a few milliseconds apart are sent back to back over one
+ * session rather than each opening its own.
+ *
+ * The window adapts to each server: e-mails are only held if, at the
+ * rate they've been arriving, the next one is expected before the
+ * window would close, and never for longer than it takes to set up
+ * a session with the server.  Sparse (transactional) traffic and
+ * servers which are quick to set up are therefore not delayed.
+ */
+class DispatchWindow {
+    // Types
+public:
+    /**
+     * This holds the parameters of the window.
+     */
+    struct Configuration {
+        /**
+         * This is the longest time to hold an e-mail before opening
+         * a session to send it.  Zero means e-mails are never held.
+         */
+        std::chrono::milliseconds maxDelay = std::chrono::milliseconds(0);
+
+        /**
+         * This is the number of e-mails held for a server at which
+         * they're sent right away.
+         */
+        size_t maxMessages = 20;
+
+        /**
+         * This is the weight given to the latest gap between arrivals
+         * in the running average of the gaps for a server.
+         */
+        double smoothing = 0.2;
+    };
+
+    // Public methods
+public:
+    /**
+     * Set the parameters of the window.
+     *
+     * @param[in] configuration
+     *     These are the parameters of the window.
+     */
+    void Configure(const Configuration& configuration);
+
+    /**
+     * Note that an e-mail arrived for an SMTP server.
+     *
+     * @param[in] destination
+     *     This identifies the SMTP server.
+     *
+     * @param[in] now
+     *     This is the time at which the e-mail arrived.
+     */
+    void RecordArrival(
+        const std::string& destination,
+        std::chrono::microseconds now
+    );
+
+    /**
+     * Return how long to hold the e-mails which start waiting now for
+     * a session to an SMTP server, along with any others which arrive
+     * in the meantime, before opening a session to send them.
+     *
+     * @param[in] destination
+     *     This identifies the SMTP server.
+     *
+     * @param[in] setupTime
+     *     This is how long it typically takes to set up a session with
+     *     the server, or zero if that isn't known yet.
+     *
+     * @return
+     *     How long to hold the e-mails is returned.  Zero means
+     *     they should be sent right away.
+     */
+    std::chrono::microseconds GetDelay(
+        const std::string& destination,
+        std::chrono::microseconds setupTime
+    ) const;
+
+    /**
+     * Check whether or not enough e-mails are held for a server
+     * that they should be sent right away.
+     *
+     * @param[in] waiting
+     *     This is the number of e-mails held for the server.
+     *
+     * @return
+     *     An indication of whether or not the held e-mails should be
+     *     sent right away is returned.
+     */
+    bool IsFull(size_t waiting) const;
+
+    // Private properties
+private:
+    /**
+     * This holds what's known about when e-mails arrive for
+     * one SMTP server.
+     */
+    struct Arrivals {
+        /**
+         * This is the time the latest e-mail arrived.
+         */
+        std::chrono::microseconds last = std::chrono::microseconds(0);
+
+        /**
+         * This is the running average of the gaps between arrivals,
+         * in microseconds.
+         */
+        double meanGap = 0.0;
+
+        /**
+         * This is the number of e-mails which have arrived.
+         */
+        uint64_t count = 0;
+    };
+
+    /**
+     * These are the parameters of the window.
+     */
+    Configuration configuration_;
+
+    /**
+     * This is what's known about when e-mails arrive for each
+     * SMTP server, keyed by destination.
+     */
+    std::map< std::string, Arrivals > arrivals_;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex_;
+};
+
+#endif /* NEWMAN_DISPATCH_WINDOW_HPP */
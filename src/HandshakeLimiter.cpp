@@ -0,0 +1,56 @@
+/**
+ * @file HandshakeLimiter.cpp
+ *
+ * This module contains the implementation of the HandshakeLimiter class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "HandshakeLimiter.hpp"
+#include <chrono>
+
+namespace {
+
+    /**
+     * This is how often to check whether or not to stop waiting
+     * for a connection to be allowed to begin setting up.
+     */
+    constexpr auto GIVE_UP_CHECK_INTERVAL = std::chrono::milliseconds(50);
+
+}
+
+void HandshakeLimiter::SetLimit(size_t limit) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    limit_ = limit;
+    wakeCondition_.notify_all();
+}
+
+bool HandshakeLimiter::Acquire(const std::function< bool() >& giveUp) {
+    std::unique_lock< decltype(mutex_) > lock(mutex_);
+    while (
+        !wakeCondition_.wait_for(
+            lock,
+            GIVE_UP_CHECK_INTERVAL,
+            [this]{
+                return (
+                    (limit_ == 0)
+                    || (active_ < limit_)
+                );
+            }
+        )
+    ) {
+        if (giveUp()) {
+            return false;
+        }
+    }
+    ++active_;
+    return true;
+}
+
+void HandshakeLimiter::Release() {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    if (active_ > 0) {
+        --active_;
+    }
+    wakeCondition_.notify_one();
+}
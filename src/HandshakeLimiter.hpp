@@ -0,0 +1,82 @@
+#ifndef NEWMAN_HANDSHAKE_LIMITER_HPP
+#define NEWMAN_HANDSHAKE_LIMITER_HPP
+
+/**
+ * @file HandshakeLimiter.hpp
+ *
+ * This module declares the HandshakeLimiter class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+
+/**
+ * This is used to limit how many connections may be setting up
+ * (connecting, performing the TLS handshake, and authenticating)
+ * at the same time.  Connections beyond the limit wait their turn,
+ * so that a burst of new connections doesn't starve established ones
+ * of CPU time.
+ */
+class HandshakeLimiter {
+    // Public methods
+public:
+    /**
+     * Set the maximum number of connections which may be
+     * setting up at the same time.
+     *
+     * @param[in] limit
+     *     This is the maximum number of connections which may be
+     *     setting up at the same time, or zero for no limit.
+     */
+    void SetLimit(size_t limit);
+
+    /**
+     * Wait until another connection may begin setting up,
+     * and count it as setting up.
+     *
+     * @param[in] giveUp
+     *     This is checked periodically while waiting, and if it
+     *     returns true, the wait is abandoned.
+     *
+     * @return
+     *     An indication of whether or not the connection was counted
+     *     as setting up is returned.  It's false only if the wait
+     *     was abandoned.
+     */
+    bool Acquire(const std::function< bool() >& giveUp);
+
+    /**
+     * Count one fewer connection as setting up, allowing
+     * the next waiting connection, if any, to begin.
+     */
+    void Release();
+
+    // Private properties
+private:
+    /**
+     * This is the maximum number of connections which may be
+     * setting up at the same time, or zero for no limit.
+     */
+    size_t limit_ = 0;
+
+    /**
+     * This is the number of connections setting up.
+     */
+    size_t active_ = 0;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    std::mutex mutex_;
+
+    /**
+     * This is used to wake connections waiting to set up.
+     */
+    std::condition_variable wakeCondition_;
+};
+
+#endif /* NEWMAN_HANDSHAKE_LIMITER_HPP */
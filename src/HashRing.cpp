@@ -0,0 +1,61 @@
+/**
+ * @file HashRing.cpp
+ *
+ * This module contains the implementation of the HashRing class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "HashRing.hpp"
+
+#include <algorithm>
+#include <Hash/Sha2.hpp>
+
+namespace {
+
+    /**
+     * Return the position of the given text on the ring.
+     */
+    uint64_t HashToRing(const std::string& text) {
+        const auto digest = Hash::Sha256(
+            std::vector< uint8_t >(text.begin(), text.end())
+        );
+        uint64_t hash = 0;
+        for (size_t i = 0; i < sizeof(hash); ++i) {
+            hash = (hash << 8) | digest[i];
+        }
+        return hash;
+    }
+
+}
+
+constexpr size_t HashRing::POINTS_PER_NODE;
+
+void HashRing::Configure(const std::vector< std::string >& nodes) {
+    nodes_ = nodes;
+    points_.clear();
+    for (size_t node = 0; node < nodes_.size(); ++node) {
+        for (size_t i = 0; i < POINTS_PER_NODE; ++i) {
+            points_.emplace_back(
+                HashToRing(nodes_[node] + "#" + std::to_string(i)),
+                node
+            );
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+std::string HashRing::GetOwner(const std::string& key) const {
+    if (points_.empty()) {
+        return "";
+    }
+    auto point = std::lower_bound(
+        points_.begin(),
+        points_.end(),
+        std::make_pair(HashToRing(key), (size_t)0)
+    );
+    if (point == points_.end()) {
+        point = points_.begin();
+    }
+    return nodes_[point->second];
+}
@@ -0,0 +1,72 @@
+#ifndef NEWMAN_HASH_RING_HPP
+#define NEWMAN_HASH_RING_HPP
+
+/**
+ * @file HashRing.hpp
+ *
+ * This module declares the HashRing class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * This assigns keys (such as SMTP server destinations) to nodes
+ * by consistent hashing, so that every node given the same list of
+ * nodes makes the same assignment, and adding or removing a node only
+ * moves the keys assigned to that node.
+ *
+ * Each node is placed at several points on a ring of 64-bit hashes,
+ * and each key belongs to the node of the first point at or after the
+ * hash of the key, so that keys are spread evenly.
+ */
+class HashRing {
+    // Constants
+public:
+    /**
+     * This is the number of points on the ring for each node.
+     */
+    static constexpr size_t POINTS_PER_NODE = 64;
+
+    // Public methods
+public:
+    /**
+     * Set the nodes among which keys are assigned.
+     *
+     * @param[in] nodes
+     *     These identify the nodes among which keys are assigned.
+     */
+    void Configure(const std::vector< std::string >& nodes);
+
+    /**
+     * Return the node to which the given key is assigned.
+     *
+     * @param[in] key
+     *     This is the key to look up.
+     *
+     * @return
+     *     The node to which the key is assigned is returned,
+     *     or an empty string if there are no nodes.
+     */
+    std::string GetOwner(const std::string& key) const;
+
+    // Private properties
+private:
+    /**
+     * These are the nodes among which keys are assigned.
+     */
+    std::vector< std::string > nodes_;
+
+    /**
+     * These are the points on the ring, each a hash paired with the index
+     * of the node placed there, in order of hash.
+     */
+    std::vector< std::pair< uint64_t, size_t > > points_;
+};
+
+#endif /* NEWMAN_HASH_RING_HPP */
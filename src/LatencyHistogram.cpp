@@ -0,0 +1,157 @@
+/**
+ * @file LatencyHistogram.cpp
+ *
+ * This module contains the implementation of the LatencyHistogram class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "LatencyHistogram.hpp"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+
+constexpr size_t LatencyHistogram::SUB_BUCKETS;
+constexpr size_t LatencyHistogram::BUCKETS;
+
+size_t LatencyHistogram::BucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return (size_t)value;
+    }
+    size_t exponent = 0;
+    for (auto v = value; v > 1; v >>= 1) {
+        ++exponent;
+    }
+    // The first SUB_BUCKETS buckets count values exactly.  After that,
+    // each power of two 2^e (e >= 3) gets SUB_BUCKETS buckets, selected
+    // by the bits just below the leading one.
+    const auto bucket = (
+        (exponent - 2) * SUB_BUCKETS
+        + (size_t)((value >> (exponent - 3)) & (SUB_BUCKETS - 1))
+    );
+    return (bucket < BUCKETS) ? bucket : (BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    const auto exponent = bucket / SUB_BUCKETS + 2;
+    const auto mantissa = (uint64_t)(bucket % SUB_BUCKETS);
+    return (
+        ((SUB_BUCKETS + mantissa + 1) << (exponent - 3)) - 1
+    );
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count) {
+    buckets_[BucketOf(value)] += count;
+    count_ += count;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+}
+
+void LatencyHistogram::Decay() {
+    count_ = 0;
+    for (auto& bucket: buckets_) {
+        bucket /= 2;
+        count_ += bucket;
+    }
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_;
+}
+
+uint64_t LatencyHistogram::GetBucketCount(size_t bucket) const {
+    return buckets_[bucket];
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    auto rank = (uint64_t)ceil(percentile / 100.0 * (double)count_);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return BucketUpperBound(i);
+        }
+    }
+    return BucketUpperBound(BUCKETS - 1);
+}
+
+std::string LatencyHistogram::Summarize() const {
+    char buffer[160];
+    (void)snprintf(
+        buffer,
+        sizeof(buffer),
+        (
+            "n=%" PRIu64 " p50=%" PRIu64 " p90=%" PRIu64
+            " p99=%" PRIu64 " p99.9=%" PRIu64
+        ),
+        count_,
+        GetPercentile(50.0),
+        GetPercentile(90.0),
+        GetPercentile(99.0),
+        GetPercentile(99.9)
+    );
+    return buffer;
+}
+
+std::string LatencyHistogram::FormatPercentileDistribution(double unitsPerOutputUnit) const {
+    std::string output = "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+    char buffer[100];
+    uint64_t seen = 0;
+    uint64_t max = 0;
+    double sum = 0.0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        if (buckets_[i] == 0) {
+            continue;
+        }
+        seen += buckets_[i];
+        max = BucketUpperBound(i);
+        sum += (double)max * (double)buckets_[i];
+        const auto fraction = (double)seen / (double)count_;
+        if (seen < count_) {
+            (void)snprintf(
+                buffer,
+                sizeof(buffer),
+                "%12.3f %14.12f %10" PRIu64 " %14.2f\n",
+                (double)max / unitsPerOutputUnit,
+                fraction,
+                seen,
+                1.0 / (1.0 - fraction)
+            );
+        } else {
+            (void)snprintf(
+                buffer,
+                sizeof(buffer),
+                "%12.3f %14.12f %10" PRIu64 "\n",
+                (double)max / unitsPerOutputUnit,
+                fraction,
+                seen
+            );
+        }
+        output += buffer;
+    }
+    (void)snprintf(
+        buffer,
+        sizeof(buffer),
+        "#[Mean    = %12.3f]\n#[Max     = %12.3f, Total count    = %12" PRIu64 "]\n",
+        ((count_ == 0) ? 0.0 : sum / (double)count_ / unitsPerOutputUnit),
+        (double)max / unitsPerOutputUnit,
+        count_
+    );
+    output += buffer;
+    return output;
+}
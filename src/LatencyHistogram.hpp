@@ -0,0 +1,158 @@
+#ifndef NEWMAN_LATENCY_HISTOGRAM_HPP
+#define NEWMAN_LATENCY_HISTOGRAM_HPP
+
+/**
+ * @file LatencyHistogram.hpp
+ *
+ * This module declares the LatencyHistogram class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * This is used to count latency measurements in logarithmically-sized
+ * buckets, so that percentiles can be estimated to within about 12%
+ * using a small, fixed amount of memory, no matter how many measurements
+ * are recorded.  Histograms can be merged by adding their buckets.
+ */
+class LatencyHistogram {
+    // Constants
+public:
+    /**
+     * This is the number of buckets into which each power of two
+     * is divided.
+     */
+    static constexpr size_t SUB_BUCKETS = 8;
+
+    /**
+     * This is the total number of buckets, which covers values up to
+     * 2^40 (about 12 days, if the values are microseconds).
+     */
+    static constexpr size_t BUCKETS = SUB_BUCKETS * 39;
+
+    // Public methods
+public:
+    /**
+     * Return the index of the bucket which counts the given value.
+     *
+     * @param[in] value
+     *     This is the value whose bucket index should be returned.
+     *
+     * @return
+     *     The index of the bucket counting the given value is returned.
+     */
+    static size_t BucketOf(uint64_t value);
+
+    /**
+     * Return the largest value counted by the given bucket.
+     *
+     * @param[in] bucket
+     *     This is the index of the bucket whose largest value
+     *     should be returned.
+     *
+     * @return
+     *     The largest value counted by the given bucket is returned.
+     */
+    static uint64_t BucketUpperBound(size_t bucket);
+
+    /**
+     * Count the given measurement.
+     *
+     * @param[in] value
+     *     This is the measurement to count.
+     *
+     * @param[in] count
+     *     This is the number of times to count the measurement.
+     */
+    void Record(uint64_t value, uint64_t count = 1);
+
+    /**
+     * Add the counts of the given histogram to this one.
+     *
+     * @param[in] other
+     *     This is the histogram whose counts should be added.
+     */
+    void Merge(const LatencyHistogram& other);
+
+    /**
+     * Halve the counts of all buckets, so that older measurements
+     * carry less weight than newer ones.
+     */
+    void Decay();
+
+    /**
+     * Return the number of measurements counted.
+     *
+     * @return
+     *     The number of measurements counted is returned.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * Return the number of measurements counted in the given bucket.
+     *
+     * @param[in] bucket
+     *     This is the index of the bucket whose count should be returned.
+     *
+     * @return
+     *     The number of measurements counted in the given bucket
+     *     is returned.
+     */
+    uint64_t GetBucketCount(size_t bucket) const;
+
+    /**
+     * Estimate the value below which the given percentage of
+     * measurements fall.
+     *
+     * @param[in] percentile
+     *     This is the percentage, from 0 to 100, of measurements
+     *     which should fall at or below the returned value.
+     *
+     * @return
+     *     An upper bound on the requested percentile is returned,
+     *     or zero if no measurements have been counted.
+     */
+    uint64_t GetPercentile(double percentile) const;
+
+    /**
+     * Summarize the histogram in human-readable form.
+     *
+     * @return
+     *     The count and the 50th, 90th, 99th and 99.9th percentiles
+     *     are returned in human-readable form.
+     */
+    std::string Summarize() const;
+
+    /**
+     * Render the whole distribution in the percentile distribution
+     * format written by HdrHistogram, so that it can be plotted
+     * or compared with the same tools.
+     *
+     * @param[in] unitsPerOutputUnit
+     *     This is the number of recorded units in each unit of output
+     *     (for example, 1000.0 to output milliseconds when microseconds
+     *     were recorded).
+     *
+     * @return
+     *     The percentile distribution is returned.
+     */
+    std::string FormatPercentileDistribution(double unitsPerOutputUnit) const;
+
+    // Private properties
+private:
+    /**
+     * These are the counts of measurements in each bucket.
+     */
+    uint64_t buckets_[BUCKETS] = {};
+
+    /**
+     * This is the total number of measurements counted.
+     */
+    uint64_t count_ = 0;
+};
+
+#endif /* NEWMAN_LATENCY_HISTOGRAM_HPP */
@@ -0,0 +1,314 @@
+/**
+ * @file LoadGenerator.cpp
+ *
+ * This module contains the implementation of the LoadGenerator class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "LoadGenerator.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+#include <inttypes.h>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * This is the longest time to sleep before checking whether
+     * or not the load test should stop early.
+     */
+    constexpr auto POLL_INTERVAL = std::chrono::milliseconds(100);
+
+    /**
+     * This is how long to wait before trying again to open a session
+     * after failing to open one.
+     */
+    constexpr auto REOPEN_DELAY = std::chrono::milliseconds(1000);
+
+    /**
+     * This hands out the times at which messages should be sent,
+     * in order, to whichever session is free to send the next one.
+     */
+    struct Schedule {
+        /**
+         * This is used to generate the gaps between messages.
+         */
+        Random random;
+
+        /**
+         * This selects how the gaps between messages are chosen.
+         */
+        LoadGenerator::Arrivals arrivals;
+
+        /**
+         * This is the average number of seconds between messages.
+         */
+        double meanGap;
+
+        /**
+         * This is the number of seconds after the start of the test
+         * at which the next message should be sent.
+         */
+        double next = 0.0;
+
+        /**
+         * This is the number of seconds after the start of the test
+         * after which no more messages should be sent.
+         */
+        double end;
+
+        /**
+         * This is the number of messages handed out.
+         */
+        uint64_t claimed = 0;
+
+        /**
+         * This is used to synchronize access to the schedule.
+         */
+        std::mutex mutex;
+
+        Schedule(const LoadGenerator::Configuration& configuration)
+            : random(configuration.seed)
+            , arrivals(configuration.arrivals)
+            , meanGap(1.0 / configuration.rate)
+            , end(std::chrono::duration< double >(configuration.duration).count())
+        {
+            if (arrivals == LoadGenerator::Arrivals::Poisson) {
+                next = random.Exponential(meanGap);
+            }
+        }
+
+        /**
+         * Hand out the time at which the next message should be sent.
+         *
+         * @param[out] arrival
+         *     This is where to store the number of seconds after the
+         *     start of the test at which the message should be sent.
+         *
+         * @return
+         *     An indication of whether or not there was another message
+         *     to send is returned.
+         */
+        bool Claim(double& arrival) {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            if (next >= end) {
+                return false;
+            }
+            arrival = next;
+            ++claimed;
+            if (arrivals == LoadGenerator::Arrivals::Constant) {
+                next += meanGap;
+            } else {
+                next += random.Exponential(meanGap);
+            }
+            return true;
+        }
+
+        /**
+         * Count the messages which were never handed out,
+         * and hand them out so that they're only counted once.
+         * Each one which was due before the test ended is recorded
+         * as taking until the test ended.
+         *
+         * @param[in] ended
+         *     This is the number of seconds after the start of the
+         *     test at which the test ended.
+         *
+         * @param[in,out] responseTimes
+         *     This is where to record the response times, in
+         *     microseconds, of the messages due before the test ended.
+         *
+         * @return
+         *     The number of messages which were never handed out
+         *     is returned.
+         */
+        uint64_t Abandon(
+            double ended,
+            LatencyHistogram& responseTimes
+        ) {
+            uint64_t abandoned = 0;
+            double arrival;
+            while (Claim(arrival)) {
+                ++abandoned;
+                if (arrival < ended) {
+                    responseTimes.Record((uint64_t)((ended - arrival) * 1e6));
+                }
+            }
+            return abandoned;
+        }
+    };
+
+    /**
+     * Return the number of microseconds from the first given time
+     * until the second given time, or zero if the second isn't later.
+     *
+     * @param[in] from
+     *     This is the earlier time.
+     *
+     * @param[in] to
+     *     This is the later time.
+     *
+     * @return
+     *     The number of microseconds between the given times is returned.
+     */
+    uint64_t MicrosecondsBetween(Clock::time_point from, Clock::time_point to) {
+        if (to <= from) {
+            return 0;
+        }
+        return (uint64_t)std::chrono::duration_cast< std::chrono::microseconds >(
+            to - from
+        ).count();
+    }
+
+    /**
+     * Sleep until the given time, unless the load test is stopped first.
+     *
+     * @param[in] deadline
+     *     This is the time until which to sleep.
+     *
+     * @param[in] stop
+     *     This is the function to call to check whether or not
+     *     the load test should stop early.
+     *
+     * @return
+     *     An indication of whether or not the given time was reached
+     *     without the load test being stopped is returned.
+     */
+    bool SleepUntil(
+        Clock::time_point deadline,
+        const LoadGenerator::StopDelegate& stop
+    ) {
+        for (;;) {
+            if (stop()) {
+                return false;
+            }
+            const auto now = Clock::now();
+            if (now >= deadline) {
+                return true;
+            }
+            std::this_thread::sleep_for(
+                std::min(
+                    std::chrono::duration_cast< Clock::duration >(POLL_INTERVAL),
+                    deadline - now
+                )
+            );
+        }
+    }
+
+}
+
+std::string LoadGenerator::Report::ToString() const {
+    char buffer[200];
+    (void)snprintf(
+        buffer,
+        sizeof(buffer),
+        (
+            "scheduled=%" PRIu64 " sent=%" PRIu64 " failed=%" PRIu64
+            " missed=%" PRIu64 " elapsed=%.1fs throughput=%.1f/s"
+        ),
+        scheduled,
+        sent,
+        failed,
+        missed,
+        elapsed,
+        ((elapsed > 0.0) ? (double)sent / elapsed : 0.0)
+    );
+    return (
+        std::string(buffer)
+        + "; response (us): " + responseTimes.Summarize()
+        + "; service (us): " + serviceTimes.Summarize()
+        + "; start delay (us): " + startDelays.Summarize()
+    );
+}
+
+void LoadGenerator::Configure(const Configuration& configuration) {
+    configuration_ = configuration;
+}
+
+auto LoadGenerator::Run(
+    OpenSessionDelegate openSession,
+    StopDelegate stop
+) -> Report {
+    Report report;
+    if (
+        (configuration_.sessions == 0)
+        || (configuration_.rate <= 0.0)
+    ) {
+        return report;
+    }
+    Schedule schedule(configuration_);
+    std::mutex reportMutex;
+    const auto start = Clock::now();
+    const auto cutoff = start + configuration_.duration + configuration_.drain;
+    const auto worker = [&]{
+        Report sessionReport;
+        SendDelegate send;
+        while (
+            !stop()
+            && (Clock::now() < cutoff)
+        ) {
+            if (send == nullptr) {
+                send = openSession();
+                if (send == nullptr) {
+                    (void)SleepUntil(
+                        std::min(Clock::now() + REOPEN_DELAY, cutoff),
+                        stop
+                    );
+                    continue;
+                }
+            }
+            double arrival;
+            if (!schedule.Claim(arrival)) {
+                break;
+            }
+            const auto intended = start + std::chrono::duration_cast< Clock::duration >(
+                std::chrono::duration< double >(arrival)
+            );
+            if (!SleepUntil(intended, stop)) {
+                ++sessionReport.missed;
+                const auto stopped = Clock::now();
+                if (intended < stopped) {
+                    sessionReport.responseTimes.Record(MicrosecondsBetween(intended, stopped));
+                }
+                break;
+            }
+            const auto actualStart = Clock::now();
+            const auto sent = send();
+            const auto finish = Clock::now();
+            if (sent) {
+                ++sessionReport.sent;
+                sessionReport.responseTimes.Record(MicrosecondsBetween(intended, finish));
+                sessionReport.serviceTimes.Record(MicrosecondsBetween(actualStart, finish));
+                sessionReport.startDelays.Record(MicrosecondsBetween(intended, actualStart));
+            } else {
+                ++sessionReport.failed;
+                send = nullptr;
+            }
+        }
+        std::lock_guard< decltype(reportMutex) > lock(reportMutex);
+        report.sent += sessionReport.sent;
+        report.failed += sessionReport.failed;
+        report.missed += sessionReport.missed;
+        report.responseTimes.Merge(sessionReport.responseTimes);
+        report.serviceTimes.Merge(sessionReport.serviceTimes);
+        report.startDelays.Merge(sessionReport.startDelays);
+    };
+    std::vector< std::thread > workers;
+    for (size_t i = 0; i < configuration_.sessions; ++i) {
+        workers.emplace_back(worker);
+    }
+    for (auto& thread: workers) {
+        thread.join();
+    }
+    report.elapsed = std::chrono::duration< double >(Clock::now() - start).count();
+    report.missed += schedule.Abandon(report.elapsed, report.responseTimes);
+    report.scheduled = schedule.claimed;
+    return report;
+}
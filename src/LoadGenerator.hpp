@@ -0,0 +1,215 @@
+#ifndef NEWMAN_LOAD_GENERATOR_HPP
+#define NEWMAN_LOAD_GENERATOR_HPP
+
+/**
+ * @file LoadGenerator.hpp
+ *
+ * This module declares the LoadGenerator class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "LatencyHistogram.hpp"
+
+/**
+ * This is used to load-test an SMTP server by sending messages over
+ * several concurrent sessions, at times chosen in advance by an
+ * open-loop arrival process.
+ *
+ * Because the time at which each message should be sent doesn't
+ * depend on how long earlier messages took, a slow server can't
+ * hold back the load offered to it.  Each message's response time is
+ * measured from the time it should have been sent, not the time
+ * a session became free to send it, so time spent waiting behind
+ * slow messages is counted rather than hidden (correcting for
+ * "coordinated omission").
+ */
+class LoadGenerator {
+    // Types
+public:
+    /**
+     * This identifies how the times at which messages are sent
+     * are spaced.
+     */
+    enum class Arrivals {
+        /**
+         * Messages are sent at evenly-spaced times.
+         */
+        Constant,
+
+        /**
+         * Messages are sent at the times of a Poisson process,
+         * with exponentially-distributed gaps between them.
+         */
+        Poisson,
+    };
+
+    /**
+     * This holds the parameters of a load test.
+     */
+    struct Configuration {
+        /**
+         * This is the number of concurrent sessions over which to
+         * send messages.  Zero means no load test is performed.
+         */
+        size_t sessions = 0;
+
+        /**
+         * This is the average number of messages to send per second,
+         * across all sessions.
+         */
+        double rate = 10.0;
+
+        /**
+         * This selects how the times at which messages are sent
+         * are spaced.
+         */
+        Arrivals arrivals = Arrivals::Poisson;
+
+        /**
+         * This is how long to keep starting new messages.
+         */
+        std::chrono::milliseconds duration = std::chrono::milliseconds(60000);
+
+        /**
+         * This is how long after the end of the test to keep sending
+         * messages which should have been sent during the test,
+         * but which were held back because every session was busy.
+         */
+        std::chrono::milliseconds drain = std::chrono::milliseconds(10000);
+
+        /**
+         * This is used to seed the generator of arrival times,
+         * so that the same test can be repeated.
+         */
+        uint64_t seed = 1;
+    };
+
+    /**
+     * This is the type of function called to send one message over
+     * a session.  It returns an indication of whether or not the
+     * message was sent.  If it wasn't, the session is abandoned.
+     */
+    using SendDelegate = std::function< bool() >;
+
+    /**
+     * This is the type of function called to open a new session.
+     * It returns the function to call to send messages over the session,
+     * or nullptr if the session couldn't be opened.
+     */
+    using OpenSessionDelegate = std::function< SendDelegate() >;
+
+    /**
+     * This is the type of function called to check whether or not
+     * the load test should stop early.
+     */
+    using StopDelegate = std::function< bool() >;
+
+    /**
+     * This holds the results of a load test.  All durations
+     * are in microseconds.
+     */
+    struct Report {
+        /**
+         * This is the number of messages which should have been sent
+         * during the test.
+         */
+        uint64_t scheduled = 0;
+
+        /**
+         * This is the number of messages successfully sent.
+         */
+        uint64_t sent = 0;
+
+        /**
+         * This is the number of messages which couldn't be sent.
+         */
+        uint64_t failed = 0;
+
+        /**
+         * This is the number of messages which were never attempted,
+         * because the test ended (or was stopped) before a session
+         * was free to send them.
+         */
+        uint64_t missed = 0;
+
+        /**
+         * These are the times from when each message should have been
+         * sent until it was accepted, corrected for coordinated omission.
+         * Each message missed which was due before the test ended is
+         * included with the time from when it should have been sent
+         * until the test ended, the least it could have taken.
+         */
+        LatencyHistogram responseTimes;
+
+        /**
+         * These are the times from when each message was actually
+         * handed to a session until it was accepted.
+         */
+        LatencyHistogram serviceTimes;
+
+        /**
+         * These are the times from when each message should have been
+         * sent until a session was free to send it.
+         */
+        LatencyHistogram startDelays;
+
+        /**
+         * This is the number of seconds the test took.
+         */
+        double elapsed = 0.0;
+
+        /**
+         * Render the results in human-readable form.
+         *
+         * @return
+         *     The results in human-readable form are returned.
+         */
+        std::string ToString() const;
+    };
+
+    // Public methods
+public:
+    /**
+     * Set the parameters of the load test.
+     *
+     * @param[in] configuration
+     *     These are the parameters of the load test.
+     */
+    void Configure(const Configuration& configuration);
+
+    /**
+     * Perform the load test, returning once every message has been
+     * sent, the drain time has passed, or the test is stopped early.
+     *
+     * @param[in] openSession
+     *     This is the function to call to open each session.
+     *     It's called from several threads at once.
+     *
+     * @param[in] stop
+     *     This is the function to call to check whether or not
+     *     the load test should stop early.
+     *
+     * @return
+     *     The results of the load test are returned.
+     */
+    Report Run(
+        OpenSessionDelegate openSession,
+        StopDelegate stop
+    );
+
+    // Private properties
+private:
+    /**
+     * These are the parameters of the load test.
+     */
+    Configuration configuration_;
+};
+
+#endif /* NEWMAN_LOAD_GENERATOR_HPP */
@@ -0,0 +1,104 @@
+#ifndef NEWMAN_RANDOM_HPP
+#define NEWMAN_RANDOM_HPP
+
+/**
+ * @file Random.hpp
+ *
+ * This module declares the Random class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * This is a pseudo-random number generator (SplitMix64), along with
+ * the distributions built on it.  It's used rather than the standard
+ * library's generators and distributions, because those may differ
+ * from one platform to another, and the same seed should produce
+ * the same results everywhere.
+ */
+class Random {
+    // Lifecycle management
+public:
+    explicit Random(uint64_t seed)
+        : state_(seed)
+    {
+    }
+
+    // Public methods
+public:
+    /**
+     * Return the next 64 pseudo-random bits.
+     */
+    uint64_t Next() {
+        auto z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * Return a number uniformly distributed in [0, 1).
+     */
+    double Uniform() {
+        return (double)(Next() >> 11) / 9007199254740992.0;
+    }
+
+    /**
+     * Return an integer uniformly distributed in [0, n).
+     */
+    size_t Below(size_t n) {
+        return (n == 0) ? 0 : (size_t)(Next() % n);
+    }
+
+    /**
+     * Return true with the given probability.
+     */
+    bool Chance(double probability) {
+        return (Uniform() < probability);
+    }
+
+    /**
+     * Return a number which is log-normally distributed
+     * with the given median and shape.
+     */
+    double LogNormal(double median, double sigma) {
+        // Box-Muller transform
+        const auto u1 = 1.0 - Uniform();
+        const auto u2 = Uniform();
+        const auto normal = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+        return median * exp(sigma * normal);
+    }
+
+    /**
+     * Return a number which is exponentially distributed
+     * with the given mean.
+     */
+    double Exponential(double mean) {
+        return -mean * log(1.0 - Uniform());
+    }
+
+    /**
+     * Return a non-negative integer which is geometrically distributed
+     * with the given mean.
+     */
+    size_t Geometric(double mean) {
+        if (mean <= 0.0) {
+            return 0;
+        }
+        const auto p = 1.0 / (mean + 1.0);
+        return (size_t)floor(log(1.0 - Uniform()) / log(1.0 - p));
+    }
+
+    // Private properties
+private:
+    /**
+     * This is the state of the generator.
+     */
+    uint64_t state_;
+};
+
+#endif /* NEWMAN_RANDOM_HPP */
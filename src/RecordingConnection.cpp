@@ -0,0 +1,117 @@
+/**
+ * @file RecordingConnection.cpp
+ *
+ * This module contains the implementation of the RecordingConnection
+ * class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "RecordingConnection.hpp"
+
+#include <atomic>
+
+/**
+ * This contains the private properties of a RecordingConnection instance.
+ */
+struct RecordingConnection::Impl {
+    /**
+     * This is the connection being decorated.
+     */
+    std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer;
+
+    /**
+     * This is where the events of the session are recorded.
+     */
+    std::shared_ptr< SessionTraceWriter > trace;
+
+    /**
+     * This indicates whether or not the end of the session
+     * has been recorded, so that it's only recorded once.
+     */
+    std::atomic< bool > closed{false};
+
+    /**
+     * Record the end of the session, unless it's already been recorded.
+     */
+    void RecordClosed() {
+        if (!closed.exchange(true)) {
+            trace->Record(TraceEventType::Closed);
+        }
+    }
+};
+
+RecordingConnection::~RecordingConnection() noexcept = default;
+
+RecordingConnection::RecordingConnection(
+    std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer,
+    std::shared_ptr< SessionTraceWriter > trace
+)
+    : impl_(new Impl())
+{
+    impl_->lowerLayer = lowerLayer;
+    impl_->trace = trace;
+}
+
+SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate RecordingConnection::SubscribeToDiagnostics(
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+    size_t minLevel
+) {
+    return impl_->lowerLayer->SubscribeToDiagnostics(delegate, minLevel);
+}
+
+bool RecordingConnection::Connect(uint32_t peerAddress, uint16_t peerPort) {
+    if (!impl_->lowerLayer->Connect(peerAddress, peerPort)) {
+        impl_->RecordClosed();
+        return false;
+    }
+    impl_->trace->Record(TraceEventType::Connected);
+    return true;
+}
+
+bool RecordingConnection::Process(
+    MessageReceivedDelegate messageReceivedDelegate,
+    BrokenDelegate brokenDelegate
+) {
+    const auto impl = impl_.get();
+    return impl_->lowerLayer->Process(
+        [impl, messageReceivedDelegate](const std::vector< uint8_t >& message){
+            impl->trace->Record(TraceEventType::ServerData, message);
+            messageReceivedDelegate(message);
+        },
+        [impl, brokenDelegate](bool graceful){
+            impl->RecordClosed();
+            brokenDelegate(graceful);
+        }
+    );
+}
+
+uint32_t RecordingConnection::GetPeerAddress() const {
+    return impl_->lowerLayer->GetPeerAddress();
+}
+
+uint16_t RecordingConnection::GetPeerPort() const {
+    return impl_->lowerLayer->GetPeerPort();
+}
+
+bool RecordingConnection::IsConnected() const {
+    return impl_->lowerLayer->IsConnected();
+}
+
+uint32_t RecordingConnection::GetBoundAddress() const {
+    return impl_->lowerLayer->GetBoundAddress();
+}
+
+uint16_t RecordingConnection::GetBoundPort() const {
+    return impl_->lowerLayer->GetBoundPort();
+}
+
+void RecordingConnection::SendMessage(const std::vector< uint8_t >& message) {
+    impl_->trace->Record(TraceEventType::ClientData, message);
+    impl_->lowerLayer->SendMessage(message);
+}
+
+void RecordingConnection::Close(bool clean) {
+    impl_->RecordClosed();
+    impl_->lowerLayer->Close(clean);
+}
@@ -0,0 +1,83 @@
+#ifndef NEWMAN_RECORDING_CONNECTION_HPP
+#define NEWMAN_RECORDING_CONNECTION_HPP
+
+/**
+ * @file RecordingConnection.hpp
+ *
+ * This module declares the RecordingConnection class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <memory>
+#include <SystemAbstractions/INetworkConnection.hpp>
+
+#include "SessionTrace.hpp"
+
+/**
+ * This decorates a network connection, recording everything sent and
+ * received through it, and when, to a session trace.  When it decorates
+ * a TLS connection, the decrypted bytes are recorded.
+ */
+class RecordingConnection
+    : public SystemAbstractions::INetworkConnection
+{
+    // Lifecycle management
+public:
+    ~RecordingConnection() noexcept;
+    RecordingConnection(const RecordingConnection&) = delete;
+    RecordingConnection(RecordingConnection&&) noexcept = delete;
+    RecordingConnection& operator=(const RecordingConnection&) = delete;
+    RecordingConnection& operator=(RecordingConnection&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] lowerLayer
+     *     This is the connection to decorate.
+     *
+     * @param[in] trace
+     *     This is where to record the events of the session.
+     */
+    RecordingConnection(
+        std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer,
+        std::shared_ptr< SessionTraceWriter > trace
+    );
+
+    // SystemAbstractions::INetworkConnection
+public:
+    virtual SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+        size_t minLevel = 0
+    ) override;
+    virtual bool Connect(uint32_t peerAddress, uint16_t peerPort) override;
+    virtual bool Process(
+        MessageReceivedDelegate messageReceivedDelegate,
+        BrokenDelegate brokenDelegate
+    ) override;
+    virtual uint32_t GetPeerAddress() const override;
+    virtual uint16_t GetPeerPort() const override;
+    virtual bool IsConnected() const override;
+    virtual uint32_t GetBoundAddress() const override;
+    virtual uint16_t GetBoundPort() const override;
+    virtual void SendMessage(const std::vector< uint8_t >& message) override;
+    virtual void Close(bool clean = false) override;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_RECORDING_CONNECTION_HPP */
@@ -0,0 +1,170 @@
+/**
+ * @file ReplyMonitor.cpp
+ *
+ * This module contains the implementation of the ReplyMonitor class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "ReplyMonitor.hpp"
+
+#include <mutex>
+
+/**
+ * This contains the private properties of a ReplyMonitor instance.
+ */
+struct ReplyMonitor::Impl {
+    /**
+     * This is the connection being decorated.
+     */
+    std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer;
+
+    /**
+     * This breaks the data received from the server into replies.
+     */
+    ReplyParser parser;
+
+    /**
+     * This indicates whether or not an EHLO command was sent
+     * whose reply hasn't been received yet.
+     */
+    bool awaitingEhloReply = false;
+
+    /**
+     * These are the capabilities the server listed in its most
+     * recent reply to EHLO.
+     */
+    ReplyParser::Capabilities capabilities;
+
+    /**
+     * This is the first line of the most recent negative reply
+     * from the server.
+     */
+    std::string lastNegativeReply;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * This is the constructor of the structure.
+     */
+    Impl()
+        : parser(
+            [this](const ReplyParser::Reply& reply){
+                OnReply(reply);
+            }
+        )
+    {
+    }
+
+    /**
+     * Keep track of what the server said in the given reply.
+     *
+     * @param[in] reply
+     *     This is the reply received from the server.
+     */
+    void OnReply(const ReplyParser::Reply& reply) {
+        if (awaitingEhloReply) {
+            awaitingEhloReply = false;
+            (void)ReplyParser::ParseCapabilities(reply, capabilities);
+        }
+        if (reply.code >= 400) {
+            lastNegativeReply = std::to_string(reply.code);
+            if (reply.enhancedStatus.size > 0) {
+                lastNegativeReply += ' ' + reply.enhancedStatus.ToString();
+            }
+            if (reply.text.size > 0) {
+                lastNegativeReply += ' ' + reply.text.ToString();
+            }
+        }
+    }
+};
+
+ReplyMonitor::~ReplyMonitor() noexcept = default;
+
+ReplyMonitor::ReplyMonitor(
+    std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer
+)
+    : impl_(new Impl())
+{
+    impl_->lowerLayer = lowerLayer;
+}
+
+ReplyParser::Capabilities ReplyMonitor::GetCapabilities() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->capabilities;
+}
+
+std::string ReplyMonitor::GetLastNegativeReply() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->lastNegativeReply;
+}
+
+SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate ReplyMonitor::SubscribeToDiagnostics(
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+    size_t minLevel
+) {
+    return impl_->lowerLayer->SubscribeToDiagnostics(delegate, minLevel);
+}
+
+bool ReplyMonitor::Connect(uint32_t peerAddress, uint16_t peerPort) {
+    return impl_->lowerLayer->Connect(peerAddress, peerPort);
+}
+
+bool ReplyMonitor::Process(
+    MessageReceivedDelegate messageReceivedDelegate,
+    BrokenDelegate brokenDelegate
+) {
+    const auto impl = impl_.get();
+    return impl_->lowerLayer->Process(
+        [impl, messageReceivedDelegate](const std::vector< uint8_t >& message){
+            {
+                std::lock_guard< decltype(impl->mutex) > lock(impl->mutex);
+                (void)impl->parser.Parse(message.data(), message.size());
+            }
+            messageReceivedDelegate(message);
+        },
+        brokenDelegate
+    );
+}
+
+uint32_t ReplyMonitor::GetPeerAddress() const {
+    return impl_->lowerLayer->GetPeerAddress();
+}
+
+uint16_t ReplyMonitor::GetPeerPort() const {
+    return impl_->lowerLayer->GetPeerPort();
+}
+
+bool ReplyMonitor::IsConnected() const {
+    return impl_->lowerLayer->IsConnected();
+}
+
+uint32_t ReplyMonitor::GetBoundAddress() const {
+    return impl_->lowerLayer->GetBoundAddress();
+}
+
+uint16_t ReplyMonitor::GetBoundPort() const {
+    return impl_->lowerLayer->GetBoundPort();
+}
+
+void ReplyMonitor::SendMessage(const std::vector< uint8_t >& message) {
+    if (
+        (message.size() >= 5)
+        && ((message[0] | 0x20) == 'e')
+        && ((message[1] | 0x20) == 'h')
+        && ((message[2] | 0x20) == 'l')
+        && ((message[3] | 0x20) == 'o')
+        && (message[4] == ' ')
+    ) {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        impl_->awaitingEhloReply = true;
+    }
+    impl_->lowerLayer->SendMessage(message);
+}
+
+void ReplyMonitor::Close(bool clean) {
+    impl_->lowerLayer->Close(clean);
+}
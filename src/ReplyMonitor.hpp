@@ -0,0 +1,101 @@
+#ifndef NEWMAN_REPLY_MONITOR_HPP
+#define NEWMAN_REPLY_MONITOR_HPP
+
+/**
+ * @file ReplyMonitor.hpp
+ *
+ * This module declares the ReplyMonitor class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <memory>
+#include <string>
+#include <SystemAbstractions/INetworkConnection.hpp>
+
+#include "ReplyParser.hpp"
+
+/**
+ * This decorates a network connection to an SMTP server, parsing
+ * the server's replies as they're received, in order to keep track
+ * of the capabilities the server listed in reply to EHLO, and of the
+ * last reply in which the server turned something down.  When it
+ * decorates a TLS connection, the decrypted replies are parsed.
+ */
+class ReplyMonitor
+    : public SystemAbstractions::INetworkConnection
+{
+    // Lifecycle management
+public:
+    ~ReplyMonitor() noexcept;
+    ReplyMonitor(const ReplyMonitor&) = delete;
+    ReplyMonitor(ReplyMonitor&&) noexcept = delete;
+    ReplyMonitor& operator=(const ReplyMonitor&) = delete;
+    ReplyMonitor& operator=(ReplyMonitor&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] lowerLayer
+     *     This is the connection to decorate.
+     */
+    explicit ReplyMonitor(
+        std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer
+    );
+
+    /**
+     * Return the capabilities the server listed in its most recent
+     * reply to EHLO.
+     *
+     * @return
+     *     The capabilities the server listed are returned.
+     */
+    ReplyParser::Capabilities GetCapabilities() const;
+
+    /**
+     * Return the first line of the most recent reply from the server
+     * with a transient or permanent negative completion code.
+     *
+     * @return
+     *     The first line of the most recent negative reply is returned,
+     *     or an empty string if there hasn't been one.
+     */
+    std::string GetLastNegativeReply() const;
+
+    // SystemAbstractions::INetworkConnection
+public:
+    virtual SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+        size_t minLevel = 0
+    ) override;
+    virtual bool Connect(uint32_t peerAddress, uint16_t peerPort) override;
+    virtual bool Process(
+        MessageReceivedDelegate messageReceivedDelegate,
+        BrokenDelegate brokenDelegate
+    ) override;
+    virtual uint32_t GetPeerAddress() const override;
+    virtual uint16_t GetPeerPort() const override;
+    virtual bool IsConnected() const override;
+    virtual uint32_t GetBoundAddress() const override;
+    virtual uint16_t GetBoundPort() const override;
+    virtual void SendMessage(const std::vector< uint8_t >& message) override;
+    virtual void Close(bool clean = false) override;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_REPLY_MONITOR_HPP */
@@ -0,0 +1,409 @@
+/**
+ * @file ReplyParser.cpp
+ *
+ * This module contains the implementation of the ReplyParser class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "ReplyParser.hpp"
+
+#include <string.h>
+
+namespace {
+
+    /**
+     * These are the keywords of the capabilities recognized,
+     * in the order of the Capability enumeration.
+     */
+    const char* const CAPABILITY_NAMES[] = {
+        "PIPELINING",
+        "SIZE",
+        "8BITMIME",
+        "STARTTLS",
+        "AUTH",
+        "CHUNKING",
+        "BINARYMIME",
+        "SMTPUTF8",
+        "ENHANCEDSTATUSCODES",
+        "DSN",
+    };
+    static_assert(
+        sizeof(CAPABILITY_NAMES) / sizeof(CAPABILITY_NAMES[0])
+        == static_cast< size_t >(ReplyParser::Capability::Count),
+        "every capability needs a name"
+    );
+
+    /**
+     * These are the names of the SASL mechanisms recognized,
+     * in the order of the AuthMechanism enumeration.
+     */
+    const char* const AUTH_MECHANISM_NAMES[] = {
+        "PLAIN",
+        "LOGIN",
+        "CRAM-MD5",
+        "SCRAM-SHA-1",
+        "SCRAM-SHA-256",
+        "XOAUTH2",
+    };
+    static_assert(
+        sizeof(AUTH_MECHANISM_NAMES) / sizeof(AUTH_MECHANISM_NAMES[0])
+        == static_cast< size_t >(ReplyParser::AuthMechanism::Count),
+        "every mechanism needs a name"
+    );
+
+    /**
+     * Check whether or not the given character is a decimal digit.
+     */
+    bool IsDigit(char c) {
+        return (c >= '0') && (c <= '9');
+    }
+
+    /**
+     * Check whether or not the given text is the given name,
+     * ignoring case.
+     */
+    bool IsName(
+        const char* text,
+        size_t size,
+        const char* name
+    ) {
+        for (size_t i = 0; i < size; ++i) {
+            auto c = text[i];
+            if ((c >= 'a') && (c <= 'z')) {
+                c -= 'a' - 'A';
+            }
+            if (c != name[i]) {
+                return false;
+            }
+        }
+        return (name[size] == 0);
+    }
+
+    /**
+     * Find the name in the given table matching the given text,
+     * ignoring case.
+     *
+     * @return
+     *     The position of the matching name in the table is returned,
+     *     or the number of names in the table if none matches.
+     */
+    template< size_t N > size_t FindName(
+        const char* text,
+        size_t size,
+        const char* const (&names)[N]
+    ) {
+        for (size_t i = 0; i < N; ++i) {
+            if (IsName(text, size, names[i])) {
+                return i;
+            }
+        }
+        return N;
+    }
+
+    /**
+     * Return the length of the enhanced status code (class "." subject
+     * "." detail) at the beginning of the given text, or zero if
+     * the text doesn't begin with one.
+     */
+    size_t GetEnhancedStatusLength(
+        const char* text,
+        size_t size
+    ) {
+        if (
+            (size < 5)
+            || ((text[0] != '2') && (text[0] != '4') && (text[0] != '5'))
+            || (text[1] != '.')
+        ) {
+            return 0;
+        }
+        size_t length = 2;
+        for (int part = 0; part < 2; ++part) {
+            size_t digits = 0;
+            while (
+                (length < size)
+                && IsDigit(text[length])
+            ) {
+                ++length;
+                ++digits;
+            }
+            if (
+                (digits == 0)
+                || (digits > 3)
+            ) {
+                return 0;
+            }
+            if (part == 0) {
+                if (
+                    (length >= size)
+                    || (text[length] != '.')
+                ) {
+                    return 0;
+                }
+                ++length;
+            }
+        }
+        if (
+            (length < size)
+            && (text[length] != ' ')
+        ) {
+            return 0;
+        }
+        return length;
+    }
+
+}
+
+constexpr size_t ReplyParser::MAX_PENDING_SIZE;
+
+std::string ReplyParser::TextView::ToString() const {
+    return std::string(data, size);
+}
+
+bool ReplyParser::Capabilities::Has(Capability capability) const {
+    return ((supported & (1u << static_cast< size_t >(capability))) != 0);
+}
+
+bool ReplyParser::Capabilities::Has(AuthMechanism mechanism) const {
+    return ((authMechanisms & (1u << static_cast< size_t >(mechanism))) != 0);
+}
+
+std::string ReplyParser::Capabilities::ToString() const {
+    std::string output;
+    for (size_t i = 0; i < static_cast< size_t >(Capability::Count); ++i) {
+        const auto capability = static_cast< Capability >(i);
+        if (!Has(capability)) {
+            continue;
+        }
+        if (!output.empty()) {
+            output += ' ';
+        }
+        output += CAPABILITY_NAMES[i];
+        if (
+            (capability == Capability::Size)
+            && (maxSize != 0)
+        ) {
+            output += "=" + std::to_string(maxSize);
+        } else if (capability == Capability::Auth) {
+            char delimiter = '=';
+            for (size_t j = 0; j < static_cast< size_t >(AuthMechanism::Count); ++j) {
+                if (Has(static_cast< AuthMechanism >(j))) {
+                    output += delimiter;
+                    output += AUTH_MECHANISM_NAMES[j];
+                    delimiter = ',';
+                }
+            }
+        }
+    }
+    return output;
+}
+
+ReplyParser::ReplyParser(ReplyDelegate replyDelegate)
+    : replyDelegate_(replyDelegate)
+{
+}
+
+bool ReplyParser::Parse(
+    const uint8_t* data,
+    size_t size
+) {
+    size_t consumed = 0;
+    bool wellFormed;
+    if (pending_.empty()) {
+        // Parse the data where it is, and only keep what's left
+        // of a reply which isn't complete yet.
+        wellFormed = Scan((const char*)data, size, consumed);
+        if (
+            wellFormed
+            && (consumed < size)
+        ) {
+            pending_.assign(data + consumed, data + size);
+        }
+    } else {
+        pending_.insert(pending_.end(), data, data + size);
+        wellFormed = Scan(pending_.data(), pending_.size(), consumed);
+        if (wellFormed) {
+            pending_.erase(pending_.begin(), pending_.begin() + consumed);
+        }
+    }
+    if (pending_.size() > MAX_PENDING_SIZE) {
+        wellFormed = false;
+    }
+    if (!wellFormed) {
+        Reset();
+    }
+    return wellFormed;
+}
+
+void ReplyParser::Reset() {
+    pending_.clear();
+    reply_ = Reply();
+    enhancedStatusOffset_ = 0;
+    textOffset_ = 0;
+    nextLine_ = 0;
+}
+
+bool ReplyParser::ParseCapabilities(
+    const Reply& reply,
+    Capabilities& capabilities
+) {
+    capabilities = Capabilities();
+    if (reply.code != 250) {
+        return false;
+    }
+
+    // The first line holds the server's domain and greeting, and each
+    // line after it holds one capability keyword, optionally followed
+    // by parameters.
+    const auto end = reply.lines.data + reply.lines.size;
+    auto line = (const char*)memchr(reply.lines.data, '\n', reply.lines.size);
+    while (
+        (line != nullptr)
+        && (++line < end)
+    ) {
+        auto lineEnd = (const char*)memchr(line, '\n', end - line);
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+        auto textEnd = lineEnd;
+        if (
+            (textEnd > line)
+            && (textEnd[-1] == '\r')
+        ) {
+            --textEnd;
+        }
+        const auto text = line + 4;
+        if (text < textEnd) {
+            auto keywordEnd = text;
+            while (
+                (keywordEnd < textEnd)
+                && (*keywordEnd != ' ')
+                && (*keywordEnd != '=')
+            ) {
+                ++keywordEnd;
+            }
+            const auto capability = FindName(text, keywordEnd - text, CAPABILITY_NAMES);
+            if (capability < static_cast< size_t >(Capability::Count)) {
+                capabilities.supported |= (1u << capability);
+                auto parameter = keywordEnd;
+                while (parameter < textEnd) {
+                    ++parameter;
+                    auto parameterEnd = parameter;
+                    while (
+                        (parameterEnd < textEnd)
+                        && (*parameterEnd != ' ')
+                    ) {
+                        ++parameterEnd;
+                    }
+                    if (static_cast< Capability >(capability) == Capability::Size) {
+                        uint64_t maxSize = 0;
+                        for (auto digit = parameter; digit < parameterEnd; ++digit) {
+                            if (!IsDigit(*digit)) {
+                                maxSize = 0;
+                                break;
+                            }
+                            maxSize = maxSize * 10 + (*digit - '0');
+                        }
+                        capabilities.maxSize = maxSize;
+                    } else if (static_cast< Capability >(capability) == Capability::Auth) {
+                        const auto mechanism = FindName(
+                            parameter,
+                            parameterEnd - parameter,
+                            AUTH_MECHANISM_NAMES
+                        );
+                        if (mechanism < static_cast< size_t >(AuthMechanism::Count)) {
+                            capabilities.authMechanisms |= (1u << mechanism);
+                        }
+                    }
+                    parameter = parameterEnd;
+                }
+            }
+        }
+        line = ((lineEnd < end) ? lineEnd : nullptr);
+    }
+    return true;
+}
+
+bool ReplyParser::Scan(
+    const char* data,
+    size_t size,
+    size_t& consumed
+) {
+    consumed = 0;
+    for (;;) {
+        const auto lineStart = consumed + nextLine_;
+        const auto lineEnd = (const char*)memchr(
+            data + lineStart,
+            '\n',
+            size - lineStart
+        );
+        if (lineEnd == nullptr) {
+            return true;
+        }
+        const auto line = data + lineStart;
+        size_t length = lineEnd - line;
+        if (
+            (length > 0)
+            && (line[length - 1] == '\r')
+        ) {
+            --length;
+        }
+        if (
+            (length < 3)
+            || (line[0] < '2')
+            || (line[0] > '5')
+            || !IsDigit(line[1])
+            || !IsDigit(line[2])
+        ) {
+            return false;
+        }
+        const unsigned int code = (
+            (line[0] - '0') * 100
+            + (line[1] - '0') * 10
+            + (line[2] - '0')
+        );
+        char separator = ' ';
+        if (length > 3) {
+            separator = line[3];
+            if (
+                (separator != ' ')
+                && (separator != '-')
+            ) {
+                return false;
+            }
+        }
+        if (reply_.numLines == 0) {
+            reply_.code = code;
+            const auto text = line + ((length > 3) ? 4 : 3);
+            const size_t textLength = (line + length) - text;
+            const auto enhancedStatusLength = GetEnhancedStatusLength(text, textLength);
+            enhancedStatusOffset_ = nextLine_ + (text - line);
+            reply_.enhancedStatus.size = enhancedStatusLength;
+            auto skip = enhancedStatusLength;
+            if (
+                (enhancedStatusLength > 0)
+                && (enhancedStatusLength < textLength)
+            ) {
+                ++skip;
+            }
+            textOffset_ = enhancedStatusOffset_ + skip;
+            reply_.text.size = textLength - skip;
+        } else if (code != reply_.code) {
+            return false;
+        }
+        ++reply_.numLines;
+        nextLine_ = (lineEnd + 1 - data) - consumed;
+        if (separator == ' ') {
+            auto reply = reply_;
+            const auto replyStart = data + consumed;
+            reply.enhancedStatus.data = replyStart + enhancedStatusOffset_;
+            reply.text.data = replyStart + textOffset_;
+            reply.lines.data = replyStart;
+            reply.lines.size = nextLine_;
+            consumed += nextLine_;
+            reply_ = Reply();
+            nextLine_ = 0;
+            replyDelegate_(reply);
+        }
+    }
+}
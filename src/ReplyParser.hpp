@@ -0,0 +1,324 @@
+#ifndef NEWMAN_REPLY_PARSER_HPP
+#define NEWMAN_REPLY_PARSER_HPP
+
+/**
+ * @file ReplyParser.hpp
+ *
+ * This module declares the ReplyParser class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * This breaks the data received from an SMTP server into replies
+ * (RFC 5321 section 4.2), including multi-line replies and several
+ * pipelined replies received together.
+ *
+ * Replies are parsed in place: each reply handed out refers to the
+ * data given to the parser rather than to copies of it.  Only a reply
+ * which isn't complete by the end of the data given is copied, into
+ * a buffer kept by the parser and reused for the next reply left
+ * incomplete, so in the usual case of whole replies arriving together,
+ * nothing is copied or allocated.
+ */
+class ReplyParser {
+    // Types
+public:
+    /**
+     * This refers to a piece of text held somewhere else.
+     */
+    struct TextView {
+        /**
+         * This points to the first character of the text.
+         */
+        const char* data = nullptr;
+
+        /**
+         * This is the number of characters in the text.
+         */
+        size_t size = 0;
+
+        /**
+         * Make a copy of the text.
+         *
+         * @return
+         *     A copy of the text is returned.
+         */
+        std::string ToString() const;
+    };
+
+    /**
+     * This is one reply from an SMTP server.  The text it refers to
+     * is only valid during the call to the reply delegate.
+     */
+    struct Reply {
+        /**
+         * This is the three-digit reply code.
+         */
+        unsigned int code = 0;
+
+        /**
+         * This is the enhanced status code (RFC 3463), if any,
+         * at the beginning of the text of the first line.
+         */
+        TextView enhancedStatus;
+
+        /**
+         * This is the text of the first line, after the reply code
+         * and enhanced status code, if any.
+         */
+        TextView text;
+
+        /**
+         * This is the whole reply, including the reply code
+         * and line ending of each line.
+         */
+        TextView lines;
+
+        /**
+         * This is the number of lines in the reply.
+         */
+        size_t numLines = 0;
+    };
+
+    /**
+     * This is the type of function called with each reply parsed.
+     *
+     * @param[in] reply
+     *     This is the reply parsed.
+     */
+    typedef std::function< void(const Reply& reply) > ReplyDelegate;
+
+    /**
+     * These are the SMTP service extensions recognized in the reply
+     * to an EHLO command.
+     */
+    enum class Capability : size_t {
+        Pipelining,
+        Size,
+        EightBitMime,
+        StartTls,
+        Auth,
+        Chunking,
+        BinaryMime,
+        SmtpUtf8,
+        EnhancedStatusCodes,
+        Dsn,
+
+        /**
+         * This is the number of capabilities.
+         */
+        Count,
+    };
+
+    /**
+     * These are the SASL mechanisms recognized in the parameters
+     * of the AUTH capability.
+     */
+    enum class AuthMechanism : size_t {
+        Plain,
+        Login,
+        CramMd5,
+        ScramSha1,
+        ScramSha256,
+        XOAuth2,
+
+        /**
+         * This is the number of mechanisms.
+         */
+        Count,
+    };
+
+    /**
+     * This holds the capabilities an SMTP server listed in its reply
+     * to an EHLO command, along with the parameters Newman uses.
+     */
+    struct Capabilities {
+        /**
+         * This has one bit for each capability listed, at the position
+         * of the capability in the Capability enumeration.
+         */
+        uint32_t supported = 0;
+
+        /**
+         * This has one bit for each SASL mechanism listed as a parameter
+         * of the AUTH capability, at the position of the mechanism in
+         * the AuthMechanism enumeration.
+         */
+        uint32_t authMechanisms = 0;
+
+        /**
+         * This is the largest size of message the server accepts,
+         * in bytes, or zero if the server didn't say.
+         */
+        uint64_t maxSize = 0;
+
+        /**
+         * Check whether or not the given capability was listed.
+         *
+         * @param[in] capability
+         *     This is the capability to check.
+         *
+         * @return
+         *     An indication of whether or not the capability was listed
+         *     is returned.
+         */
+        bool Has(Capability capability) const;
+
+        /**
+         * Check whether or not the given SASL mechanism was listed.
+         *
+         * @param[in] mechanism
+         *     This is the mechanism to check.
+         *
+         * @return
+         *     An indication of whether or not the mechanism was listed
+         *     is returned.
+         */
+        bool Has(AuthMechanism mechanism) const;
+
+        /**
+         * Render the capabilities in a human-readable form.
+         *
+         * @return
+         *     The capabilities in human-readable form are returned.
+         */
+        std::string ToString() const;
+    };
+
+    // Constants
+public:
+    /**
+     * This is the largest reply the parser will hold while waiting
+     * for the rest of it, in bytes.  Anything longer is treated as
+     * a malformed reply.
+     */
+    static constexpr size_t MAX_PENDING_SIZE = 65536;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] replyDelegate
+     *     This is the function to call with each reply parsed.
+     */
+    explicit ReplyParser(ReplyDelegate replyDelegate);
+
+    /**
+     * Parse the given data received from the SMTP server, calling
+     * the reply delegate with each reply completed by it.
+     *
+     * @param[in] data
+     *     This points to the data received.
+     *
+     * @param[in] size
+     *     This is the number of bytes received.
+     *
+     * @return
+     *     An indication of whether or not the data was well formed
+     *     is returned.  Once the data isn't well formed, the parser
+     *     discards everything it holds and starts again with the
+     *     next data given.
+     */
+    bool Parse(
+        const uint8_t* data,
+        size_t size
+    );
+
+    /**
+     * Discard any incomplete reply held by the parser.
+     */
+    void Reset();
+
+    /**
+     * Extract the capabilities listed in the given reply to an EHLO
+     * command.
+     *
+     * @param[in] reply
+     *     This is the reply to the EHLO command.
+     *
+     * @param[out] capabilities
+     *     This is where to store the capabilities listed.
+     *
+     * @return
+     *     An indication of whether or not the reply was a positive
+     *     reply to an EHLO command is returned.
+     */
+    static bool ParseCapabilities(
+        const Reply& reply,
+        Capabilities& capabilities
+    );
+
+    // Private methods
+private:
+    /**
+     * Parse as many whole replies as possible from the given data,
+     * continuing the reply in progress, if any.
+     *
+     * @param[in] data
+     *     This points to the data to parse.
+     *
+     * @param[in] size
+     *     This is the number of bytes to parse.
+     *
+     * @param[out] consumed
+     *     This is where to store the number of bytes making up
+     *     the whole replies parsed.
+     *
+     * @return
+     *     An indication of whether or not the data was well formed
+     *     is returned.
+     */
+    bool Scan(
+        const char* data,
+        size_t size,
+        size_t& consumed
+    );
+
+    // Private properties
+private:
+    /**
+     * This is the function to call with each reply parsed.
+     */
+    ReplyDelegate replyDelegate_;
+
+    /**
+     * This holds the beginning of a reply which wasn't complete
+     * by the end of the data given so far.
+     */
+    std::vector< char > pending_;
+
+    /**
+     * This is the reply in progress.  Its text isn't filled in until
+     * the reply is complete, since the reply may move into the pending
+     * buffer in the meantime.
+     */
+    Reply reply_;
+
+    /**
+     * This is the offset, from the beginning of the reply in progress,
+     * of its enhanced status code.
+     */
+    size_t enhancedStatusOffset_ = 0;
+
+    /**
+     * This is the offset, from the beginning of the reply in progress,
+     * of the text of its first line.
+     */
+    size_t textOffset_ = 0;
+
+    /**
+     * This is the offset, from the beginning of the reply in progress,
+     * of the first line not yet parsed.
+     */
+    size_t nextLine_ = 0;
+};
+
+#endif /* NEWMAN_REPLY_PARSER_HPP */
@@ -0,0 +1,636 @@
+/**
+ * @file Resolver.cpp
+ *
+ * This module contains the implementation of the Resolver class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Resolver.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <SystemAbstractions/NetworkConnection.hpp>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif /* not _WIN32 */
+
+namespace {
+
+    /**
+     * This is the DNS record type of an IPv4 address.
+     */
+    constexpr uint16_t TYPE_A = 1;
+
+    /**
+     * This is the DNS record class of the Internet.
+     */
+    constexpr uint16_t CLASS_IN = 1;
+
+    /**
+     * This is how long to remember that a host has no address,
+     * so that e-mails to it fail quickly rather than each waiting
+     * for another lookup.
+     */
+    constexpr std::chrono::seconds NEGATIVE_CACHE_TIME = std::chrono::seconds(30);
+
+    /**
+     * This is the largest DNS message accepted from the server.
+     */
+    constexpr size_t MAX_MESSAGE_SIZE = 4096;
+
+    /**
+     * This is the longest the worker thread waits for answers
+     * before checking for queries which have timed out.
+     */
+    constexpr int POLL_INTERVAL_MILLISECONDS = 10;
+
+    /**
+     * Return a copy of the given name, with upper-case letters
+     * converted to lower case.
+     */
+    std::string ToLower(const std::string& name) {
+        std::string lower(name);
+        for (auto& c: lower) {
+            if ((c >= 'A') && (c <= 'Z')) {
+                c = c - 'A' + 'a';
+            }
+        }
+        return lower;
+    }
+
+    /**
+     * Parse the given IPv4 address in dotted-decimal form.
+     *
+     * @return
+     *     The address, in host byte order, is returned,
+     *     or zero if the text isn't an IPv4 address.
+     */
+    uint32_t ParseDottedDecimal(const std::string& text) {
+        unsigned int octets[4];
+        char extra;
+        if (
+            sscanf(
+                text.c_str(),
+                "%u.%u.%u.%u%c",
+                &octets[0], &octets[1], &octets[2], &octets[3],
+                &extra
+            ) != 4
+        ) {
+            return 0;
+        }
+        uint32_t address = 0;
+        for (const auto octet: octets) {
+            if (octet > 255) {
+                return 0;
+            }
+            address = (address << 8) | octet;
+        }
+        return address;
+    }
+
+    /**
+     * Append the given 16-bit number to the given message
+     * in network byte order.
+     */
+    void PutUint16(std::vector< uint8_t >& message, uint16_t value) {
+        message.push_back((uint8_t)(value >> 8));
+        message.push_back((uint8_t)value);
+    }
+
+    /**
+     * Return the 16-bit number stored in network byte order
+     * at the given place in a message.
+     */
+    uint16_t GetUint16(const uint8_t* p) {
+        return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+    }
+
+    /**
+     * Build a query for the IPv4 address of the given host.
+     *
+     * @return
+     *     The query is returned, or an empty message if the name
+     *     can't be put in a query.
+     */
+    std::vector< uint8_t > BuildQuery(
+        uint16_t id,
+        const std::string& name
+    ) {
+        std::vector< uint8_t > message;
+        PutUint16(message, id);
+        PutUint16(message, 0x0100); // standard query, recursion desired
+        PutUint16(message, 1); // QDCOUNT
+        PutUint16(message, 0); // ANCOUNT
+        PutUint16(message, 0); // NSCOUNT
+        PutUint16(message, 0); // ARCOUNT
+        size_t begin = 0;
+        while (begin < name.length()) {
+            auto end = name.find('.', begin);
+            if (end == std::string::npos) {
+                end = name.length();
+            }
+            const auto length = end - begin;
+            if (
+                (length == 0)
+                || (length > 63)
+            ) {
+                return {};
+            }
+            message.push_back((uint8_t)length);
+            message.insert(message.end(), name.begin() + begin, name.begin() + end);
+            begin = end + 1;
+        }
+        message.push_back(0);
+        PutUint16(message, TYPE_A);
+        PutUint16(message, CLASS_IN);
+        return message;
+    }
+
+    /**
+     * Read the (possibly compressed) domain name at the given offset
+     * of a message, and move the offset past it.
+     *
+     * @return
+     *     An indication of whether or not a valid name was read
+     *     is returned.
+     */
+    bool ReadName(
+        const uint8_t* message,
+        size_t size,
+        size_t& offset,
+        std::string& name
+    ) {
+        name.clear();
+        auto position = offset;
+        bool jumped = false;
+        for (size_t jumps = 0; jumps < 16;) {
+            if (position >= size) {
+                return false;
+            }
+            const auto length = message[position];
+            if ((length & 0xC0) == 0xC0) {
+                if (position + 1 >= size) {
+                    return false;
+                }
+                if (!jumped) {
+                    offset = position + 2;
+                    jumped = true;
+                }
+                position = (size_t)(((length & 0x3F) << 8) | message[position + 1]);
+                ++jumps;
+            } else if (length == 0) {
+                if (!jumped) {
+                    offset = position + 1;
+                }
+                return true;
+            } else {
+                if (position + 1 + length > size) {
+                    return false;
+                }
+                if (!name.empty()) {
+                    name += '.';
+                }
+                name.append((const char*)message + position + 1, length);
+                position += 1 + length;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * This holds what was learned from an answer to a query.
+     */
+    struct Answer {
+        uint16_t id = 0;
+        std::string name;
+        uint32_t address = 0;
+        uint32_t ttl = 0;
+    };
+
+    /**
+     * Parse an answer to a query for an IPv4 address.
+     *
+     * @return
+     *     An indication of whether or not the message is a valid
+     *     answer is returned.  An answer which says the name has no
+     *     address is valid, and has a zero address.
+     */
+    bool ParseAnswer(
+        const uint8_t* message,
+        size_t size,
+        Answer& answer
+    ) {
+        if (size < 12) {
+            return false;
+        }
+        answer.id = GetUint16(message);
+        const auto flags = GetUint16(message + 2);
+        const auto questions = GetUint16(message + 4);
+        const auto answers = GetUint16(message + 6);
+        if (
+            ((flags & 0x8000) == 0)
+            || (questions != 1)
+        ) {
+            return false;
+        }
+        size_t offset = 12;
+        if (
+            !ReadName(message, size, offset, answer.name)
+            || (offset + 4 > size)
+        ) {
+            return false;
+        }
+        offset += 4;
+        if ((flags & 0x000F) != 0) {
+            return true;
+        }
+        for (size_t i = 0; i < answers; ++i) {
+            std::string name;
+            if (
+                !ReadName(message, size, offset, name)
+                || (offset + 10 > size)
+            ) {
+                return false;
+            }
+            const auto type = GetUint16(message + offset);
+            const auto recordClass = GetUint16(message + offset + 2);
+            const auto ttl = (
+                ((uint32_t)GetUint16(message + offset + 4) << 16)
+                | GetUint16(message + offset + 6)
+            );
+            const auto length = GetUint16(message + offset + 8);
+            offset += 10;
+            if (offset + length > size) {
+                return false;
+            }
+            if (
+                (type == TYPE_A)
+                && (recordClass == CLASS_IN)
+                && (length == 4)
+            ) {
+                answer.address = (
+                    ((uint32_t)message[offset] << 24)
+                    | ((uint32_t)message[offset + 1] << 16)
+                    | ((uint32_t)message[offset + 2] << 8)
+                    | (uint32_t)message[offset + 3]
+                );
+                answer.ttl = ttl;
+                return true;
+            }
+            offset += length;
+        }
+        return true;
+    }
+
+}
+
+std::string Resolver::Stats::ToString() const {
+    return (
+        std::to_string(requests) + " requests, "
+        + std::to_string(cacheHits) + " cached, "
+        + std::to_string(shared) + " shared, "
+        + std::to_string(lookups) + " lookups, "
+        + std::to_string(retransmissions) + " retransmissions, "
+        + std::to_string(failures) + " failures"
+    );
+}
+
+/**
+ * This contains the private properties of a Resolver instance.
+ */
+struct Resolver::Impl {
+    /**
+     * This holds the address of one host, or the lookup of it
+     * in progress.
+     */
+    struct Entry {
+        /**
+         * This becomes ready with the address of the host.
+         */
+        std::shared_future< uint32_t > address;
+
+        /**
+         * This indicates whether or not the lookup is in progress.
+         */
+        bool pending = true;
+
+        /**
+         * This is when the address stops being kept.
+         */
+        std::chrono::steady_clock::time_point expiry;
+    };
+
+    /**
+     * This holds a query sent to the DNS server and not yet answered.
+     */
+    struct Query {
+        /**
+         * This is the name (in lower case) of the host looked up.
+         */
+        std::string name;
+
+        /**
+         * This is the message sent to the DNS server.
+         */
+        std::vector< uint8_t > message;
+
+        /**
+         * This is set with the address of the host once it's known.
+         */
+        std::promise< uint32_t > address;
+
+        /**
+         * This is when to send the query again, or give up on it.
+         */
+        std::chrono::steady_clock::time_point deadline;
+
+        /**
+         * This is the number of times the query may still be sent.
+         */
+        unsigned int attemptsLeft = 0;
+    };
+
+    /**
+     * These are the parameters of the resolver.
+     */
+    Configuration configuration;
+
+    /**
+     * These are the statistics about the lookups made.
+     */
+    Stats stats;
+
+    /**
+     * These are the hosts looked up, keyed by name in lower case.
+     */
+    std::unordered_map< std::string, Entry > entries;
+
+    /**
+     * These are the queries sent to the DNS server and not yet
+     * answered, keyed by query ID.
+     */
+    std::unordered_map< uint16_t, Query > queries;
+
+    /**
+     * This is the ID of the next query to send.
+     */
+    uint16_t nextId = 0;
+
+    /**
+     * This is the operating system handle of the socket used to
+     * talk with the DNS server, or -1 if there is no socket.
+     */
+    int sock = -1;
+
+    /**
+     * This is the thread which sends queries again and receives answers.
+     */
+    std::thread worker;
+
+    /**
+     * This indicates whether or not the worker thread should stop.
+     */
+    bool stopWorker = false;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * Record the address found for the given host.
+     *
+     * @param[in] name
+     *     This is the name (in lower case) of the host.
+     *
+     * @param[in] address
+     *     This is the address of the host, or zero if none was found.
+     *
+     * @param[in] ttl
+     *     This is how long the address may be kept.  It's ignored
+     *     if no address was found.
+     */
+    void Complete(
+        const std::string& name,
+        uint32_t address,
+        std::chrono::seconds ttl
+    ) {
+        auto& entry = entries[name];
+        entry.pending = false;
+        if (address == 0) {
+            ++stats.failures;
+            ttl = NEGATIVE_CACHE_TIME;
+        }
+        entry.expiry = (
+            std::chrono::steady_clock::now()
+            + std::min(ttl, configuration.cacheTime)
+        );
+    }
+
+#ifndef _WIN32
+    /**
+     * Send the given query to the DNS server.
+     */
+    void Send(const Query& query) {
+        (void)send(sock, query.message.data(), query.message.size(), 0);
+    }
+
+    /**
+     * Receive answers from the DNS server and send queries again,
+     * until told to stop.
+     */
+    void Work() {
+        std::vector< uint8_t > buffer(MAX_MESSAGE_SIZE);
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        while (!stopWorker) {
+            lock.unlock();
+            struct pollfd readable = {};
+            readable.fd = sock;
+            readable.events = POLLIN;
+            const auto ready = poll(&readable, 1, POLL_INTERVAL_MILLISECONDS);
+            ssize_t amount = -1;
+            if (ready > 0) {
+                amount = recv(sock, buffer.data(), buffer.size(), MSG_DONTWAIT);
+            }
+            lock.lock();
+            Answer answer;
+            if (
+                (amount > 0)
+                && ParseAnswer(buffer.data(), (size_t)amount, answer)
+            ) {
+                const auto queriesEntry = queries.find(answer.id);
+                if (
+                    (queriesEntry != queries.end())
+                    && (ToLower(answer.name) == queriesEntry->second.name)
+                ) {
+                    Complete(
+                        queriesEntry->second.name,
+                        answer.address,
+                        std::chrono::seconds(answer.ttl)
+                    );
+                    queriesEntry->second.address.set_value(answer.address);
+                    queries.erase(queriesEntry);
+                }
+            }
+            const auto now = std::chrono::steady_clock::now();
+            for (auto it = queries.begin(); it != queries.end();) {
+                auto& query = it->second;
+                if (query.deadline > now) {
+                    ++it;
+                } else if (query.attemptsLeft > 0) {
+                    --query.attemptsLeft;
+                    ++stats.retransmissions;
+                    query.deadline = now + configuration.timeout;
+                    Send(query);
+                    ++it;
+                } else {
+                    Complete(query.name, 0, std::chrono::seconds(0));
+                    query.address.set_value(0);
+                    it = queries.erase(it);
+                }
+            }
+        }
+        for (auto& queriesEntry: queries) {
+            queriesEntry.second.address.set_value(0);
+        }
+        queries.clear();
+    }
+#endif /* not _WIN32 */
+};
+
+Resolver::~Resolver() noexcept {
+    if (impl_->worker.joinable()) {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            impl_->stopWorker = true;
+        }
+        impl_->worker.join();
+    }
+#ifndef _WIN32
+    if (impl_->sock >= 0) {
+        (void)close(impl_->sock);
+    }
+#endif /* not _WIN32 */
+}
+
+Resolver::Resolver()
+    : impl_(new Impl())
+{
+    impl_->nextId = (uint16_t)std::random_device()();
+}
+
+bool Resolver::Configure(const Configuration& configuration) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->configuration = configuration;
+    if (
+        (configuration.server == 0)
+        || (impl_->sock >= 0)
+    ) {
+        return true;
+    }
+#ifndef _WIN32
+    const auto sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        return false;
+    }
+    struct sockaddr_in server = {};
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(configuration.server);
+    server.sin_port = htons(configuration.port);
+    if (connect(sock, (struct sockaddr*)&server, sizeof(server)) != 0) {
+        (void)close(sock);
+        return false;
+    }
+    impl_->sock = sock;
+    const auto impl = impl_.get();
+    impl_->worker = std::thread([impl]{ impl->Work(); });
+    return true;
+#else /* _WIN32 */
+    return false;
+#endif /* not _WIN32 / _WIN32 */
+}
+
+void Resolver::Prefetch(const std::string& hostName) {
+    (void)Resolve(hostName);
+}
+
+std::shared_future< uint32_t > Resolver::Resolve(const std::string& hostName) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    ++impl_->stats.requests;
+    const auto literal = ParseDottedDecimal(hostName);
+    if (literal != 0) {
+        std::promise< uint32_t > address;
+        address.set_value(literal);
+        return address.get_future().share();
+    }
+    const auto name = ToLower(hostName);
+    const auto entriesEntry = impl_->entries.find(name);
+    if (entriesEntry != impl_->entries.end()) {
+        if (entriesEntry->second.pending) {
+            ++impl_->stats.shared;
+            return entriesEntry->second.address;
+        }
+        if (entriesEntry->second.expiry > std::chrono::steady_clock::now()) {
+            ++impl_->stats.cacheHits;
+            return entriesEntry->second.address;
+        }
+    }
+    ++impl_->stats.lookups;
+    auto& entry = impl_->entries[name];
+    entry.pending = true;
+#ifndef _WIN32
+    if (impl_->sock >= 0) {
+        auto id = impl_->nextId;
+        while (impl_->queries.find(id) != impl_->queries.end()) {
+            ++id;
+        }
+        impl_->nextId = id + 1;
+        Impl::Query query;
+        query.name = name;
+        query.message = BuildQuery(id, name);
+        entry.address = query.address.get_future().share();
+        if (query.message.empty()) {
+            impl_->Complete(name, 0, std::chrono::seconds(0));
+            query.address.set_value(0);
+            return entry.address;
+        }
+        query.deadline = std::chrono::steady_clock::now() + impl_->configuration.timeout;
+        query.attemptsLeft = std::max(impl_->configuration.attempts, 1u) - 1;
+        impl_->Send(query);
+        impl_->queries[id] = std::move(query);
+        return entry.address;
+    }
+#endif /* not _WIN32 */
+    const auto address = std::make_shared< std::promise< uint32_t > >();
+    entry.address = address->get_future().share();
+    const std::weak_ptr< Impl > implWeak(impl_);
+    std::thread(
+        [implWeak, hostName, name, address]{
+            const auto result = SystemAbstractions::NetworkConnection::GetAddressOfHost(hostName);
+            const auto impl = implWeak.lock();
+            if (impl != nullptr) {
+                std::lock_guard< decltype(impl->mutex) > lock(impl->mutex);
+                impl->Complete(name, result, impl->configuration.cacheTime);
+            }
+            address->set_value(result);
+        }
+    ).detach();
+    return entry.address;
+}
+
+auto Resolver::GetStats() const -> Stats {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->stats;
+}
@@ -0,0 +1,189 @@
+#ifndef NEWMAN_RESOLVER_HPP
+#define NEWMAN_RESOLVER_HPP
+
+/**
+ * @file Resolver.hpp
+ *
+ * This module declares the Resolver class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+/**
+ * This looks up the IPv4 addresses of host names without blocking
+ * the caller, so that the addresses of all the SMTP servers of a batch
+ * can be looked up at the same time, as soon as the batch is known,
+ * rather than one after another as each server is connected.
+ *
+ * Lookups of a name already being looked up share the lookup in
+ * progress, and addresses found are kept for a while, so each name is
+ * looked up at most once at a time.
+ *
+ * Given the address of a DNS server, the resolver sends its own queries
+ * over UDP, all from one socket served by one thread, retransmitting
+ * queries which aren't answered in time.  Otherwise, each lookup calls
+ * the system resolver on a thread of its own.
+ */
+class Resolver {
+    // Types
+public:
+    /**
+     * This holds the parameters of the resolver.
+     */
+    struct Configuration {
+        /**
+         * This is the IPv4 address, in host byte order, of the DNS server
+         * to query, or zero to use the system resolver instead.
+         */
+        uint32_t server = 0;
+
+        /**
+         * This is the port number of the DNS server to query.
+         */
+        uint16_t port = 53;
+
+        /**
+         * This is how long to wait for the DNS server to answer a query
+         * before sending it again.
+         */
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(1000);
+
+        /**
+         * This is the number of times to send a query before
+         * giving up on it.
+         */
+        unsigned int attempts = 3;
+
+        /**
+         * This is the longest time to keep an address found.  Addresses
+         * from the DNS server are kept no longer than their time to live.
+         */
+        std::chrono::seconds cacheTime = std::chrono::seconds(300);
+    };
+
+    /**
+     * This holds statistics about the lookups made.
+     */
+    struct Stats {
+        /**
+         * This is the number of addresses requested.
+         */
+        uint64_t requests = 0;
+
+        /**
+         * This is the number of requests answered from addresses kept.
+         */
+        uint64_t cacheHits = 0;
+
+        /**
+         * This is the number of requests which shared a lookup
+         * already in progress.
+         */
+        uint64_t shared = 0;
+
+        /**
+         * This is the number of lookups started.
+         */
+        uint64_t lookups = 0;
+
+        /**
+         * This is the number of queries sent again because they
+         * weren't answered in time.
+         */
+        uint64_t retransmissions = 0;
+
+        /**
+         * This is the number of lookups which found no address.
+         */
+        uint64_t failures = 0;
+
+        /**
+         * Render the statistics in a human-readable form.
+         *
+         * @return
+         *     The statistics in human-readable form are returned.
+         */
+        std::string ToString() const;
+    };
+
+    // Lifecycle management
+public:
+    ~Resolver() noexcept;
+    Resolver(const Resolver&) = delete;
+    Resolver(Resolver&&) noexcept = delete;
+    Resolver& operator=(const Resolver&) = delete;
+    Resolver& operator=(Resolver&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     */
+    Resolver();
+
+    /**
+     * Set the parameters of the resolver.  This should be done
+     * before any lookups are made.
+     *
+     * @param[in] configuration
+     *     These are the parameters of the resolver.
+     *
+     * @return
+     *     An indication of whether or not the resolver is ready
+     *     to make lookups is returned.
+     */
+    bool Configure(const Configuration& configuration);
+
+    /**
+     * Start looking up the address of the given host, if it isn't
+     * already known or being looked up, without waiting for it.
+     *
+     * @param[in] hostName
+     *     This is the name (or address, in dotted-decimal form)
+     *     of the host to look up.
+     */
+    void Prefetch(const std::string& hostName);
+
+    /**
+     * Look up the address of the given host.
+     *
+     * @param[in] hostName
+     *     This is the name (or address, in dotted-decimal form)
+     *     of the host to look up.
+     *
+     * @return
+     *     A future is returned which becomes ready with the IPv4 address
+     *     of the host, in host byte order, or zero if none was found.
+     */
+    std::shared_future< uint32_t > Resolve(const std::string& hostName);
+
+    /**
+     * Return statistics about the lookups made.
+     *
+     * @return
+     *     Statistics about the lookups made are returned.
+     */
+    Stats GetStats() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_RESOLVER_HPP */
@@ -0,0 +1,327 @@
+/**
+ * @file RoutingTable.cpp
+ *
+ * This module contains the implementation of the RoutingTable class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "RoutingTable.hpp"
+
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is used in place of a route index where there is no route.
+     */
+    constexpr size_t NO_ROUTE = (size_t)-1;
+
+    /**
+     * This is one SMTP server of a route.
+     */
+    struct Server {
+        std::string hostName;
+        std::string port;
+    };
+
+    /**
+     * This is where to send the e-mails matching a selector.
+     */
+    struct Route {
+        /**
+         * These are the SMTP servers among which e-mails are spread.
+         */
+        std::vector< Server > servers;
+
+        std::string username;
+        std::string password;
+    };
+
+    /**
+     * This is one node of a trie of domains, keyed by domain
+     * labels in reverse order.
+     */
+    struct DomainNode {
+        /**
+         * These are the nodes of the subdomains of this node's domain,
+         * keyed by their leftmost label.
+         */
+        std::unordered_map< std::string, std::unique_ptr< DomainNode > > children;
+
+        /**
+         * This is the index of the route of this node's domain,
+         * or NO_ROUTE if it has none.
+         */
+        size_t route = NO_ROUTE;
+    };
+
+    /**
+     * Return a copy of the given text, with upper-case letters
+     * converted to lower case.
+     */
+    std::string ToLower(const std::string& text) {
+        std::string lower(text);
+        for (auto& c: lower) {
+            if ((c >= 'A') && (c <= 'Z')) {
+                c = c - 'A' + 'a';
+            }
+        }
+        return lower;
+    }
+
+    /**
+     * Add the route with the given index to the given domain trie.
+     *
+     * @return
+     *     An indication of whether or not the domain was added is returned.
+     *     It isn't if the domain is empty or already has a route.
+     */
+    bool AddDomain(
+        DomainNode& root,
+        const std::string& domain,
+        size_t route
+    ) {
+        if (domain.empty()) {
+            return false;
+        }
+        auto node = &root;
+        auto end = domain.length();
+        while (end > 0) {
+            const auto dot = domain.rfind('.', end - 1);
+            const auto begin = (dot == std::string::npos) ? 0 : dot + 1;
+            auto& child = node->children[domain.substr(begin, end - begin)];
+            if (child == nullptr) {
+                child.reset(new DomainNode());
+            }
+            node = child.get();
+            end = (dot == std::string::npos) ? 0 : dot;
+        }
+        if (node->route != NO_ROUTE) {
+            return false;
+        }
+        node->route = route;
+        return true;
+    }
+
+    /**
+     * Return the index of the route of the most specific domain
+     * in the given trie which is the given domain or one of its parents.
+     *
+     * @return
+     *     The index of the route is returned, or NO_ROUTE if no domain
+     *     in the trie matches.
+     */
+    size_t FindDomain(
+        const DomainNode& root,
+        const std::string& domain
+    ) {
+        auto node = &root;
+        auto route = root.route;
+        auto end = domain.length();
+        std::string label;
+        while (end > 0) {
+            const auto dot = domain.rfind('.', end - 1);
+            const auto begin = (dot == std::string::npos) ? 0 : dot + 1;
+            label.assign(domain, begin, end - begin);
+            const auto child = node->children.find(label);
+            if (child == node->children.end()) {
+                break;
+            }
+            node = child->second.get();
+            if (node->route != NO_ROUTE) {
+                route = node->route;
+            }
+            end = (dot == std::string::npos) ? 0 : dot;
+        }
+        return route;
+    }
+
+    /**
+     * Parse the given list of servers, separated by commas,
+     * each in the form HOST:PORT.
+     *
+     * @return
+     *     An indication of whether or not the list was parsed
+     *     is returned.
+     */
+    bool ParseServers(
+        const std::string& text,
+        std::vector< Server >& servers
+    ) {
+        size_t begin = 0;
+        while (begin <= text.length()) {
+            auto end = text.find(',', begin);
+            if (end == std::string::npos) {
+                end = text.length();
+            }
+            const auto server = text.substr(begin, end - begin);
+            const auto colon = server.rfind(':');
+            if (
+                (colon == std::string::npos)
+                || (colon == 0)
+                || (colon + 1 == server.length())
+                || (
+                    server.find_first_not_of("0123456789", colon + 1)
+                    != std::string::npos
+                )
+            ) {
+                return false;
+            }
+            servers.push_back({server.substr(0, colon), server.substr(colon + 1)});
+            begin = end + 1;
+        }
+        return true;
+    }
+
+}
+
+/**
+ * This contains the private properties of a RoutingTable instance.
+ */
+struct RoutingTable::Impl {
+    /**
+     * These are all the routes in the table.
+     */
+    std::vector< Route > routes;
+
+    /**
+     * These are the indexes of the routes selected by tenant.
+     */
+    std::unordered_map< std::string, size_t > tenants;
+
+    /**
+     * This is the trie of the routes selected by sender domain.
+     */
+    DomainNode senders;
+
+    /**
+     * This is the trie of the routes selected by recipient domain.
+     */
+    DomainNode recipients;
+
+    /**
+     * This is the index of the default route, or NO_ROUTE
+     * if there is none.
+     */
+    size_t defaultRoute = NO_ROUTE;
+};
+
+RoutingTable::~RoutingTable() noexcept = default;
+
+RoutingTable::RoutingTable()
+    : impl_(new Impl())
+{
+}
+
+bool RoutingTable::Load(
+    const std::string& path,
+    std::string& error
+) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "unable to open file";
+        return false;
+    }
+    std::unique_ptr< Impl > impl(new Impl());
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string selector;
+        std::string servers;
+        if (
+            !(fields >> selector)
+            || (selector[0] == '#')
+        ) {
+            continue;
+        }
+        Route route;
+        if (
+            !(fields >> servers)
+            || !ParseServers(servers, route.servers)
+        ) {
+            error = "line " + std::to_string(lineNumber) + ": expected HOST:PORT[,HOST:PORT...]";
+            return false;
+        }
+        (void)(fields >> route.username >> route.password);
+        const auto index = impl->routes.size();
+        impl->routes.push_back(std::move(route));
+        const auto colon = selector.find(':');
+        const auto kind = selector.substr(0, colon);
+        const auto value = (
+            (colon == std::string::npos)
+            ? std::string()
+            : ToLower(selector.substr(colon + 1))
+        );
+        bool added;
+        if (selector == "*") {
+            added = (impl->defaultRoute == NO_ROUTE);
+            impl->defaultRoute = index;
+        } else if (kind == "tenant") {
+            added = (
+                !value.empty()
+                && impl->tenants.insert({value, index}).second
+            );
+        } else if (kind == "sender") {
+            added = AddDomain(impl->senders, value, index);
+        } else if (kind == "recipient") {
+            added = AddDomain(impl->recipients, value, index);
+        } else {
+            error = "line " + std::to_string(lineNumber) + ": unknown selector '" + selector + "'";
+            return false;
+        }
+        if (!added) {
+            error = "line " + std::to_string(lineNumber) + ": duplicate or empty selector '" + selector + "'";
+            return false;
+        }
+    }
+    impl_ = std::move(impl);
+    return true;
+}
+
+bool RoutingTable::Find(
+    const std::string& tenant,
+    const std::string& senderDomain,
+    const std::string& recipientDomain,
+    Destination& destination
+) const {
+    const auto lowerRecipientDomain = ToLower(recipientDomain);
+    auto route = NO_ROUTE;
+    if (!tenant.empty()) {
+        const auto tenantsEntry = impl_->tenants.find(ToLower(tenant));
+        if (tenantsEntry != impl_->tenants.end()) {
+            route = tenantsEntry->second;
+        }
+    }
+    if (route == NO_ROUTE) {
+        route = FindDomain(impl_->senders, ToLower(senderDomain));
+    }
+    if (route == NO_ROUTE) {
+        route = FindDomain(impl_->recipients, lowerRecipientDomain);
+    }
+    if (route == NO_ROUTE) {
+        route = impl_->defaultRoute;
+    }
+    if (route == NO_ROUTE) {
+        return false;
+    }
+    const auto& chosen = impl_->routes[route];
+    const auto& server = chosen.servers[
+        std::hash< std::string >()(lowerRecipientDomain) % chosen.servers.size()
+    ];
+    destination.hostName = server.hostName;
+    destination.port = server.port;
+    destination.username = chosen.username;
+    destination.password = chosen.password;
+    return true;
+}
+
+size_t RoutingTable::GetSize() const {
+    return impl_->routes.size();
+}
@@ -0,0 +1,153 @@
+#ifndef NEWMAN_ROUTING_TABLE_HPP
+#define NEWMAN_ROUTING_TABLE_HPP
+
+/**
+ * @file RoutingTable.hpp
+ *
+ * This module declares the RoutingTable class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <memory>
+#include <stddef.h>
+#include <string>
+
+/**
+ * This decides which SMTP server (and credentials) to use for an e-mail,
+ * based on its tenant, the domain of its sender, and the domain of its
+ * recipient, so that the e-mail itself doesn't need to carry them.
+ *
+ * Routes are loaded from a text file with one route per line:
+ *
+ *     SELECTOR HOST:PORT[,HOST:PORT...] [USERNAME [PASSWORD]]
+ *
+ * where SELECTOR is one of `tenant:NAME`, `sender:DOMAIN`,
+ * `recipient:DOMAIN`, or `*` (the default route).  Blank lines and lines
+ * beginning with `#` are ignored.  A domain selector matches the domain
+ * and all of its subdomains, and the most specific match wins.
+ *
+ * When loaded, the domain selectors are compiled into tries keyed by
+ * domain labels in reverse order (com, example, mail, ...), so looking up
+ * a route takes one step per label of the domain, no matter how many
+ * routes there are.
+ */
+class RoutingTable {
+    // Types
+public:
+    /**
+     * This is where to send an e-mail, and how to log in.
+     */
+    struct Destination {
+        /**
+         * This is the host name of the SMTP server.
+         */
+        std::string hostName;
+
+        /**
+         * This is the port number of the SMTP server, as text.
+         */
+        std::string port;
+
+        /**
+         * This is the username to use to log in to the SMTP server.
+         */
+        std::string username;
+
+        /**
+         * This is the password to use to log in to the SMTP server.
+         */
+        std::string password;
+    };
+
+    // Lifecycle management
+public:
+    ~RoutingTable() noexcept;
+    RoutingTable(const RoutingTable&) = delete;
+    RoutingTable(RoutingTable&&) noexcept = delete;
+    RoutingTable& operator=(const RoutingTable&) = delete;
+    RoutingTable& operator=(RoutingTable&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     */
+    RoutingTable();
+
+    /**
+     * Replace the routes in the table with the routes
+     * in the given file.
+     *
+     * @param[in] path
+     *     This is the path to the file from which to load routes.
+     *
+     * @param[out] error
+     *     This is where to store a description of what was wrong
+     *     with the file, if it couldn't be loaded.
+     *
+     * @return
+     *     An indication of whether or not the routes were loaded
+     *     is returned.
+     */
+    bool Load(
+        const std::string& path,
+        std::string& error
+    );
+
+    /**
+     * Find the route for an e-mail with the given properties.
+     * A tenant route is preferred over a sender route, which is
+     * preferred over a recipient route, which is preferred over
+     * the default route.  If the route has several servers, the one
+     * used is chosen by the recipient domain, so that e-mails to the
+     * same domain go through the same server.
+     *
+     * @param[in] tenant
+     *     This identifies the tenant for whom the e-mail is sent,
+     *     or is empty if there is none.
+     *
+     * @param[in] senderDomain
+     *     This is the domain of the sender of the e-mail.
+     *
+     * @param[in] recipientDomain
+     *     This is the domain of the recipient of the e-mail.
+     *
+     * @param[out] destination
+     *     This is where to store where to send the e-mail.
+     *
+     * @return
+     *     An indication of whether or not a route was found
+     *     is returned.
+     */
+    bool Find(
+        const std::string& tenant,
+        const std::string& senderDomain,
+        const std::string& recipientDomain,
+        Destination& destination
+    ) const;
+
+    /**
+     * Return the number of routes in the table.
+     *
+     * @return
+     *     The number of routes in the table is returned.
+     */
+    size_t GetSize() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_ROUTING_TABLE_HPP */
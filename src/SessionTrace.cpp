@@ -0,0 +1,203 @@
+/**
+ * @file SessionTrace.cpp
+ *
+ * This module contains the implementation of the functions and types
+ * used to record and read back SMTP sessions.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "SessionTrace.hpp"
+
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+    /**
+     * This is written at the beginning of every trace file, to identify
+     * the format (and its version).
+     */
+    constexpr char SIGNATURE[8] = {'N', 'W', 'M', 'N', 'T', 'R', 'C', '1'};
+
+    /**
+     * This is the largest amount of data accepted for one event
+     * when reading a trace file, to avoid trying to allocate absurd
+     * amounts of memory for a corrupt file.
+     */
+    constexpr uint64_t MAX_EVENT_DATA = 64 * 1024 * 1024;
+
+    /**
+     * Append the given number to the given buffer,
+     * in unsigned LEB128 form.
+     *
+     * @param[in,out] buffer
+     *     This is the buffer to which to append the number.
+     *
+     * @param[in] value
+     *     This is the number to append.
+     */
+    void AppendVarint(std::vector< uint8_t >& buffer, uint64_t value) {
+        while (value >= 0x80) {
+            buffer.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back((uint8_t)value);
+    }
+
+    /**
+     * Read a number in unsigned LEB128 form from the given file.
+     *
+     * @param[in] file
+     *     This is the file from which to read the number.
+     *
+     * @param[out] value
+     *     This is where to store the number read.
+     *
+     * @return
+     *     An indication of whether or not a whole number
+     *     was read is returned.
+     */
+    bool ReadVarint(FILE* file, uint64_t& value) {
+        value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+            const auto next = fgetc(file);
+            if (next == EOF) {
+                return false;
+            }
+            value |= ((uint64_t)(next & 0x7F) << shift);
+            if ((next & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+}
+
+/**
+ * This contains the private properties of a SessionTraceWriter instance.
+ */
+struct SessionTraceWriter::Impl {
+    /**
+     * This is the trace file, or nullptr if it isn't open.
+     */
+    FILE* file = nullptr;
+
+    /**
+     * This is when the previous event was recorded.
+     */
+    std::chrono::steady_clock::time_point lastEvent;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    std::mutex mutex;
+};
+
+SessionTraceWriter::~SessionTraceWriter() noexcept {
+    if (impl_->file != nullptr) {
+        (void)fclose(impl_->file);
+    }
+}
+
+SessionTraceWriter::SessionTraceWriter()
+    : impl_(new Impl())
+{
+}
+
+bool SessionTraceWriter::Open(const std::string& fileName) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->file != nullptr) {
+        (void)fclose(impl_->file);
+    }
+    impl_->file = fopen(fileName.c_str(), "wb");
+    if (impl_->file == nullptr) {
+        return false;
+    }
+    if (fwrite(SIGNATURE, sizeof(SIGNATURE), 1, impl_->file) != 1) {
+        (void)fclose(impl_->file);
+        impl_->file = nullptr;
+        return false;
+    }
+    impl_->lastEvent = std::chrono::steady_clock::now();
+    return true;
+}
+
+void SessionTraceWriter::Record(
+    TraceEventType type,
+    const std::vector< uint8_t >& data
+) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->file == nullptr) {
+        return;
+    }
+    std::vector< uint8_t > record;
+    record.reserve(data.size() + 21);
+    record.push_back((uint8_t)type);
+    AppendVarint(
+        record,
+        (uint64_t)std::chrono::duration_cast< std::chrono::microseconds >(
+            now - impl_->lastEvent
+        ).count()
+    );
+    AppendVarint(record, data.size());
+    record.insert(record.end(), data.begin(), data.end());
+    impl_->lastEvent = now;
+    (void)fwrite(record.data(), record.size(), 1, impl_->file);
+
+    // Flush each event, so that the trace of a session is complete
+    // even if the program is killed before it finishes.
+    (void)fflush(impl_->file);
+}
+
+bool ReadSessionTrace(
+    const std::string& fileName,
+    std::vector< TraceEvent >& events
+) {
+    events.clear();
+    const auto file = fopen(fileName.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char signature[sizeof(SIGNATURE)];
+    if (
+        (fread(signature, sizeof(signature), 1, file) != 1)
+        || (memcmp(signature, SIGNATURE, sizeof(SIGNATURE)) != 0)
+    ) {
+        (void)fclose(file);
+        return false;
+    }
+    bool success = true;
+    for (;;) {
+        const auto type = fgetc(file);
+        if (type == EOF) {
+            break;
+        }
+        TraceEvent event;
+        uint64_t length;
+        if (
+            (type > (int)TraceEventType::Closed)
+            || !ReadVarint(file, event.delay)
+            || !ReadVarint(file, length)
+            || (length > MAX_EVENT_DATA)
+        ) {
+            success = false;
+            break;
+        }
+        event.type = (TraceEventType)type;
+        event.data.resize((size_t)length);
+        if (
+            (length > 0)
+            && (fread(event.data.data(), (size_t)length, 1, file) != 1)
+        ) {
+            success = false;
+            break;
+        }
+        events.push_back(std::move(event));
+    }
+    (void)fclose(file);
+    return success;
+}
@@ -0,0 +1,154 @@
+#ifndef NEWMAN_SESSION_TRACE_HPP
+#define NEWMAN_SESSION_TRACE_HPP
+
+/**
+ * @file SessionTrace.hpp
+ *
+ * This module declares the functions and types used to record and read
+ * back the bytes exchanged during an SMTP session, and when they were
+ * exchanged.
+ *
+ * A trace file begins with an eight-byte signature, followed by
+ * one record per event.  Each record is the event type (one byte),
+ * the number of microseconds since the previous event, and the number
+ * of bytes of data, both as unsigned LEB128 integers, followed by
+ * the data.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * This identifies the kind of an event in an SMTP session.
+ */
+enum class TraceEventType : uint8_t {
+    /**
+     * The connection (including any TLS handshake) was made.
+     */
+    Connected = 0,
+
+    /**
+     * The client sent data to the server.
+     */
+    ClientData = 1,
+
+    /**
+     * The server sent data to the client.
+     */
+    ServerData = 2,
+
+    /**
+     * The connection was closed or broken.
+     */
+    Closed = 3,
+};
+
+/**
+ * This is one event in an SMTP session.
+ */
+struct TraceEvent {
+    /**
+     * This identifies the kind of event.
+     */
+    TraceEventType type = TraceEventType::Closed;
+
+    /**
+     * This is the number of microseconds since the previous event,
+     * or since the start of the session for the first event.
+     */
+    uint64_t delay = 0;
+
+    /**
+     * These are the bytes exchanged, for data events.  When the session
+     * is protected by TLS, these are the decrypted bytes, one event per
+     * chunk delivered by the TLS layer.
+     */
+    std::vector< uint8_t > data;
+};
+
+/**
+ * This is used to record the events of an SMTP session to a trace file.
+ * Events may be recorded from any thread.
+ */
+class SessionTraceWriter {
+    // Lifecycle management
+public:
+    ~SessionTraceWriter() noexcept;
+    SessionTraceWriter(const SessionTraceWriter&) = delete;
+    SessionTraceWriter(SessionTraceWriter&&) noexcept = delete;
+    SessionTraceWriter& operator=(const SessionTraceWriter&) = delete;
+    SessionTraceWriter& operator=(SessionTraceWriter&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     */
+    SessionTraceWriter();
+
+    /**
+     * Create the trace file and begin the session.  Delays of
+     * recorded events are measured from the time this is called.
+     *
+     * @param[in] fileName
+     *     This is the path to the trace file to create.
+     *
+     * @return
+     *     An indication of whether or not the trace file
+     *     was created is returned.
+     */
+    bool Open(const std::string& fileName);
+
+    /**
+     * Record an event which just happened.
+     *
+     * @param[in] type
+     *     This identifies the kind of event.
+     *
+     * @param[in] data
+     *     These are the bytes exchanged, for data events.
+     */
+    void Record(
+        TraceEventType type,
+        const std::vector< uint8_t >& data = std::vector< uint8_t >()
+    );
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr< Impl > impl_;
+};
+
+/**
+ * Read all the events recorded in the given trace file.
+ *
+ * @param[in] fileName
+ *     This is the path to the trace file to read.
+ *
+ * @param[out] events
+ *     This is where to store the events read.
+ *
+ * @return
+ *     An indication of whether or not the trace file was read
+ *     successfully is returned.
+ */
+bool ReadSessionTrace(
+    const std::string& fileName,
+    std::vector< TraceEvent >& events
+);
+
+#endif /* NEWMAN_SESSION_TRACE_HPP */
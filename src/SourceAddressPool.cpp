@@ -0,0 +1,131 @@
+/**
+ * @file SourceAddressPool.cpp
+ *
+ * This module contains the implementation of the SourceAddressPool class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "SourceAddressPool.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace {
+
+    /**
+     * This is how long to stop using an address after it runs out
+     * of ephemeral ports.
+     */
+    constexpr auto EXHAUSTION_BACKOFF = std::chrono::seconds(10);
+
+}
+
+constexpr size_t SourceAddressPool::NONE;
+
+void SourceAddressPool::Configure(
+    const std::vector< uint32_t >& addresses,
+    Selection selection,
+    size_t maxConnectionsPerAddress
+) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    selection_ = selection;
+    maxConnectionsPerAddress_ = maxConnectionsPerAddress;
+    sources_.clear();
+    for (const auto address: addresses) {
+        Source source;
+        source.address = address;
+        sources_.push_back(source);
+    }
+    next_ = 0;
+}
+
+bool SourceAddressPool::IsEmpty() const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    return sources_.empty();
+}
+
+size_t SourceAddressPool::Acquire() {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    auto chosen = NONE;
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        const auto index = (next_ + i) % sources_.size();
+        const auto& source = sources_[index];
+        if (
+            (now < source.exhaustedUntil)
+            || (
+                (maxConnectionsPerAddress_ > 0)
+                && (source.open >= maxConnectionsPerAddress_)
+            )
+        ) {
+            continue;
+        }
+        if (
+            (chosen == NONE)
+            || (
+                (selection_ == Selection::LeastLoaded)
+                && (source.open < sources_[chosen].open)
+            )
+        ) {
+            chosen = index;
+            if (selection_ == Selection::RoundRobin) {
+                break;
+            }
+        }
+    }
+    if (chosen != NONE) {
+        ++sources_[chosen].open;
+        ++sources_[chosen].connections;
+        next_ = (chosen + 1) % sources_.size();
+    }
+    return chosen;
+}
+
+void SourceAddressPool::Release(size_t index) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    if (sources_[index].open > 0) {
+        --sources_[index].open;
+    }
+}
+
+void SourceAddressPool::MarkExhausted(size_t index) {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    auto& source = sources_[index];
+    if (source.open > 0) {
+        --source.open;
+    }
+    ++source.exhaustions;
+    source.exhaustedUntil = std::chrono::steady_clock::now() + EXHAUSTION_BACKOFF;
+}
+
+uint32_t SourceAddressPool::GetAddress(size_t index) const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    return sources_[index].address;
+}
+
+std::string SourceAddressPool::Summarize() const {
+    std::lock_guard< decltype(mutex_) > lock(mutex_);
+    std::string summary;
+    for (const auto& source: sources_) {
+        char buffer[128];
+        (void)snprintf(
+            buffer,
+            sizeof(buffer),
+            (
+                "%s%" PRIu32 ".%" PRIu32 ".%" PRIu32 ".%" PRIu32
+                ": connections=%" PRIu64 " open=%zu port-exhaustions=%" PRIu64
+            ),
+            (summary.empty() ? "" : "; "),
+            (source.address >> 24) & 0xFF,
+            (source.address >> 16) & 0xFF,
+            (source.address >> 8) & 0xFF,
+            source.address & 0xFF,
+            source.connections,
+            source.open,
+            source.exhaustions
+        );
+        summary += buffer;
+    }
+    return summary;
+}
@@ -0,0 +1,170 @@
+#ifndef NEWMAN_SOURCE_ADDRESS_POOL_HPP
+#define NEWMAN_SOURCE_ADDRESS_POOL_HPP
+
+/**
+ * @file SourceAddressPool.hpp
+ *
+ * This module declares the SourceAddressPool class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * This is used to spread outgoing connections across a set of local
+ * addresses, keeping track of how many connections use each one.
+ */
+class SourceAddressPool {
+    // Types
+public:
+    /**
+     * This selects how the next local address to use is chosen.
+     */
+    enum class Selection {
+        /**
+         * Use each address in turn.
+         */
+        RoundRobin,
+
+        /**
+         * Use the address with the fewest connections open.
+         */
+        LeastLoaded,
+    };
+
+    // Constants
+public:
+    /**
+     * This is returned by Acquire when no address may be used.
+     */
+    static constexpr size_t NONE = (size_t)-1;
+
+    // Public methods
+public:
+    /**
+     * Set up the pool.
+     *
+     * @param[in] addresses
+     *     These are the local IPv4 addresses, in host byte order,
+     *     to which outgoing connections may be bound.
+     *
+     * @param[in] selection
+     *     This selects how the next address to use is chosen.
+     *
+     * @param[in] maxConnectionsPerAddress
+     *     This is the maximum number of connections which may be open
+     *     from any one address, or zero for no limit.
+     */
+    void Configure(
+        const std::vector< uint32_t >& addresses,
+        Selection selection,
+        size_t maxConnectionsPerAddress
+    );
+
+    /**
+     * Return an indication of whether or not any addresses are
+     * in the pool.
+     *
+     * @return
+     *     An indication of whether or not any addresses are
+     *     in the pool is returned.
+     */
+    bool IsEmpty() const;
+
+    /**
+     * Choose the address to which to bind the next connection,
+     * and count the connection as open from it.
+     *
+     * @return
+     *     The index of the chosen address is returned.
+     *
+     * @retval NONE
+     *     This is returned if every address is either at its connection
+     *     limit or has recently run out of ephemeral ports.
+     */
+    size_t Acquire();
+
+    /**
+     * Count one fewer connection as open from the given address.
+     *
+     * @param[in] index
+     *     This is the index of the address, as returned by Acquire.
+     */
+    void Release(size_t index);
+
+    /**
+     * Stop using the given address for a while, because it has run out
+     * of ephemeral ports, and count one fewer connection as open from it.
+     *
+     * @param[in] index
+     *     This is the index of the address, as returned by Acquire.
+     */
+    void MarkExhausted(size_t index);
+
+    /**
+     * Return the address with the given index.
+     *
+     * @param[in] index
+     *     This is the index of the address, as returned by Acquire.
+     *
+     * @return
+     *     The address, in host byte order, is returned.
+     */
+    uint32_t GetAddress(size_t index) const;
+
+    /**
+     * Summarize how each address has been used, in human-readable form.
+     *
+     * @return
+     *     A summary of how each address has been used is returned.
+     */
+    std::string Summarize() const;
+
+    // Private properties
+private:
+    /**
+     * This holds what is known about one local address.
+     */
+    struct Source {
+        uint32_t address = 0;
+        size_t open = 0;
+        uint64_t connections = 0;
+        uint64_t exhaustions = 0;
+        std::chrono::steady_clock::time_point exhaustedUntil;
+    };
+
+    /**
+     * This is used to select the next address to use.
+     */
+    Selection selection_ = Selection::RoundRobin;
+
+    /**
+     * This is the maximum number of connections which may be open
+     * from any one address, or zero for no limit.
+     */
+    size_t maxConnectionsPerAddress_ = 0;
+
+    /**
+     * These are the local addresses in the pool.
+     */
+    std::vector< Source > sources_;
+
+    /**
+     * This is the index of the address to consider first
+     * for round-robin selection.
+     */
+    size_t next_ = 0;
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    mutable std::mutex mutex_;
+};
+
+#endif /* NEWMAN_SOURCE_ADDRESS_POOL_HPP */
@@ -0,0 +1,637 @@
+/**
+ * @file SourceBoundConnection.cpp
+ *
+ * This module contains the implementation of the SourceBoundConnection
+ * class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "SourceBoundConnection.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/sock_diag.h>
+#endif /* __linux__ */
+#endif /* not _WIN32 */
+
+namespace {
+
+    /**
+     * This is the longest Connect waits at a time for the peer to
+     * accept the connection before checking whether Close was called.
+     */
+    constexpr int CONNECT_POLL_INTERVAL_MILLISECONDS = 50;
+
+    /**
+     * Render the given IPv4 address, in host byte order,
+     * in dotted-decimal form.
+     */
+    std::string FormatAddress(uint32_t address) {
+        char buffer[16];
+        (void)snprintf(
+            buffer,
+            sizeof(buffer),
+            "%" PRIu32 ".%" PRIu32 ".%" PRIu32 ".%" PRIu32,
+            (address >> 24) & 0xFF,
+            (address >> 16) & 0xFF,
+            (address >> 8) & 0xFF,
+            address & 0xFF
+        );
+        return buffer;
+    }
+
+}
+
+/**
+ * This contains the private properties of a SourceBoundConnection instance.
+ */
+struct SourceBoundConnection::Impl {
+    /**
+     * This is used to publish diagnostic messages.
+     */
+    SystemAbstractions::DiagnosticsSender diagnosticsSender;
+
+    /**
+     * These are the local addresses to which the connection
+     * may be bound.
+     */
+    std::shared_ptr< SourceAddressPool > sourceAddresses;
+
+    /**
+     * These are the buffers from which one is borrowed whenever
+     * there is data to receive.
+     */
+    std::shared_ptr< BufferPool > receiveBuffers;
+
+    /**
+     * This is the index of the local address to which the connection
+     * is bound, or SourceAddressPool::NONE if it isn't bound.
+     */
+    size_t source = SourceAddressPool::NONE;
+
+    /**
+     * This is the operating system handle of the socket,
+     * or -1 if there is no socket.
+     */
+    int sock = -1;
+
+    uint32_t boundAddress = 0;
+    uint16_t boundPort = 0;
+    uint32_t peerAddress = 0;
+    uint16_t peerPort = 0;
+
+    /**
+     * This indicates whether or not the connection is open.
+     */
+    bool connected = false;
+
+    /**
+     * This indicates whether or not Connect is in progress.
+     */
+    bool connecting = false;
+
+    /**
+     * This indicates whether or not Close has been called,
+     * so that Connect should give up.
+     */
+    bool closing = false;
+
+    /**
+     * This is how long Connect waits for the peer to accept
+     * the connection, or zero if it waits as long as the
+     * operating system does.
+     */
+    std::chrono::milliseconds connectTimeout = std::chrono::milliseconds(0);
+
+    /**
+     * This is the number of bytes of the receive buffer
+     * currently borrowed from the pool, if any.
+     */
+    std::atomic< size_t > bufferBytes{0};
+
+    /**
+     * This is the thread which receives data from the peer.
+     */
+    std::thread receiver;
+
+    /**
+     * This is used to synchronize access to the object.  It's never
+     * held while waiting on the network, so that Close and IsConnected
+     * don't wait for a connection to be made or data to be sent.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * This is held while sending a message, so that messages sent
+     * by different threads don't get mixed together.  The socket
+     * stays open until the object is destroyed, so it can be used
+     * without holding the other mutex.
+     */
+    std::mutex sendMutex;
+
+    Impl()
+        : diagnosticsSender("SourceBoundConnection")
+    {
+    }
+
+    /**
+     * Close the socket and give back the local address, once neither
+     * the connection nor the thread receiving data uses them anymore.
+     */
+    ~Impl() noexcept {
+#ifndef _WIN32
+        if (sock >= 0) {
+            (void)close(sock);
+        }
+#endif /* not _WIN32 */
+        if (source != SourceAddressPool::NONE) {
+            sourceAddresses->Release(source);
+        }
+    }
+
+    /**
+     * Receive data from the peer until the connection is broken
+     * or closed, passing it to the given delegate.
+     *
+     * While waiting for data, no buffer is held.  Once data arrives,
+     * a buffer is borrowed from the pool, everything available is
+     * received, and the buffer is given back, so that an idle
+     * connection holds no memory beyond the kernel's socket buffers.
+     */
+    void Receive(
+        MessageReceivedDelegate messageReceivedDelegate,
+        BrokenDelegate brokenDelegate
+    ) {
+#ifndef _WIN32
+        bool graceful = false;
+        bool open = true;
+        while (open) {
+            struct pollfd readable = {};
+            readable.fd = sock;
+            readable.events = POLLIN;
+            if (poll(&readable, 1, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            auto buffer = receiveBuffers->Acquire();
+            bufferBytes = buffer.size();
+            for (;;) {
+                const auto amount = recv(sock, buffer.data(), buffer.size(), MSG_DONTWAIT);
+                if (amount > 0) {
+                    messageReceivedDelegate(
+                        std::vector< uint8_t >(buffer.begin(), buffer.begin() + amount)
+                    );
+                } else if (
+                    (amount < 0)
+                    && (errno == EINTR)
+                ) {
+                    continue;
+                } else if (
+                    (amount < 0)
+                    && (
+                        (errno == EAGAIN)
+                        || (errno == EWOULDBLOCK)
+                    )
+                ) {
+                    break;
+                } else {
+                    graceful = (amount == 0);
+                    open = false;
+                    break;
+                }
+            }
+            bufferBytes = 0;
+            receiveBuffers->Release(std::move(buffer));
+        }
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            connected = false;
+        }
+        brokenDelegate(graceful);
+#else /* _WIN32 */
+        (void)messageReceivedDelegate;
+        (void)brokenDelegate;
+#endif /* not _WIN32 / _WIN32 */
+    }
+
+#ifndef _WIN32
+    /**
+     * Connect the given socket to the given peer, waiting no longer
+     * than the connect timeout, and giving up if Close is called.
+     *
+     * @param[in] sock
+     *     This is the socket to connect.
+     *
+     * @param[in] remote
+     *     This is the address and port of the peer.
+     *
+     * @return
+     *     Zero is returned if the socket is connected.  Otherwise,
+     *     the error number describing why it isn't is returned.
+     */
+    int ConnectSocket(
+        int sock,
+        const struct sockaddr_in& remote
+    ) {
+        std::chrono::milliseconds timeout;
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            timeout = connectTimeout;
+        }
+        const auto flags = fcntl(sock, F_GETFL, 0);
+        if (
+            (flags < 0)
+            || (fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+        ) {
+            return errno;
+        }
+        if (connect(sock, (const struct sockaddr*)&remote, sizeof(remote)) != 0) {
+            if (errno != EINPROGRESS) {
+                return errno;
+            }
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            for (;;) {
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    if (closing) {
+                        return ECANCELED;
+                    }
+                }
+                auto wait = CONNECT_POLL_INTERVAL_MILLISECONDS;
+                if (timeout.count() > 0) {
+                    const auto remaining = std::chrono::duration_cast< std::chrono::milliseconds >(
+                        deadline - std::chrono::steady_clock::now()
+                    );
+                    if (remaining.count() <= 0) {
+                        return ETIMEDOUT;
+                    }
+                    wait = (int)std::min(
+                        remaining,
+                        std::chrono::milliseconds(wait)
+                    ).count();
+                }
+                struct pollfd writable = {};
+                writable.fd = sock;
+                writable.events = POLLOUT;
+                const auto ready = poll(&writable, 1, wait);
+                if (ready < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return errno;
+                }
+                if (ready > 0) {
+                    break;
+                }
+            }
+            int error = 0;
+            socklen_t errorLength = sizeof(error);
+            if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0) {
+                return errno;
+            }
+            if (error != 0) {
+                return error;
+            }
+        }
+
+        // Data is received with MSG_DONTWAIT, and sending should block.
+        if (fcntl(sock, F_SETFL, flags) < 0) {
+            return errno;
+        }
+        return 0;
+    }
+
+    /**
+     * Connect to the given peer, binding to a local address from the
+     * pool if there are any, and trying the next address if the one
+     * chosen has run out of ports.
+     *
+     * @param[in] peerAddress
+     *     This is the IPv4 address of the peer, in host byte order.
+     *
+     * @param[in] peerPort
+     *     This is the port number of the peer.
+     *
+     * @return
+     *     An indication of whether or not the connection was made
+     *     is returned.
+     */
+    bool Connect(uint32_t peerAddress, uint16_t peerPort) {
+        const auto bindToSource = (
+            (sourceAddresses != nullptr)
+            && !sourceAddresses->IsEmpty()
+        );
+        for (;;) {
+            auto chosenSource = SourceAddressPool::NONE;
+            uint32_t sourceAddress = 0;
+            if (bindToSource) {
+                chosenSource = sourceAddresses->Acquire();
+                if (chosenSource == SourceAddressPool::NONE) {
+                    diagnosticsSender.SendDiagnosticInformationString(
+                        SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                        "no source address available"
+                    );
+                    return false;
+                }
+                sourceAddress = sourceAddresses->GetAddress(chosenSource);
+            }
+            const auto newSock = socket(AF_INET, SOCK_STREAM, 0);
+            if (newSock < 0) {
+                if (bindToSource) {
+                    sourceAddresses->Release(chosenSource);
+                }
+                return false;
+            }
+            struct sockaddr_in local = {};
+            local.sin_family = AF_INET;
+            local.sin_addr.s_addr = htonl(sourceAddress);
+            struct sockaddr_in remote = {};
+            remote.sin_family = AF_INET;
+            remote.sin_addr.s_addr = htonl(peerAddress);
+            remote.sin_port = htons(peerPort);
+            auto error = 0;
+            if (
+                bindToSource
+                && (bind(newSock, (struct sockaddr*)&local, sizeof(local)) != 0)
+            ) {
+                error = errno;
+            } else {
+                error = ConnectSocket(newSock, remote);
+            }
+            if (error == 0) {
+                socklen_t localLength = sizeof(local);
+                (void)getsockname(newSock, (struct sockaddr*)&local, &localLength);
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                if (!closing) {
+                    sock = newSock;
+                    source = chosenSource;
+                    boundAddress = ntohl(local.sin_addr.s_addr);
+                    boundPort = ntohs(local.sin_port);
+                    this->peerAddress = peerAddress;
+                    this->peerPort = peerPort;
+                    connected = true;
+                    return true;
+                }
+                error = ECANCELED;
+            }
+            (void)close(newSock);
+            if (error == ECANCELED) {
+                if (bindToSource) {
+                    sourceAddresses->Release(chosenSource);
+                }
+                return false;
+            }
+            if (!bindToSource) {
+                diagnosticsSender.SendDiagnosticInformationString(
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    std::string("unable to connect: ") + strerror(error)
+                );
+                return false;
+            }
+            if (
+                (error == EADDRINUSE)
+                || (error == EADDRNOTAVAIL)
+            ) {
+                // Linux reports running out of ephemeral ports this way.
+                sourceAddresses->MarkExhausted(chosenSource);
+                diagnosticsSender.SendDiagnosticInformationString(
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    "source address " + FormatAddress(sourceAddress) + " has run out of ports"
+                );
+                continue;
+            }
+            sourceAddresses->Release(chosenSource);
+            diagnosticsSender.SendDiagnosticInformationString(
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                (
+                    "unable to connect from " + FormatAddress(sourceAddress)
+                    + ": " + strerror(error)
+                )
+            );
+            return false;
+        }
+    }
+#endif /* not _WIN32 */
+};
+
+SourceBoundConnection::~SourceBoundConnection() noexcept {
+    Close(false);
+    if (impl_->receiver.joinable()) {
+        if (impl_->receiver.get_id() == std::this_thread::get_id()) {
+            impl_->receiver.detach();
+        } else {
+            impl_->receiver.join();
+        }
+    }
+}
+
+SourceBoundConnection::SourceBoundConnection(
+    std::shared_ptr< SourceAddressPool > sourceAddresses,
+    std::shared_ptr< BufferPool > receiveBuffers
+)
+    : impl_(new Impl())
+{
+    impl_->sourceAddresses = sourceAddresses;
+    impl_->receiveBuffers = receiveBuffers;
+    if (impl_->receiveBuffers == nullptr) {
+        impl_->receiveBuffers = std::make_shared< BufferPool >();
+    }
+}
+
+SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SourceBoundConnection::SubscribeToDiagnostics(
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+    size_t minLevel
+) {
+    return impl_->diagnosticsSender.SubscribeToDiagnostics(delegate, minLevel);
+}
+
+bool SourceBoundConnection::Connect(uint32_t peerAddress, uint16_t peerPort) {
+#ifndef _WIN32
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        if (
+            (impl_->sock >= 0)
+            || impl_->connecting
+            || impl_->closing
+        ) {
+            return false;
+        }
+        impl_->connecting = true;
+    }
+    const auto connected = impl_->Connect(peerAddress, peerPort);
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->connecting = false;
+    return connected;
+#else /* _WIN32 */
+    (void)peerAddress;
+    (void)peerPort;
+    impl_->diagnosticsSender.SendDiagnosticInformationString(
+        SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+        "binding to source addresses is not supported on this platform"
+    );
+    return false;
+#endif /* not _WIN32 / _WIN32 */
+}
+
+bool SourceBoundConnection::Process(
+    MessageReceivedDelegate messageReceivedDelegate,
+    BrokenDelegate brokenDelegate
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (
+        !impl_->connected
+        || impl_->receiver.joinable()
+    ) {
+        return false;
+    }
+    const auto impl = impl_;
+    impl_->receiver = std::thread(
+        [impl, messageReceivedDelegate, brokenDelegate]{
+            impl->Receive(messageReceivedDelegate, brokenDelegate);
+        }
+    );
+    return true;
+}
+
+uint32_t SourceBoundConnection::GetPeerAddress() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->peerAddress;
+}
+
+uint16_t SourceBoundConnection::GetPeerPort() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->peerPort;
+}
+
+bool SourceBoundConnection::IsConnected() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->connected;
+}
+
+uint32_t SourceBoundConnection::GetBoundAddress() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->boundAddress;
+}
+
+uint16_t SourceBoundConnection::GetBoundPort() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->boundPort;
+}
+
+void SourceBoundConnection::SendMessage(const std::vector< uint8_t >& message) {
+#ifndef _WIN32
+    std::lock_guard< decltype(impl_->sendMutex) > sendLock(impl_->sendMutex);
+    int sock;
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        if (!impl_->connected) {
+            return;
+        }
+        sock = impl_->sock;
+    }
+    size_t sent = 0;
+    while (sent < message.size()) {
+        const auto amount = send(
+            sock,
+            message.data() + sent,
+            message.size() - sent,
+            MSG_NOSIGNAL
+        );
+        if (amount < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The receiver will notice the connection is broken.
+            (void)shutdown(sock, SHUT_RDWR);
+            return;
+        }
+        sent += (size_t)amount;
+    }
+#else /* _WIN32 */
+    (void)message;
+#endif /* not _WIN32 / _WIN32 */
+}
+
+void SourceBoundConnection::Close(bool clean) {
+#ifndef _WIN32
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->closing = true;
+    if (impl_->sock < 0) {
+        return;
+    }
+    // A clean close lets the peer finish sending, after which
+    // the receiver sees the end of the stream.  Either way, a send
+    // blocked in another thread is woken up.
+    (void)shutdown(impl_->sock, clean ? SHUT_WR : SHUT_RDWR);
+#else /* _WIN32 */
+    (void)clean;
+#endif /* not _WIN32 / _WIN32 */
+}
+
+void SourceBoundConnection::SetConnectTimeout(std::chrono::milliseconds timeout) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->connectTimeout = timeout;
+}
+
+SourceBoundConnection::MemoryUsage SourceBoundConnection::GetMemoryUsage() const {
+    MemoryUsage usage;
+    usage.bufferBytes = impl_->bufferBytes;
+#ifndef _WIN32
+    int sock;
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        sock = impl_->sock;
+    }
+    if (sock < 0) {
+        return usage;
+    }
+#if defined(SO_MEMINFO)
+    uint32_t memInfo[SK_MEMINFO_VARS] = {};
+    socklen_t memInfoLength = sizeof(memInfo);
+    if (getsockopt(sock, SOL_SOCKET, SO_MEMINFO, memInfo, &memInfoLength) == 0) {
+        usage.kernelBytes = (
+            (size_t)memInfo[SK_MEMINFO_RMEM_ALLOC]
+            + (size_t)memInfo[SK_MEMINFO_WMEM_QUEUED]
+        );
+        return usage;
+    }
+#endif /* SO_MEMINFO */
+    // Without a way to ask how much the kernel has allocated,
+    // count the data it's holding.
+    int received = 0;
+    if (ioctl(sock, FIONREAD, &received) == 0) {
+        usage.kernelBytes += (size_t)received;
+    }
+#if defined(TIOCOUTQ)
+    int unacknowledged = 0;
+    if (ioctl(sock, TIOCOUTQ, &unacknowledged) == 0) {
+        usage.kernelBytes += (size_t)unacknowledged;
+    }
+#endif /* TIOCOUTQ */
+#endif /* not _WIN32 */
+    return usage;
+}
+
+int SourceBoundConnection::GetSocket() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->sock;
+}
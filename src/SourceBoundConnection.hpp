@@ -0,0 +1,156 @@
+#ifndef NEWMAN_SOURCE_BOUND_CONNECTION_HPP
+#define NEWMAN_SOURCE_BOUND_CONNECTION_HPP
+
+/**
+ * @file SourceBoundConnection.hpp
+ *
+ * This module declares the SourceBoundConnection class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <memory>
+#include <stddef.h>
+#include <SystemAbstractions/INetworkConnection.hpp>
+
+#include "BufferPool.hpp"
+#include "SourceAddressPool.hpp"
+
+/**
+ * This is an outgoing TCP connection which is bound to a local address
+ * chosen from a pool, for use when the SMTP server limits connections
+ * per client address.  SystemAbstractions::NetworkConnection always lets
+ * the operating system choose the local address, and holds a receive
+ * buffer for as long as it's open, so this takes its place wherever
+ * POSIX sockets are available.
+ *
+ * If the chosen address has run out of ephemeral ports, it's set aside
+ * for a while and the next one is tried.  Without any local addresses,
+ * the operating system chooses the local address as usual.
+ *
+ * Data is received into buffers borrowed from a shared pool only while
+ * there is data to receive, so idle connections don't hold any.
+ * Sending never holds up Close or IsConnected, and Connect gives up
+ * after a timeout, or as soon as Close is called.
+ *
+ * This is only supported on platforms with POSIX sockets.
+ */
+class SourceBoundConnection
+    : public SystemAbstractions::INetworkConnection
+{
+    // Types
+public:
+    /**
+     * This is how much memory a connection is holding
+     * at one point in time.
+     */
+    struct MemoryUsage {
+        /**
+         * This is the number of bytes of receive buffers
+         * held by the connection itself.
+         */
+        size_t bufferBytes = 0;
+
+        /**
+         * This is the number of bytes the kernel has allocated
+         * for data received but not yet read, or sent but not yet
+         * acknowledged by the peer.
+         */
+        size_t kernelBytes = 0;
+    };
+
+    // Lifecycle management
+public:
+    ~SourceBoundConnection() noexcept;
+    SourceBoundConnection(const SourceBoundConnection&) = delete;
+    SourceBoundConnection(SourceBoundConnection&&) noexcept = delete;
+    SourceBoundConnection& operator=(const SourceBoundConnection&) = delete;
+    SourceBoundConnection& operator=(SourceBoundConnection&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] sourceAddresses
+     *     These are the local addresses to which the connection
+     *     may be bound, or nullptr if it shouldn't be bound.
+     *
+     * @param[in] receiveBuffers
+     *     These are the buffers from which one is borrowed while
+     *     receiving data, or nullptr if the connection should have
+     *     a pool of its own.
+     */
+    SourceBoundConnection(
+        std::shared_ptr< SourceAddressPool > sourceAddresses,
+        std::shared_ptr< BufferPool > receiveBuffers
+    );
+
+    /**
+     * Set how long Connect waits for the peer to accept the connection
+     * before giving up.  Connect also gives up early if Close is called.
+     *
+     * @param[in] timeout
+     *     This is how long to wait for the connection to be made,
+     *     or zero to wait as long as the operating system does.
+     */
+    void SetConnectTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * Return how much memory the connection is holding right now.
+     *
+     * @return
+     *     How much memory the connection is holding is returned.
+     */
+    MemoryUsage GetMemoryUsage() const;
+
+    /**
+     * Return the operating system handle of the socket, so that
+     * statistics about it can be sampled.  The handle belongs to
+     * the connection and stays open until the connection is destroyed,
+     * so it must not be closed or used after then.
+     *
+     * @return
+     *     The operating system handle of the socket is returned,
+     *     or -1 if the connection hasn't been made.
+     */
+    int GetSocket() const;
+
+    // SystemAbstractions::INetworkConnection
+public:
+    virtual SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+        size_t minLevel = 0
+    ) override;
+    virtual bool Connect(uint32_t peerAddress, uint16_t peerPort) override;
+    virtual bool Process(
+        MessageReceivedDelegate messageReceivedDelegate,
+        BrokenDelegate brokenDelegate
+    ) override;
+    virtual uint32_t GetPeerAddress() const override;
+    virtual uint16_t GetPeerPort() const override;
+    virtual bool IsConnected() const override;
+    virtual uint32_t GetBoundAddress() const override;
+    virtual uint16_t GetBoundPort() const override;
+    virtual void SendMessage(const std::vector< uint8_t >& message) override;
+    virtual void Close(bool clean = false) override;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.  It's shared
+     * with the thread which receives data, so that it outlives the
+     * instance if the instance is destroyed by that thread.
+     */
+    std::shared_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_SOURCE_BOUND_CONNECTION_HPP */
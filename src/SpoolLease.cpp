@@ -0,0 +1,256 @@
+/**
+ * @file SpoolLease.cpp
+ *
+ * This module contains the implementation of the SpoolLease class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "SpoolLease.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace {
+
+    /**
+     * This separates the original name of a claimed file
+     * from the details of the lease.
+     */
+    const std::string LEASE_MARKER = ".eml.lease.";
+
+    /**
+     * Return the current time, in seconds since the UNIX epoch.
+     */
+    int64_t Now() {
+        return (int64_t)std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * Extract the details of the lease from the name of a claimed file.
+     *
+     * @param[in] fileName
+     *     This is the path to the claimed file.
+     *
+     * @param[out] unclaimedFileName
+     *     This is where to store the path the file had before it was claimed.
+     *
+     * @param[out] fence
+     *     This is where to store the fencing token of the lease.
+     *
+     * @param[out] expiry
+     *     This is where to store when the lease expires,
+     *     in seconds since the UNIX epoch.
+     *
+     * @return
+     *     An indication of whether or not the file is claimed
+     *     is returned.
+     */
+    bool ParseLeaseFileName(
+        const std::string& fileName,
+        std::string& unclaimedFileName,
+        uint64_t& fence,
+        int64_t& expiry
+    ) {
+        const auto marker = fileName.rfind(LEASE_MARKER);
+        if (marker == std::string::npos) {
+            return false;
+        }
+        if (
+            sscanf(
+                fileName.c_str() + marker + LEASE_MARKER.length(),
+                "%" SCNu64 ".%" SCNd64 ".",
+                &fence,
+                &expiry
+            ) != 2
+        ) {
+            return false;
+        }
+        unclaimedFileName = fileName.substr(0, marker + 4);
+        return true;
+    }
+
+    /**
+     * Return the name of a file claimed with the given lease.
+     */
+    std::string MakeLeaseFileName(
+        const std::string& unclaimedFileName,
+        uint64_t fence,
+        int64_t expiry,
+        const std::string& owner
+    ) {
+        return (
+            unclaimedFileName.substr(0, unclaimedFileName.length() - 4)
+            + LEASE_MARKER
+            + std::to_string(fence)
+            + "." + std::to_string(expiry)
+            + "." + owner
+        );
+    }
+
+}
+
+/**
+ * This contains the private properties of a SpoolLease instance.
+ */
+struct SpoolLease::Impl {
+    /**
+     * This is the path the file had before it was claimed.
+     */
+    std::string unclaimedFileName;
+
+    /**
+     * This is the path of the claimed file, or an empty string
+     * if the lease isn't held.
+     */
+    std::string claimedFileName;
+
+    /**
+     * This identifies who holds the lease.
+     */
+    std::string owner;
+
+    /**
+     * This is the fencing token of the lease.
+     */
+    uint64_t fence = 0;
+};
+
+SpoolLease::~SpoolLease() noexcept {
+    (void)Release();
+}
+
+SpoolLease::SpoolLease()
+    : impl_(new Impl())
+{
+}
+
+bool SpoolLease::IsClaimable(const std::string& fileName) {
+    std::string unclaimedFileName;
+    uint64_t fence;
+    int64_t expiry;
+    return (
+        !ParseLeaseFileName(fileName, unclaimedFileName, fence, expiry)
+        || (expiry <= Now())
+    );
+}
+
+std::string SpoolLease::GetUnclaimedFileName(const std::string& fileName) {
+    std::string unclaimedFileName;
+    uint64_t fence;
+    int64_t expiry;
+    if (ParseLeaseFileName(fileName, unclaimedFileName, fence, expiry)) {
+        return unclaimedFileName;
+    }
+    return fileName;
+}
+
+bool SpoolLease::IsValidOwner(const std::string& owner) {
+    if (owner.empty()) {
+        return false;
+    }
+    for (const auto c: owner) {
+        if (
+            !(
+                ((c >= 'a') && (c <= 'z'))
+                || ((c >= 'A') && (c <= 'Z'))
+                || ((c >= '0') && (c <= '9'))
+                || (c == '-')
+                || (c == '_')
+            )
+        ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SpoolLease::Claim(
+    const std::string& fileName,
+    const std::string& owner,
+    std::chrono::seconds duration
+) {
+    if (!impl_->claimedFileName.empty()) {
+        return false;
+    }
+    const auto now = Now();
+    std::string unclaimedFileName;
+    uint64_t fence = 0;
+    int64_t expiry;
+    if (ParseLeaseFileName(fileName, unclaimedFileName, fence, expiry)) {
+        if (expiry > now) {
+            return false;
+        }
+    } else {
+        unclaimedFileName = fileName;
+    }
+    ++fence;
+    const auto claimedFileName = MakeLeaseFileName(
+        unclaimedFileName,
+        fence,
+        now + (int64_t)duration.count(),
+        owner
+    );
+    if (rename(fileName.c_str(), claimedFileName.c_str()) != 0) {
+        return false;
+    }
+    impl_->unclaimedFileName = unclaimedFileName;
+    impl_->claimedFileName = claimedFileName;
+    impl_->owner = owner;
+    impl_->fence = fence;
+    return true;
+}
+
+bool SpoolLease::Renew(std::chrono::seconds duration) {
+    if (impl_->claimedFileName.empty()) {
+        return false;
+    }
+    const auto claimedFileName = MakeLeaseFileName(
+        impl_->unclaimedFileName,
+        impl_->fence,
+        Now() + (int64_t)duration.count(),
+        impl_->owner
+    );
+    if (
+        (claimedFileName != impl_->claimedFileName)
+        && (rename(impl_->claimedFileName.c_str(), claimedFileName.c_str()) != 0)
+    ) {
+        impl_->claimedFileName.clear();
+        return false;
+    }
+    impl_->claimedFileName = claimedFileName;
+    return true;
+}
+
+bool SpoolLease::Complete() {
+    if (impl_->claimedFileName.empty()) {
+        return false;
+    }
+    const auto removed = (remove(impl_->claimedFileName.c_str()) == 0);
+    impl_->claimedFileName.clear();
+    return removed;
+}
+
+bool SpoolLease::Release() {
+    if (impl_->claimedFileName.empty()) {
+        return false;
+    }
+    const auto restored = (
+        rename(
+            impl_->claimedFileName.c_str(),
+            impl_->unclaimedFileName.c_str()
+        ) == 0
+    );
+    impl_->claimedFileName.clear();
+    return restored;
+}
+
+std::string SpoolLease::GetFileName() const {
+    return impl_->claimedFileName;
+}
+
+uint64_t SpoolLease::GetFence() const {
+    return impl_->fence;
+}
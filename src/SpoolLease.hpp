@@ -0,0 +1,182 @@
+#ifndef NEWMAN_SPOOL_LEASE_HPP
+#define NEWMAN_SPOOL_LEASE_HPP
+
+/**
+ * @file SpoolLease.hpp
+ *
+ * This module declares the SpoolLease class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+/**
+ * This is a claim on one e-mail file in a directory shared by several
+ * Newman processes, so that only one of them sends it.
+ *
+ * A file is claimed by renaming it atomically, which only one process
+ * can do, to a name recording who claimed it, until when, and a fencing
+ * token:
+ *
+ *     NAME.eml.lease.FENCE.EXPIRY.OWNER
+ *
+ * A lease which has expired may be taken over by renaming it again,
+ * with the next fencing token.  Every later step the holder takes
+ * (renewing, completing, releasing) is itself a rename or removal of
+ * the exact name it claimed, so it fails, rather than acting on the
+ * file, once anyone else has taken the lease over.
+ *
+ * Expiry times are wall-clock times, so the clocks of the hosts sharing
+ * a directory need to be kept roughly in sync.
+ */
+class SpoolLease {
+    // Lifecycle management
+public:
+    /**
+     * This is the destructor of the class.  If the lease is still held,
+     * it's released, so that the file can be claimed again.
+     */
+    ~SpoolLease() noexcept;
+
+    SpoolLease(const SpoolLease&) = delete;
+    SpoolLease(SpoolLease&&) noexcept = delete;
+    SpoolLease& operator=(const SpoolLease&) = delete;
+    SpoolLease& operator=(SpoolLease&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     */
+    SpoolLease();
+
+    /**
+     * Check whether or not the given file may be claimed: either it's
+     * not claimed, or it's claimed by a lease which has expired.
+     *
+     * @param[in] fileName
+     *     This is the path to the file to check.
+     *
+     * @return
+     *     An indication of whether or not the file may be claimed
+     *     is returned.
+     */
+    static bool IsClaimable(const std::string& fileName);
+
+    /**
+     * Return the path the given file had before it was claimed.
+     *
+     * @param[in] fileName
+     *     This is the path to the file, which may be claimed or not.
+     *
+     * @return
+     *     The path the file had before it was claimed is returned.
+     */
+    static std::string GetUnclaimedFileName(const std::string& fileName);
+
+    /**
+     * Check whether or not the given string may be used to identify
+     * the owner of leases.
+     *
+     * @param[in] owner
+     *     This is the string to check.
+     *
+     * @return
+     *     An indication of whether or not the string may be used
+     *     to identify the owner of leases is returned.
+     */
+    static bool IsValidOwner(const std::string& owner);
+
+    /**
+     * Claim the given file.
+     *
+     * @param[in] fileName
+     *     This is the path to the file to claim, whose name ends
+     *     in ".eml", or which is claimed by an expired lease.
+     *
+     * @param[in] owner
+     *     This identifies who is claiming the file.  It may only contain
+     *     letters, digits, hyphens, and underscores.
+     *
+     * @param[in] duration
+     *     This is how long the lease lasts unless renewed.
+     *
+     * @return
+     *     An indication of whether or not the file was claimed
+     *     is returned.
+     */
+    bool Claim(
+        const std::string& fileName,
+        const std::string& owner,
+        std::chrono::seconds duration
+    );
+
+    /**
+     * Extend the lease so that it lasts the given duration from now.
+     *
+     * @param[in] duration
+     *     This is how long the lease lasts from now unless renewed again.
+     *
+     * @return
+     *     An indication of whether or not the lease is still held
+     *     is returned.
+     */
+    bool Renew(std::chrono::seconds duration);
+
+    /**
+     * Remove the claimed file, since it's been dealt with.
+     *
+     * @return
+     *     An indication of whether or not the lease was still held,
+     *     and so the file was removed, is returned.
+     */
+    bool Complete();
+
+    /**
+     * Give up the claim on the file, restoring its original name.
+     *
+     * @return
+     *     An indication of whether or not the lease was still held,
+     *     and so the file was restored, is returned.
+     */
+    bool Release();
+
+    /**
+     * Return the path the claimed file has now, which changes
+     * each time the lease is renewed.
+     *
+     * @return
+     *     The path of the claimed file is returned, or an empty
+     *     string if the lease isn't held.
+     */
+    std::string GetFileName() const;
+
+    /**
+     * Return the fencing token of the lease, which is one more than
+     * that of the lease taken over when the file was claimed.
+     *
+     * @return
+     *     The fencing token of the lease is returned.
+     */
+    uint64_t GetFence() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_SPOOL_LEASE_HPP */
@@ -0,0 +1,136 @@
+/**
+ * @file Stats.cpp
+ *
+ * This module contains the implementation of the functions used to keep
+ * and report statistics about the operation of Newman.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "Stats.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace {
+
+    /**
+     * This is the number of copies of the statistics kept.  Threads are
+     * assigned copies in rotation, so unless there are more threads than
+     * copies, no two threads ever update the same copy.
+     */
+    constexpr size_t NUM_SHARDS = 16;
+
+    /**
+     * This is one copy of the statistics.  It's aligned to keep it
+     * off the cache lines of the other copies.
+     */
+    struct alignas(64) Shard {
+        std::atomic< uint64_t > counters[static_cast< size_t >(Counter::Count)];
+        std::atomic< uint64_t > latencies[static_cast< size_t >(Phase::Count)][LatencyHistogram::BUCKETS];
+
+        Shard() {
+            for (auto& counter: counters) {
+                counter = 0;
+            }
+            for (auto& histogram: latencies) {
+                for (auto& bucket: histogram) {
+                    bucket = 0;
+                }
+            }
+        }
+    };
+
+    Shard shards[NUM_SHARDS];
+
+    /**
+     * This is used to assign copies of the statistics to threads.
+     */
+    std::atomic< size_t > nextShard(0);
+
+    /**
+     * This is when statistics began to be kept.
+     */
+    const auto startTime = std::chrono::steady_clock::now();
+
+    /**
+     * Return the copy of the statistics assigned to the calling thread.
+     *
+     * @return
+     *     The copy of the statistics assigned to the calling thread
+     *     is returned.
+     */
+    Shard& GetThreadShard() {
+        static thread_local Shard* shard = &shards[
+            nextShard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS
+        ];
+        return *shard;
+    }
+
+}
+
+std::string StatsSnapshot::ToString() const {
+    char buffer[256];
+    (void)snprintf(
+        buffer,
+        sizeof(buffer),
+        (
+            "uptime=%.1fs connects=%" PRIu64 " connect-failures=%" PRIu64
+            " sent=%" PRIu64 " failed=%" PRIu64 " timeouts=%" PRIu64
+        ),
+        uptime,
+        counters[static_cast< size_t >(Counter::ConnectAttempts)],
+        counters[static_cast< size_t >(Counter::ConnectFailures)],
+        counters[static_cast< size_t >(Counter::MessagesSent)],
+        counters[static_cast< size_t >(Counter::MessagesFailed)],
+        counters[static_cast< size_t >(Counter::Timeouts)]
+    );
+    std::string output = buffer;
+    static const char* phaseNames[] = {"connect", "ready", "send"};
+    for (size_t i = 0; i < static_cast< size_t >(Phase::Count); ++i) {
+        output += "; ";
+        output += phaseNames[i];
+        output += " (us): ";
+        output += latencies[i].Summarize();
+    }
+    return output;
+}
+
+void IncrementCounter(Counter counter, uint64_t amount) {
+    (void)GetThreadShard().counters[static_cast< size_t >(counter)].fetch_add(
+        amount,
+        std::memory_order_relaxed
+    );
+}
+
+void RecordLatency(Phase phase, uint64_t microseconds) {
+    (void)GetThreadShard().latencies[static_cast< size_t >(phase)][
+        LatencyHistogram::BucketOf(microseconds)
+    ].fetch_add(1, std::memory_order_relaxed);
+}
+
+StatsSnapshot TakeStatsSnapshot() {
+    StatsSnapshot snapshot;
+    for (const auto& shard: shards) {
+        for (size_t i = 0; i < static_cast< size_t >(Counter::Count); ++i) {
+            snapshot.counters[i] += shard.counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < static_cast< size_t >(Phase::Count); ++i) {
+            for (size_t j = 0; j < LatencyHistogram::BUCKETS; ++j) {
+                const auto count = shard.latencies[i][j].load(std::memory_order_relaxed);
+                if (count > 0) {
+                    snapshot.latencies[i].Record(
+                        LatencyHistogram::BucketUpperBound(j),
+                        count
+                    );
+                }
+            }
+        }
+    }
+    snapshot.uptime = std::chrono::duration< double >(
+        std::chrono::steady_clock::now() - startTime
+    ).count();
+    return snapshot;
+}
@@ -0,0 +1,125 @@
+#ifndef NEWMAN_STATS_HPP
+#define NEWMAN_STATS_HPP
+
+/**
+ * @file Stats.hpp
+ *
+ * This module declares the functions used to keep and report
+ * statistics about the operation of Newman.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "LatencyHistogram.hpp"
+
+/**
+ * This identifies a statistic which counts events.
+ */
+enum class Counter : size_t {
+    ConnectAttempts,
+    ConnectFailures,
+    MessagesSent,
+    MessagesFailed,
+    Timeouts,
+
+    /**
+     * This is the number of counters.
+     */
+    Count,
+};
+
+/**
+ * This identifies a phase of an SMTP session whose duration is measured.
+ */
+enum class Phase : size_t {
+    /**
+     * This is the time to make the connection to the SMTP server.
+     */
+    Connect,
+
+    /**
+     * This is the time from connecting to being ready to send
+     * (TLS handshake, greeting, EHLO, and AUTH).
+     */
+    Ready,
+
+    /**
+     * This is the time to send one e-mail.
+     */
+    Send,
+
+    /**
+     * This is the number of phases.
+     */
+    Count,
+};
+
+/**
+ * This is a copy of all statistics as of one point in time.
+ */
+struct StatsSnapshot {
+    /**
+     * These are the values of the counters.
+     */
+    uint64_t counters[static_cast< size_t >(Counter::Count)] = {};
+
+    /**
+     * These are the durations, in microseconds, measured for each phase.
+     */
+    LatencyHistogram latencies[static_cast< size_t >(Phase::Count)];
+
+    /**
+     * This is the number of seconds since statistics began to be kept.
+     */
+    double uptime = 0.0;
+
+    /**
+     * Render the statistics in human-readable form.
+     *
+     * @return
+     *     The statistics in human-readable form are returned.
+     */
+    std::string ToString() const;
+};
+
+/**
+ * Add to the given counter.
+ *
+ * This never takes a lock: each thread updates its own copy
+ * of the counters, and they're only added together by TakeStatsSnapshot.
+ *
+ * @param[in] counter
+ *     This identifies the counter to which to add.
+ *
+ * @param[in] amount
+ *     This is the amount to add to the counter.
+ */
+void IncrementCounter(Counter counter, uint64_t amount = 1);
+
+/**
+ * Record the duration of one occurrence of the given phase.
+ *
+ * This never takes a lock: each thread updates its own copy
+ * of the histograms, and they're only added together by TakeStatsSnapshot.
+ *
+ * @param[in] phase
+ *     This identifies the phase whose duration was measured.
+ *
+ * @param[in] microseconds
+ *     This is the duration of the phase, in microseconds.
+ */
+void RecordLatency(Phase phase, uint64_t microseconds);
+
+/**
+ * Add together the statistics kept by all threads.
+ *
+ * @return
+ *     A copy of all statistics is returned.
+ */
+StatsSnapshot TakeStatsSnapshot();
+
+#endif /* NEWMAN_STATS_HPP */
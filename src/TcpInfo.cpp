@@ -0,0 +1,69 @@
+/**
+ * @file TcpInfo.cpp
+ *
+ * This module contains the implementation of the TcpInfoSampler class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "TcpInfo.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#ifdef __linux__
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif /* __linux__ */
+
+std::string TcpInfoSample::ToString() const {
+    if (!valid) {
+        return "unavailable";
+    }
+    char buffer[160];
+    (void)snprintf(
+        buffer,
+        sizeof(buffer),
+        (
+            "rtt=%" PRIu32 "us rttvar=%" PRIu32 "us retrans=%" PRIu32
+            " cwnd=%" PRIu32 " acked=%" PRIu64
+        ),
+        rttMicroseconds,
+        rttVarianceMicroseconds,
+        retransmits,
+        congestionWindow,
+        bytesAcked
+    );
+    return buffer;
+}
+
+void TcpInfoSampler::Attach(std::shared_ptr< const SourceBoundConnection > connection) {
+    connection_ = connection;
+}
+
+TcpInfoSample TcpInfoSampler::Sample() const {
+    TcpInfoSample sample;
+#ifdef __linux__
+    if (connection_ == nullptr) {
+        return sample;
+    }
+    const auto sock = connection_->GetSocket();
+    if (sock < 0) {
+        return sample;
+    }
+    struct tcp_info info = {};
+    socklen_t infoLength = sizeof(info);
+    if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &infoLength) != 0) {
+        return sample;
+    }
+    sample.valid = true;
+    sample.rttMicroseconds = info.tcpi_rtt;
+    sample.rttVarianceMicroseconds = info.tcpi_rttvar;
+    sample.retransmits = info.tcpi_total_retrans;
+    sample.congestionWindow = info.tcpi_snd_cwnd;
+    // Older kernels fill in less of the structure, leaving this zero.
+    sample.bytesAcked = info.tcpi_bytes_acked;
+#endif /* __linux__ */
+    return sample;
+}
@@ -0,0 +1,98 @@
+#ifndef NEWMAN_TCP_INFO_HPP
+#define NEWMAN_TCP_INFO_HPP
+
+/**
+ * @file TcpInfo.hpp
+ *
+ * This module declares the TcpInfoSampler class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include "SourceBoundConnection.hpp"
+
+/**
+ * This holds statistics the operating system keeps about
+ * a TCP connection, as of one point in time.
+ */
+struct TcpInfoSample {
+    /**
+     * This indicates whether or not the statistics could be obtained.
+     */
+    bool valid = false;
+
+    /**
+     * This is the smoothed round-trip time, in microseconds.
+     */
+    uint32_t rttMicroseconds = 0;
+
+    /**
+     * This is the variance of the round-trip time, in microseconds.
+     */
+    uint32_t rttVarianceMicroseconds = 0;
+
+    /**
+     * This is the total number of segments retransmitted.
+     */
+    uint32_t retransmits = 0;
+
+    /**
+     * This is the size of the congestion window, in segments.
+     */
+    uint32_t congestionWindow = 0;
+
+    /**
+     * This is the number of bytes sent which the peer has acknowledged.
+     */
+    uint64_t bytesAcked = 0;
+
+    /**
+     * Render the statistics in human-readable form.
+     *
+     * @return
+     *     The statistics in human-readable form are returned.
+     */
+    std::string ToString() const;
+};
+
+/**
+ * This is used to sample the statistics the operating system keeps about
+ * a TCP connection made by SourceBoundConnection, using its socket.
+ * Statistics are only available on Linux; elsewhere every sample is
+ * marked as not valid.
+ */
+class TcpInfoSampler {
+    // Public methods
+public:
+    /**
+     * Start sampling the statistics of the given connection, which is
+     * kept for as long as it's sampled, so that its socket stays open.
+     *
+     * @param[in] connection
+     *     This is the connection to sample, or nullptr if there is
+     *     no connection whose statistics can be sampled.
+     */
+    void Attach(std::shared_ptr< const SourceBoundConnection > connection);
+
+    /**
+     * Sample the statistics of the connection.
+     *
+     * @return
+     *     The statistics of the connection are returned.
+     */
+    TcpInfoSample Sample() const;
+
+    // Private properties
+private:
+    /**
+     * This is the connection whose statistics are sampled,
+     * or nullptr if there isn't one.
+     */
+    std::shared_ptr< const SourceBoundConnection > connection_;
+};
+
+#endif /* NEWMAN_TCP_INFO_HPP */
@@ -0,0 +1,1056 @@
+/**
+ * @file VerpConnection.cpp
+ *
+ * This module contains the implementation of the VerpConnection class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "ReplyParser.hpp"
+#include "VerpConnection.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string.h>
+
+namespace {
+
+    /**
+     * This is the reply given to the client in place of the server's
+     * reply to each MAIL and RCPT command held back.
+     */
+    const char* const OK_REPLY = "250 OK\r\n";
+
+    /**
+     * This is the reply given to the client in place of the server's
+     * reply to each DATA command held back.
+     */
+    const char* const START_CONTENT_REPLY = "354 Start mail input; end with <CRLF>.<CRLF>\r\n";
+
+    /**
+     * This is the reply given to the client if a transaction
+     * had no recipients.
+     */
+    const char* const NO_RECIPIENTS_REPLY = "554 No valid recipients\r\n";
+
+    /**
+     * This marks the end of the message content (RFC 5321 section 4.1.1.4).
+     */
+    const char END_OF_CONTENT[] = "\r\n.\r\n";
+
+    /**
+     * Check whether or not the given line begins with the given
+     * command, ignoring case.
+     */
+    bool IsCommand(
+        const std::string& line,
+        const char* command
+    ) {
+        const auto length = strlen(command);
+        if (line.length() < length) {
+            return false;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            auto c = line[i];
+            if ((c >= 'a') && (c <= 'z')) {
+                c -= 'a' - 'A';
+            }
+            if (c != command[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Break the argument of a MAIL or RCPT command, which starts at
+     * the given position of the given line, into the path and the
+     * parameters following it.
+     *
+     * @param[in] line
+     *     This is the line holding the command.
+     *
+     * @param[in] position
+     *     This is where the argument of the command starts.
+     *
+     * @param[out] address
+     *     This is where to store the address in the path.
+     *
+     * @param[out] parameters
+     *     This is where to store the parameters following the path,
+     *     including the space before the first one, if any.
+     */
+    void ParsePath(
+        const std::string& line,
+        size_t position,
+        std::string& address,
+        std::string& parameters
+    ) {
+        auto end = line.find_last_not_of("\r\n");
+        end = ((end == std::string::npos) ? 0 : end + 1);
+        while (
+            (position < end)
+            && (line[position] == ' ')
+        ) {
+            ++position;
+        }
+        size_t pathEnd;
+        if (
+            (position < end)
+            && (line[position] == '<')
+        ) {
+            ++position;
+            pathEnd = line.find('>', position);
+            if (
+                (pathEnd == std::string::npos)
+                || (pathEnd > end)
+            ) {
+                pathEnd = end;
+            }
+            address = line.substr(position, pathEnd - position);
+            if (pathEnd < end) {
+                ++pathEnd;
+            }
+        } else {
+            pathEnd = line.find(' ', position);
+            if (
+                (pathEnd == std::string::npos)
+                || (pathEnd > end)
+            ) {
+                pathEnd = end;
+            }
+            address = line.substr(position, pathEnd - position);
+        }
+        parameters = line.substr(pathEnd, end - pathEnd);
+    }
+
+    /**
+     * Check whether or not the given reply is a positive completion
+     * reply.
+     */
+    bool IsPositive(const ReplyParser::Reply& reply) {
+        return (
+            (reply.code >= 200)
+            && (reply.code < 300)
+        );
+    }
+
+    /**
+     * Render the first line of the given reply, without its line ending.
+     */
+    std::string FormatReply(const ReplyParser::Reply& reply) {
+        auto line = std::to_string(reply.code);
+        if (reply.enhancedStatus.size > 0) {
+            line += ' ' + reply.enhancedStatus.ToString();
+        }
+        if (reply.text.size > 0) {
+            line += ' ' + reply.text.ToString();
+        }
+        return line;
+    }
+
+}
+
+/**
+ * This contains the private properties of a VerpConnection instance.
+ */
+struct VerpConnection::Impl {
+    // Types
+
+    /**
+     * These are the parts of a mail transaction of the client
+     * the decorator may be in.
+     */
+    enum class State {
+        /**
+         * No transaction has been started.  Commands are passed
+         * through to the server as they are.
+         */
+        Idle,
+
+        /**
+         * The client has started a transaction, and is listing
+         * its recipients.
+         */
+        Envelope,
+
+        /**
+         * The client is sending the message content.
+         */
+        Content,
+
+        /**
+         * The message is being sent to each recipient, and the client
+         * is waiting for the outcome.
+         */
+        Sending,
+    };
+
+    /**
+     * This is a recipient of the transaction of the client.
+     */
+    struct Recipient {
+        /**
+         * This is the address of the recipient.
+         */
+        std::string address;
+
+        /**
+         * These are the parameters the client gave with the recipient.
+         */
+        std::string parameters;
+    };
+
+    /**
+     * This is what to do with a reply expected from the server.
+     */
+    struct Expectation {
+        /**
+         * These are the kinds of replies expected.
+         */
+        enum class Kind {
+            /**
+             * The reply is passed on to the client as it is.
+             */
+            Relay,
+
+            /**
+             * The reply is passed on to the client as it is, and holds
+             * the capabilities of the server.
+             */
+            RelayEhlo,
+
+            /**
+             * The reply is to a NOOP standing in for a command held back,
+             * and is replaced by the translation.
+             */
+            Translate,
+
+            /**
+             * These are the replies to the commands of the transaction
+             * of one recipient.
+             */
+            Mail,
+            Rcpt,
+            Data,
+            Content,
+            Reset,
+        };
+
+        /**
+         * This is the kind of reply expected.
+         */
+        Kind kind = Kind::Relay;
+
+        /**
+         * This is the reply to give the client in place of a reply
+         * of the Translate kind.
+         */
+        const char* translation = nullptr;
+
+        /**
+         * This is the position of the recipient whose transaction
+         * the reply belongs to, if any.
+         */
+        size_t recipient = 0;
+    };
+
+    /**
+     * This is part of what to send to the server.
+     */
+    struct Segment {
+        /**
+         * These are the commands to send.
+         */
+        std::vector< uint8_t > commands;
+
+        /**
+         * This indicates whether or not to send the message content
+         * after the commands.
+         */
+        bool content = false;
+    };
+
+    /**
+     * This collects what the decorator has to send in either direction,
+     * to be sent once its mutex is released, so that neither the lower
+     * layer nor the client are called back while it's held.
+     */
+    struct Output {
+        /**
+         * This is what to send to the server, in order.
+         */
+        std::vector< Segment > toServer;
+
+        /**
+         * This is what to deliver to the client.
+         */
+        std::vector< uint8_t > toClient;
+
+        /**
+         * These are the warnings to publish.
+         */
+        std::vector< std::string > warnings;
+
+        /**
+         * Add the given command to what to send to the server.
+         *
+         * @param[in] command
+         *     This is the command to send, including its line ending.
+         */
+        void Send(const std::string& command) {
+            if (
+                toServer.empty()
+                || toServer.back().content
+            ) {
+                toServer.emplace_back();
+            }
+            auto& commands = toServer.back().commands;
+            commands.insert(commands.end(), command.begin(), command.end());
+        }
+
+        /**
+         * Add the message content to what to send to the server.
+         */
+        void SendContent() {
+            if (toServer.empty()) {
+                toServer.emplace_back();
+            }
+            toServer.back().content = true;
+        }
+
+        /**
+         * Add the given text to what to deliver to the client.
+         *
+         * @param[in] data
+         *     This points to the text to deliver.
+         *
+         * @param[in] size
+         *     This is the number of characters to deliver.
+         */
+        void Deliver(
+            const char* data,
+            size_t size
+        ) {
+            toClient.insert(toClient.end(), data, data + size);
+        }
+    };
+
+    // Properties
+
+    /**
+     * This is the connection being decorated.
+     */
+    std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer;
+
+    /**
+     * This is the template from which to make the return path
+     * of each recipient.
+     */
+    std::string returnPathTemplate;
+
+    /**
+     * This is the function to call to publish warnings about
+     * recipients turned down by the server.
+     */
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate;
+
+    /**
+     * This is the function to call to deliver data to the client.
+     */
+    MessageReceivedDelegate messageReceivedDelegate;
+
+    /**
+     * This breaks the data received from the server into replies.
+     */
+    ReplyParser parser;
+
+    /**
+     * This is the output to which replies parsed are handled.
+     */
+    Output* replyOutput = nullptr;
+
+    /**
+     * This is the part of a mail transaction of the client
+     * the decorator is in.
+     */
+    State state = State::Idle;
+
+    /**
+     * These are the replies expected from the server, in order.
+     */
+    std::deque< Expectation > expected;
+
+    /**
+     * This indicates whether or not the server listed the PIPELINING
+     * capability in its most recent reply to EHLO.
+     */
+    bool pipelining = false;
+
+    /**
+     * This holds the beginning of a command line from the client
+     * which isn't complete yet.
+     */
+    std::string line;
+
+    /**
+     * This holds anything the client sent while waiting for the outcome
+     * of its transaction, to be handled once the outcome is known.
+     */
+    std::vector< uint8_t > heldClientData;
+
+    /**
+     * These are the parameters the client gave with its return path.
+     */
+    std::string mailParameters;
+
+    /**
+     * These are the recipients of the transaction of the client.
+     */
+    std::vector< Recipient > recipients;
+
+    /**
+     * This indicates, for each recipient, whether or not the server
+     * turned the recipient down.
+     */
+    std::vector< bool > rejected;
+
+    /**
+     * This is the message content sent by the client, dot-stuffed
+     * and including the line marking its end, as it's sent to the
+     * server for each recipient.
+     */
+    std::vector< uint8_t > content;
+
+    /**
+     * This is the position of the recipient whose transaction
+     * was started most recently.
+     */
+    size_t nextRecipient = 0;
+
+    /**
+     * This is the number of recipients for whom the server
+     * accepted the message.
+     */
+    size_t accepted = 0;
+
+    /**
+     * This is the first line of the last reply in which the server
+     * turned down a recipient.
+     */
+    std::string lastRejection;
+
+    /**
+     * This is the number of replies received from the server.
+     */
+    std::atomic< uint64_t > replyCount{0};
+
+    /**
+     * This is used to synchronize access to the object.
+     */
+    std::mutex mutex;
+
+    // Methods
+
+    /**
+     * This is the constructor of the structure.
+     */
+    Impl()
+        : parser(
+            [this](const ReplyParser::Reply& reply){
+                OnReply(reply, *replyOutput);
+            }
+        )
+    {
+    }
+
+    /**
+     * Send the commands in the given output to the server, and
+     * deliver the replies in it to the client, then publish its
+     * warnings.  This is called without the mutex held.
+     *
+     * @param[in] output
+     *     This is what to send.
+     */
+    void Flush(const Output& output) {
+        for (const auto& segment: output.toServer) {
+            if (!segment.commands.empty()) {
+                lowerLayer->SendMessage(segment.commands);
+            }
+            if (segment.content) {
+                // The content isn't changed until the client starts
+                // another transaction, which it can't do before it's
+                // given the outcome of this one, which happens only
+                // after the last recipient's content is sent.
+                lowerLayer->SendMessage(content);
+            }
+        }
+        if (
+            !output.toClient.empty()
+            && (messageReceivedDelegate != nullptr)
+        ) {
+            messageReceivedDelegate(output.toClient);
+        }
+        if (diagnosticMessageDelegate != nullptr) {
+            for (const auto& warning: output.warnings) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    warning
+                );
+            }
+        }
+    }
+
+    /**
+     * Handle the given data sent by the client.
+     *
+     * @param[in] data
+     *     This points to the data sent.
+     *
+     * @param[in] size
+     *     This is the number of bytes sent.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void HandleClientData(
+        const uint8_t* data,
+        size_t size,
+        Output& output
+    ) {
+        while (size > 0) {
+            if (state == State::Sending) {
+                heldClientData.insert(heldClientData.end(), data, data + size);
+                return;
+            }
+            if (state == State::Content) {
+                const auto end = AppendContent(data, size);
+                if (end == 0) {
+                    return;
+                }
+                data += end;
+                size -= end;
+                StartSending(output);
+                continue;
+            }
+            const auto lineEnd = (const uint8_t*)memchr(data, '\n', size);
+            const size_t length = (
+                (lineEnd == nullptr)
+                ? size
+                : lineEnd + 1 - data
+            );
+            line.append((const char*)data, length);
+            data += length;
+            size -= length;
+            if (lineEnd != nullptr) {
+                HandleClientLine(output);
+                line.clear();
+            }
+        }
+    }
+
+    /**
+     * Add the given data to the message content, up to the end
+     * of the content, if the end is found in it.
+     *
+     * @param[in] data
+     *     This points to the data to add.
+     *
+     * @param[in] size
+     *     This is the number of bytes to add.
+     *
+     * @return
+     *     The number of bytes of the data up to and including the end
+     *     of the content is returned, or zero if the end wasn't found.
+     */
+    size_t AppendContent(
+        const uint8_t* data,
+        size_t size
+    ) {
+        const auto oldSize = content.size();
+        content.insert(content.end(), data, data + size);
+        const size_t endSize = sizeof(END_OF_CONTENT) - 1;
+        size_t end = 0;
+        if (
+            (content.size() >= 3)
+            && (content[0] == '.')
+            && (content[1] == '\r')
+            && (content[2] == '\n')
+        ) {
+            // The content is empty, so the line marking its end
+            // comes first.
+            end = 3;
+        } else {
+            const auto begin = content.begin() + ((oldSize < endSize) ? 0 : oldSize - endSize + 1);
+            const auto found = std::search(
+                begin,
+                content.end(),
+                END_OF_CONTENT,
+                END_OF_CONTENT + endSize
+            );
+            if (found != content.end()) {
+                end = (found - content.begin()) + endSize;
+            }
+        }
+        if (
+            (end == 0)
+            || (end <= oldSize)
+        ) {
+            return 0;
+        }
+        content.resize(end);
+        return end - oldSize;
+    }
+
+    /**
+     * Handle the complete command line from the client in the line
+     * buffer.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void HandleClientLine(Output& output) {
+        std::string address;
+        if (
+            (state == State::Idle)
+            && IsCommand(line, "MAIL FROM:")
+        ) {
+            ParsePath(line, 10, address, mailParameters);
+            recipients.clear();
+            state = State::Envelope;
+            HoldBack(OK_REPLY, output);
+        } else if (
+            (state == State::Envelope)
+            && IsCommand(line, "RCPT TO:")
+        ) {
+            Recipient recipient;
+            ParsePath(line, 8, recipient.address, recipient.parameters);
+            recipients.push_back(std::move(recipient));
+            HoldBack(OK_REPLY, output);
+        } else if (
+            (state == State::Envelope)
+            && IsCommand(line, "DATA")
+            && (line.find_first_not_of("\r\n", 4) == std::string::npos)
+        ) {
+            content.clear();
+            state = State::Content;
+            HoldBack(START_CONTENT_REPLY, output);
+        } else {
+            Expectation expectation;
+            if (IsCommand(line, "EHLO ")) {
+                expectation.kind = Expectation::Kind::RelayEhlo;
+            } else if (IsCommand(line, "RSET")) {
+                state = State::Idle;
+            }
+            expected.push_back(expectation);
+            output.Send(line);
+        }
+    }
+
+    /**
+     * Hold back the command from the client in the line buffer,
+     * sending a NOOP to the server in its place, and arrange for the
+     * server's reply to the NOOP to be replaced by the given reply.
+     *
+     * The client is given replies only when data is received from the
+     * server, in the order the client is expecting them, so the reply
+     * to a command held back follows the reply to the command before it.
+     *
+     * @param[in] translation
+     *     This is the reply to give the client.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void HoldBack(
+        const char* translation,
+        Output& output
+    ) {
+        Expectation expectation;
+        expectation.kind = Expectation::Kind::Translate;
+        expectation.translation = translation;
+        expected.push_back(expectation);
+        output.Send("NOOP\r\n");
+    }
+
+    /**
+     * Start sending the message content received from the client
+     * to each of its recipients.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void StartSending(Output& output) {
+        state = State::Sending;
+        rejected.assign(recipients.size(), false);
+        nextRecipient = 0;
+        accepted = 0;
+        lastRejection.clear();
+        if (recipients.empty()) {
+            Finish(output);
+        } else {
+            SendEnvelope(output);
+        }
+    }
+
+    /**
+     * Start the transaction of the next recipient.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void SendEnvelope(Output& output) {
+        const auto& recipient = recipients[nextRecipient];
+        output.Send(
+            "MAIL FROM:<"
+            + MakeReturnPath(returnPathTemplate, recipient.address)
+            + ">" + mailParameters + "\r\n"
+        );
+        Expect(Expectation::Kind::Mail);
+        if (pipelining) {
+            SendRecipient(output);
+            SendData(output);
+        }
+    }
+
+    /**
+     * Send the RCPT command of the transaction of the next recipient.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void SendRecipient(Output& output) {
+        const auto& recipient = recipients[nextRecipient];
+        output.Send("RCPT TO:<" + recipient.address + ">" + recipient.parameters + "\r\n");
+        Expect(Expectation::Kind::Rcpt);
+    }
+
+    /**
+     * Send the DATA command of the transaction of the next recipient.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void SendData(Output& output) {
+        output.Send("DATA\r\n");
+        Expect(Expectation::Kind::Data);
+    }
+
+    /**
+     * Arrange for the given kind of reply to the transaction
+     * of the next recipient to be handled.
+     *
+     * @param[in] kind
+     *     This is the kind of reply expected.
+     */
+    void Expect(Expectation::Kind kind) {
+        Expectation expectation;
+        expectation.kind = kind;
+        expectation.recipient = nextRecipient;
+        expected.push_back(expectation);
+    }
+
+    /**
+     * Move on to the transaction of the recipient after the one
+     * whose transaction was started most recently, if any.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void Advance(Output& output) {
+        if (++nextRecipient < recipients.size()) {
+            SendEnvelope(output);
+        }
+    }
+
+    /**
+     * Note that the server turned down the given recipient
+     * in the given reply.
+     *
+     * @param[in] recipient
+     *     This is the position of the recipient turned down.
+     *
+     * @param[in] reply
+     *     This is the reply in which the recipient was turned down.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void Reject(
+        size_t recipient,
+        const ReplyParser::Reply& reply,
+        Output& output
+    ) {
+        if (rejected[recipient]) {
+            return;
+        }
+        rejected[recipient] = true;
+        lastRejection = FormatReply(reply);
+        output.warnings.push_back(
+            "SMTP server turned down <" + recipients[recipient].address + ">: "
+            + lastRejection
+        );
+    }
+
+    /**
+     * Give the client the outcome of its transaction, and go back
+     * to passing its commands through.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void Finish(Output& output) {
+        state = State::Idle;
+        std::string outcome;
+        if (accepted > 0) {
+            outcome = (
+                "250 OK: accepted for " + std::to_string(accepted)
+                + " of " + std::to_string(recipients.size())
+                + " recipients\r\n"
+            );
+        } else if (!lastRejection.empty()) {
+            outcome = lastRejection + "\r\n";
+        } else {
+            outcome = NO_RECIPIENTS_REPLY;
+        }
+        output.Deliver(outcome.data(), outcome.size());
+        if (!heldClientData.empty()) {
+            std::vector< uint8_t > data;
+            data.swap(heldClientData);
+            HandleClientData(data.data(), data.size(), output);
+        }
+    }
+
+    /**
+     * Handle the given reply from the server.
+     *
+     * @param[in] reply
+     *     This is the reply received from the server.
+     *
+     * @param[in,out] output
+     *     This is where to put what to send as a result.
+     */
+    void OnReply(
+        const ReplyParser::Reply& reply,
+        Output& output
+    ) {
+        ++replyCount;
+        Expectation expectation;
+        if (!expected.empty()) {
+            expectation = expected.front();
+            expected.pop_front();
+        }
+        const auto positive = IsPositive(reply);
+        switch (expectation.kind) {
+            case Expectation::Kind::RelayEhlo: {
+                ReplyParser::Capabilities capabilities;
+                (void)ReplyParser::ParseCapabilities(reply, capabilities);
+                pipelining = capabilities.Has(ReplyParser::Capability::Pipelining);
+                output.Deliver(reply.lines.data, reply.lines.size);
+            } return;
+
+            case Expectation::Kind::Relay: {
+                output.Deliver(reply.lines.data, reply.lines.size);
+            } return;
+
+            case Expectation::Kind::Translate: {
+                output.Deliver(expectation.translation, strlen(expectation.translation));
+            } return;
+
+            case Expectation::Kind::Mail: {
+                if (!positive) {
+                    Reject(expectation.recipient, reply, output);
+                }
+                if (!pipelining) {
+                    if (positive) {
+                        SendRecipient(output);
+                    } else {
+                        Advance(output);
+                    }
+                }
+            } break;
+
+            case Expectation::Kind::Rcpt: {
+                if (!positive) {
+                    Reject(expectation.recipient, reply, output);
+                }
+                if (!pipelining) {
+                    if (positive) {
+                        SendData(output);
+                    } else {
+                        output.Send("RSET\r\n");
+                        Expect(Expectation::Kind::Reset);
+                    }
+                }
+            } break;
+
+            case Expectation::Kind::Data: {
+                if (reply.code == 354) {
+                    output.SendContent();
+                    Expect(Expectation::Kind::Content);
+                } else {
+                    Reject(expectation.recipient, reply, output);
+                    output.Send("RSET\r\n");
+                    Expect(Expectation::Kind::Reset);
+                }
+                if (pipelining) {
+                    // The commands of the next transaction may follow
+                    // the content of this one in the same group
+                    // (RFC 2920 section 3.1).
+                    Advance(output);
+                }
+            } break;
+
+            case Expectation::Kind::Content: {
+                if (positive) {
+                    ++accepted;
+                } else {
+                    Reject(expectation.recipient, reply, output);
+                }
+                if (!pipelining) {
+                    Advance(output);
+                }
+            } break;
+
+            case Expectation::Kind::Reset: {
+                if (!pipelining) {
+                    Advance(output);
+                }
+            } break;
+        }
+        if (
+            (nextRecipient >= recipients.size())
+            && expected.empty()
+        ) {
+            Finish(output);
+        }
+    }
+};
+
+VerpConnection::~VerpConnection() noexcept = default;
+
+VerpConnection::VerpConnection(
+    std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer,
+    const std::string& returnPathTemplate,
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+)
+    : impl_(new Impl())
+{
+    impl_->lowerLayer = lowerLayer;
+    impl_->returnPathTemplate = returnPathTemplate;
+    impl_->diagnosticMessageDelegate = diagnosticMessageDelegate;
+}
+
+std::string VerpConnection::MakeReturnPath(
+    const std::string& returnPathTemplate,
+    const std::string& recipient
+) {
+    const auto delimiter = recipient.rfind('@');
+    const auto local = recipient.substr(0, delimiter);
+    const auto domain = (
+        (delimiter == std::string::npos)
+        ? std::string()
+        : recipient.substr(delimiter + 1)
+    );
+    std::string returnPath;
+    size_t position = 0;
+    for (;;) {
+        const auto placeholder = returnPathTemplate.find('{', position);
+        if (placeholder == std::string::npos) {
+            break;
+        }
+        returnPath += returnPathTemplate.substr(position, placeholder - position);
+        if (returnPathTemplate.compare(placeholder, 7, "{local}") == 0) {
+            returnPath += local;
+            position = placeholder + 7;
+        } else if (returnPathTemplate.compare(placeholder, 8, "{domain}") == 0) {
+            returnPath += domain;
+            position = placeholder + 8;
+        } else {
+            returnPath += '{';
+            position = placeholder + 1;
+        }
+    }
+    returnPath += returnPathTemplate.substr(position);
+    return returnPath;
+}
+
+uint64_t VerpConnection::GetReplyCount() const {
+    return impl_->replyCount;
+}
+
+SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate VerpConnection::SubscribeToDiagnostics(
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+    size_t minLevel
+) {
+    return impl_->lowerLayer->SubscribeToDiagnostics(delegate, minLevel);
+}
+
+bool VerpConnection::Connect(uint32_t peerAddress, uint16_t peerPort) {
+    return impl_->lowerLayer->Connect(peerAddress, peerPort);
+}
+
+bool VerpConnection::Process(
+    MessageReceivedDelegate messageReceivedDelegate,
+    BrokenDelegate brokenDelegate
+) {
+    const auto impl = impl_.get();
+    impl->messageReceivedDelegate = messageReceivedDelegate;
+    return impl_->lowerLayer->Process(
+        [impl](const std::vector< uint8_t >& message){
+            Impl::Output output;
+            {
+                std::lock_guard< decltype(impl->mutex) > lock(impl->mutex);
+                impl->replyOutput = &output;
+                if (!impl->parser.Parse(message.data(), message.size())) {
+                    // Pass along anything which can't be made sense of,
+                    // and let the client deal with it.
+                    output.toClient.insert(
+                        output.toClient.end(),
+                        message.begin(),
+                        message.end()
+                    );
+                }
+                impl->replyOutput = nullptr;
+            }
+            impl->Flush(output);
+        },
+        brokenDelegate
+    );
+}
+
+uint32_t VerpConnection::GetPeerAddress() const {
+    return impl_->lowerLayer->GetPeerAddress();
+}
+
+uint16_t VerpConnection::GetPeerPort() const {
+    return impl_->lowerLayer->GetPeerPort();
+}
+
+bool VerpConnection::IsConnected() const {
+    return impl_->lowerLayer->IsConnected();
+}
+
+uint32_t VerpConnection::GetBoundAddress() const {
+    return impl_->lowerLayer->GetBoundAddress();
+}
+
+uint16_t VerpConnection::GetBoundPort() const {
+    return impl_->lowerLayer->GetBoundPort();
+}
+
+void VerpConnection::SendMessage(const std::vector< uint8_t >& message) {
+    Impl::Output output;
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        impl_->HandleClientData(message.data(), message.size(), output);
+    }
+    impl_->Flush(output);
+}
+
+void VerpConnection::Close(bool clean) {
+    impl_->lowerLayer->Close(clean);
+}
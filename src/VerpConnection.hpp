@@ -0,0 +1,134 @@
+#ifndef NEWMAN_VERP_CONNECTION_HPP
+#define NEWMAN_VERP_CONNECTION_HPP
+
+/**
+ * @file VerpConnection.hpp
+ *
+ * This module declares the VerpConnection class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <SystemAbstractions/DiagnosticsSender.hpp>
+#include <SystemAbstractions/INetworkConnection.hpp>
+
+/**
+ * This decorates a network connection to an SMTP server, turning each
+ * mail transaction of the SMTP client into one transaction for each
+ * recipient, with a return path (MAIL FROM) made for that recipient
+ * (variable envelope return path, or VERP), so that a bounce can be
+ * traced back to the recipient for whom it was sent.
+ *
+ * The client sends the message content once, and the decorator holds
+ * onto it, sending the same bytes in each transaction, so the cost of
+ * each recipient beyond the first is only the MAIL, RCPT, and DATA
+ * commands.  If the server supports pipelining (RFC 2920), the commands
+ * of each transaction are sent together, right after the content of the
+ * transaction before, without waiting for the replies in between.
+ *
+ * The client is told the transaction succeeded if the message was
+ * accepted for any recipient, and otherwise is given the last reply
+ * in which the server turned down a recipient.  Recipients turned down
+ * are reported as warnings.
+ */
+class VerpConnection
+    : public SystemAbstractions::INetworkConnection
+{
+    // Lifecycle management
+public:
+    ~VerpConnection() noexcept;
+    VerpConnection(const VerpConnection&) = delete;
+    VerpConnection(VerpConnection&&) noexcept = delete;
+    VerpConnection& operator=(const VerpConnection&) = delete;
+    VerpConnection& operator=(VerpConnection&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] lowerLayer
+     *     This is the connection to decorate.
+     *
+     * @param[in] returnPathTemplate
+     *     This is the template from which to make the return path
+     *     of each recipient, as described for MakeReturnPath.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish warnings about
+     *     recipients turned down by the server.
+     */
+    VerpConnection(
+        std::shared_ptr< SystemAbstractions::INetworkConnection > lowerLayer,
+        const std::string& returnPathTemplate,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    );
+
+    /**
+     * Make the return path for the given recipient from the given
+     * template, by replacing "{local}" with the local part of the
+     * recipient's address and "{domain}" with its domain.
+     *
+     * @param[in] returnPathTemplate
+     *     This is the template from which to make the return path,
+     *     such as "bounces+{local}={domain}@example.com".
+     *
+     * @param[in] recipient
+     *     This is the address of the recipient.
+     *
+     * @return
+     *     The return path for the recipient is returned.
+     */
+    static std::string MakeReturnPath(
+        const std::string& returnPathTemplate,
+        const std::string& recipient
+    );
+
+    /**
+     * Return the number of replies received from the server so far,
+     * including those to the commands of each recipient's transaction,
+     * which the client never sees.
+     *
+     * @return
+     *     The number of replies received from the server is returned.
+     */
+    uint64_t GetReplyCount() const;
+
+    // SystemAbstractions::INetworkConnection
+public:
+    virtual SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+        size_t minLevel = 0
+    ) override;
+    virtual bool Connect(uint32_t peerAddress, uint16_t peerPort) override;
+    virtual bool Process(
+        MessageReceivedDelegate messageReceivedDelegate,
+        BrokenDelegate brokenDelegate
+    ) override;
+    virtual uint32_t GetPeerAddress() const override;
+    virtual uint16_t GetPeerPort() const override;
+    virtual bool IsConnected() const override;
+    virtual uint32_t GetBoundAddress() const override;
+    virtual uint16_t GetBoundPort() const override;
+    virtual void SendMessage(const std::vector< uint8_t >& message) override;
+    virtual void Close(bool clean = false) override;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr< Impl > impl_;
+};
+
+#endif /* NEWMAN_VERP_CONNECTION_HPP */
@@ -0,0 +1,136 @@
+/**
+ * @file WellKnownHeaders.cpp
+ *
+ * This module contains the implementation of the functions used
+ * to classify e-mail header names.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include "WellKnownHeaders.hpp"
+
+namespace {
+
+    /**
+     * Compare the given header name with the canonical name of
+     * the given well-known header, without regard to case.
+     *
+     * @param[in] name
+     *     This is the header name to compare.
+     *
+     * @param[in] header
+     *     This is the well-known header whose name should be compared.
+     *
+     * @return
+     *     An indication of whether or not the names match is returned.
+     */
+    bool NameMatches(
+        const std::string& name,
+        WellKnownHeader header
+    ) {
+        const char* canonical = GetWellKnownHeaderName(header);
+        for (const auto c: name) {
+            if (*canonical == 0) {
+                return false;
+            }
+            const auto lhs = ((c >= 'A') && (c <= 'Z')) ? (c - 'A' + 'a') : c;
+            const auto rhs = (
+                ((*canonical >= 'A') && (*canonical <= 'Z'))
+                ? (*canonical - 'A' + 'a')
+                : *canonical
+            );
+            if (lhs != rhs) {
+                return false;
+            }
+            ++canonical;
+        }
+        return (*canonical == 0);
+    }
+
+    /**
+     * Compute the same hash as HashHeaderName, but with a loop rather than
+     * recursion, since it's used at run time on arbitrary header names.
+     *
+     * @param[in] name
+     *     This is the header name to hash.
+     *
+     * @return
+     *     The hash of the header name is returned.
+     */
+    uint32_t HashHeaderNameAtRunTime(const std::string& name) {
+        uint32_t hash = 2166136261u;
+        for (const auto c: name) {
+            const auto lower = ((c >= 'A') && (c <= 'Z')) ? (c - 'A' + 'a') : c;
+            hash = (
+                hash
+                ^ static_cast< uint32_t >(static_cast< unsigned char >(lower))
+            ) * 16777619u;
+        }
+        return hash;
+    }
+
+}
+
+WellKnownHeader ClassifyHeaderName(const std::string& name) {
+    // The case labels are all computed at compile time, and the compiler
+    // rejects duplicate case labels, so this switch is a perfect hash
+    // over the well-known header names.  Any name which hashes to one of
+    // them still needs a single comparison to rule out a collision with
+    // a header which isn't well-known.
+    WellKnownHeader candidate;
+    switch (HashHeaderNameAtRunTime(name)) {
+        case HashWellKnownHeaderName(WellKnownHeader::To): candidate = WellKnownHeader::To; break;
+        case HashWellKnownHeaderName(WellKnownHeader::From): candidate = WellKnownHeader::From; break;
+        case HashWellKnownHeaderName(WellKnownHeader::Cc): candidate = WellKnownHeader::Cc; break;
+        case HashWellKnownHeaderName(WellKnownHeader::Bcc): candidate = WellKnownHeader::Bcc; break;
+        case HashWellKnownHeaderName(WellKnownHeader::ReplyTo): candidate = WellKnownHeader::ReplyTo; break;
+        case HashWellKnownHeaderName(WellKnownHeader::Sender): candidate = WellKnownHeader::Sender; break;
+        case HashWellKnownHeaderName(WellKnownHeader::Subject): candidate = WellKnownHeader::Subject; break;
+        case HashWellKnownHeaderName(WellKnownHeader::MessageId): candidate = WellKnownHeader::MessageId; break;
+        case HashWellKnownHeaderName(WellKnownHeader::Date): candidate = WellKnownHeader::Date; break;
+        case HashWellKnownHeaderName(WellKnownHeader::MimeVersion): candidate = WellKnownHeader::MimeVersion; break;
+        case HashWellKnownHeaderName(WellKnownHeader::ContentType): candidate = WellKnownHeader::ContentType; break;
+        case HashWellKnownHeaderName(WellKnownHeader::ContentTransferEncoding): candidate = WellKnownHeader::ContentTransferEncoding; break;
+        case HashWellKnownHeaderName(WellKnownHeader::ContentLanguage): candidate = WellKnownHeader::ContentLanguage; break;
+        case HashWellKnownHeaderName(WellKnownHeader::ContentDisposition): candidate = WellKnownHeader::ContentDisposition; break;
+        case HashWellKnownHeaderName(WellKnownHeader::ContentId): candidate = WellKnownHeader::ContentId; break;
+        case HashWellKnownHeaderName(WellKnownHeader::ContentDescription): candidate = WellKnownHeader::ContentDescription; break;
+        case HashWellKnownHeaderName(WellKnownHeader::XSmtpServerHostname): candidate = WellKnownHeader::XSmtpServerHostname; break;
+        case HashWellKnownHeaderName(WellKnownHeader::XSmtpPort): candidate = WellKnownHeader::XSmtpPort; break;
+        case HashWellKnownHeaderName(WellKnownHeader::XSmtpUsername): candidate = WellKnownHeader::XSmtpUsername; break;
+        case HashWellKnownHeaderName(WellKnownHeader::XSmtpPassword): candidate = WellKnownHeader::XSmtpPassword; break;
+        case HashWellKnownHeaderName(WellKnownHeader::XTenant): candidate = WellKnownHeader::XTenant; break;
+        default: return WellKnownHeader::Count;
+    }
+    if (NameMatches(name, candidate)) {
+        return candidate;
+    } else {
+        return WellKnownHeader::Count;
+    }
+}
+
+WellKnownHeaderValues ClassifyHeaders(const MessageHeaders::MessageHeaders& headers) {
+    WellKnownHeaderValues values;
+    for (const auto& header: headers.GetAll()) {
+        const auto classification = ClassifyHeaderName(header.name);
+        if (classification == WellKnownHeader::Count) {
+            continue;
+        }
+        if (values.Has(classification)) {
+            switch (classification) {
+                case WellKnownHeader::To:
+                case WellKnownHeader::Cc:
+                case WellKnownHeader::Bcc: {
+                    values[classification] += ", ";
+                    values[classification] += header.value;
+                } break;
+
+                default: break;
+            }
+            continue;
+        }
+        values[classification] = header.value;
+        values.present[static_cast< size_t >(classification)] = true;
+    }
+    return values;
+}
@@ -0,0 +1,232 @@
+#ifndef NEWMAN_WELL_KNOWN_HEADERS_HPP
+#define NEWMAN_WELL_KNOWN_HEADERS_HPP
+
+/**
+ * @file WellKnownHeaders.hpp
+ *
+ * This module declares the WellKnownHeader enumeration and the functions
+ * used to classify e-mail header names into it.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <MessageHeaders/MessageHeaders.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * This identifies a header which Newman knows about and may need to look up
+ * while sending an e-mail.
+ */
+enum class WellKnownHeader : size_t {
+    To,
+    From,
+    Cc,
+    Bcc,
+    ReplyTo,
+    Sender,
+    Subject,
+    MessageId,
+    Date,
+    MimeVersion,
+    ContentType,
+    ContentTransferEncoding,
+    ContentLanguage,
+    ContentDisposition,
+    ContentId,
+    ContentDescription,
+    XSmtpServerHostname,
+    XSmtpPort,
+    XSmtpUsername,
+    XSmtpPassword,
+    XTenant,
+
+    /**
+     * This is the number of well-known headers.  It's also used
+     * as the classification of any header which isn't well-known.
+     */
+    Count,
+};
+
+/**
+ * These are the canonical names of the well-known headers, in the same
+ * order as the WellKnownHeader enumeration.
+ */
+constexpr const char* WELL_KNOWN_HEADER_NAMES[] = {
+    "To",
+    "From",
+    "Cc",
+    "Bcc",
+    "Reply-To",
+    "Sender",
+    "Subject",
+    "Message-ID",
+    "Date",
+    "MIME-Version",
+    "Content-Type",
+    "Content-Transfer-Encoding",
+    "Content-Language",
+    "Content-Disposition",
+    "Content-ID",
+    "Content-Description",
+    "X-SMTP-Server-Hostname",
+    "X-SMTP-Port",
+    "X-SMTP-Username",
+    "X-SMTP-Password",
+    "X-Tenant",
+};
+static_assert(
+    sizeof(WELL_KNOWN_HEADER_NAMES) / sizeof(WELL_KNOWN_HEADER_NAMES[0])
+    == static_cast< size_t >(WellKnownHeader::Count),
+    "every well-known header needs a name"
+);
+
+/**
+ * This computes a case-insensitive 32-bit FNV-1a hash of the given
+ * header name.  It can be evaluated at compile time, which is how
+ * the classification table is generated and checked for collisions.
+ *
+ * @param[in] name
+ *     This is the header name to hash.
+ *
+ * @param[in] length
+ *     This is the number of characters of the name to hash.
+ *
+ * @param[in] hash
+ *     This is the hash of the characters which came before the
+ *     given name.
+ *
+ * @return
+ *     The hash of the header name is returned.
+ */
+constexpr uint32_t HashHeaderName(
+    const char* name,
+    size_t length,
+    uint32_t hash = 2166136261u
+) {
+    return (
+        (length == 0)
+        ? hash
+        : HashHeaderName(
+            name + 1,
+            length - 1,
+            (
+                hash
+                ^ static_cast< uint32_t >(
+                    static_cast< unsigned char >(
+                        ((*name >= 'A') && (*name <= 'Z'))
+                        ? (*name - 'A' + 'a')
+                        : *name
+                    )
+                )
+            ) * 16777619u
+        )
+    );
+}
+
+/**
+ * This returns the length of the given C string.  It can be evaluated
+ * at compile time.
+ *
+ * @param[in] s
+ *     This is the string whose length should be returned.
+ *
+ * @return
+ *     The length of the given string is returned.
+ */
+constexpr size_t ConstexprStringLength(const char* s) {
+    return (*s == 0) ? 0 : 1 + ConstexprStringLength(s + 1);
+}
+
+/**
+ * This returns the hash of the canonical name of the given
+ * well-known header.
+ *
+ * @param[in] header
+ *     This is the well-known header whose name's hash should be returned.
+ *
+ * @return
+ *     The hash of the name of the given well-known header is returned.
+ */
+constexpr uint32_t HashWellKnownHeaderName(WellKnownHeader header) {
+    return HashHeaderName(
+        WELL_KNOWN_HEADER_NAMES[static_cast< size_t >(header)],
+        ConstexprStringLength(WELL_KNOWN_HEADER_NAMES[static_cast< size_t >(header)])
+    );
+}
+
+/**
+ * This returns the canonical name of the given well-known header.
+ *
+ * @param[in] header
+ *     This is the well-known header whose name should be returned.
+ *
+ * @return
+ *     The canonical name of the given well-known header is returned.
+ */
+inline const char* GetWellKnownHeaderName(WellKnownHeader header) {
+    return WELL_KNOWN_HEADER_NAMES[static_cast< size_t >(header)];
+}
+
+/**
+ * Determine which well-known header, if any, has the given name.
+ * Header names are compared without regard to case.
+ *
+ * @param[in] name
+ *     This is the header name to classify.
+ *
+ * @return
+ *     The well-known header with the given name is returned.
+ *
+ * @retval WellKnownHeader::Count
+ *     This is returned if the given name is not that of
+ *     a well-known header.
+ */
+WellKnownHeader ClassifyHeaderName(const std::string& name);
+
+/**
+ * This holds the value of each well-known header of an e-mail,
+ * indexed by classification so that looking one up doesn't involve
+ * any string comparisons.
+ */
+struct WellKnownHeaderValues {
+    /**
+     * These are the values of the well-known headers.  A header
+     * which isn't present has an empty value.
+     */
+    std::string values[static_cast< size_t >(WellKnownHeader::Count)];
+
+    /**
+     * These flags indicate which well-known headers are present.
+     */
+    bool present[static_cast< size_t >(WellKnownHeader::Count)] = {};
+
+    std::string& operator[](WellKnownHeader header) {
+        return values[static_cast< size_t >(header)];
+    }
+
+    const std::string& operator[](WellKnownHeader header) const {
+        return values[static_cast< size_t >(header)];
+    }
+
+    bool Has(WellKnownHeader header) const {
+        return present[static_cast< size_t >(header)];
+    }
+};
+
+/**
+ * Classify every header of an e-mail, collecting the values of
+ * the well-known ones.  If a well-known header appears more than once,
+ * only the first occurrence is kept, except for the address-list headers
+ * (To, Cc, Bcc), whose occurrences are joined into a single list.
+ *
+ * @param[in] headers
+ *     These are the headers of the e-mail.
+ *
+ * @return
+ *     The values of the well-known headers are returned.
+ */
+WellKnownHeaderValues ClassifyHeaders(const MessageHeaders::MessageHeaders& headers);
+
+#endif /* NEWMAN_WELL_KNOWN_HEADERS_HPP */
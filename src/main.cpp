@@ -7,11 +7,16 @@
  * © 2019 by Richard Walters
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <Hash/Sha2.hpp>
 #include <inttypes.h>
 #include <MessageHeaders/MessageHeaders.hpp>
+#include <mutex>
 #include <Sasl/Client/Login.hpp>
 #include <Sasl/Client/Plain.hpp>
 #include <Sasl/Client/Scram.hpp>
@@ -24,14 +29,255 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <thread>
 #include <TlsDecorator/TlsDecorator.hpp>
 
+#ifdef _WIN32
+#include <Windows.h>
+#else /* POSIX */
+#include <dirent.h>
+#endif /* _WIN32 / POSIX */
+
+#include "AdaptiveTimeouts.hpp"
+#include "AddressList.hpp"
+#include "BodyEncoding.hpp"
+#include "BodyStore.hpp"
+#include "BufferPool.hpp"
+#include "DeliveryIndex.hpp"
+#include "HandshakeLimiter.hpp"
+#include "HashRing.hpp"
+#include "LoadGenerator.hpp"
+#include "RecordingConnection.hpp"
+#include "ReplyMonitor.hpp"
+#include "Resolver.hpp"
+#include "RoutingTable.hpp"
+#include "SourceAddressPool.hpp"
+#include "SourceBoundConnection.hpp"
+#include "SpoolLease.hpp"
+#include "Stats.hpp"
+#include "TcpInfo.hpp"
+#include "VerpConnection.hpp"
+#include "WellKnownHeaders.hpp"
+
 namespace {
 
+    /**
+     * This keeps track of how much memory sessions hold while idle,
+     * between one e-mail and the next.
+     */
+    struct IdleSessionMemory {
+        /**
+         * This is the number of times an idle session was sampled.
+         */
+        std::atomic< uint64_t > samples{0};
+
+        /**
+         * This is the total number of bytes of receive buffers
+         * held by the sessions sampled.
+         */
+        std::atomic< uint64_t > bufferBytes{0};
+
+        /**
+         * This is the total number of bytes the kernel had allocated
+         * for the sockets of the sessions sampled.
+         */
+        std::atomic< uint64_t > kernelBytes{0};
+
+        /**
+         * This is the largest number of bytes held by any one session
+         * sampled, counting both its receive buffers and its socket.
+         */
+        std::atomic< uint64_t > peakBytes{0};
+
+        /**
+         * Add the given sample of the memory held by an idle session.
+         *
+         * @param[in] usage
+         *     This is how much memory the connection of the session held.
+         */
+        void Add(const SourceBoundConnection::MemoryUsage& usage) {
+            ++samples;
+            bufferBytes += usage.bufferBytes;
+            kernelBytes += usage.kernelBytes;
+            const uint64_t total = usage.bufferBytes + usage.kernelBytes;
+            auto peak = peakBytes.load();
+            while (
+                (total > peak)
+                && !peakBytes.compare_exchange_weak(peak, total)
+            ) {
+            }
+        }
+
+        /**
+         * Render the statistics in a human-readable form.
+         *
+         * @return
+         *     The statistics in human-readable form are returned.
+         */
+        std::string ToString() const {
+            const uint64_t numSamples = samples;
+            return (
+                std::to_string(bufferBytes / numSamples)
+                + " bytes of receive buffers and "
+                + std::to_string(kernelBytes / numSamples)
+                + " bytes of kernel socket memory on average (peak "
+                + std::to_string(peakBytes)
+                + " bytes in all), over "
+                + std::to_string(numSamples)
+                + " samples"
+            );
+        }
+    };
+
     struct SmtpTransport
         : public Smtp::Client::Transport
     {
-        std::string caCerts;
+        /**
+         * These are the certificates of the certificate authorities
+         * trusted by the client.  They may be replaced at any time,
+         * so they're only accessed with std::atomic_load and
+         * std::atomic_store.  Connections already made keep using
+         * the certificates they were made with.
+         */
+        std::shared_ptr< const std::string > caCerts = std::make_shared< const std::string >();
+
+        /**
+         * This indicates whether or not connections are protected by TLS.
+         */
+        bool useTls = true;
+
+        /**
+         * This is the path to the file in which to record the session
+         * of the next connection made, or an empty string if sessions
+         * aren't recorded.
+         */
+        std::string traceFileName;
+
+        /**
+         * This is used to limit how many connections may be setting up
+         * at the same time.
+         */
+        std::shared_ptr< HandshakeLimiter > handshakeLimiter;
+
+        /**
+         * These are the local addresses to which connections are bound.
+         * If there are none, the operating system chooses.
+         */
+        std::shared_ptr< SourceAddressPool > sourceAddresses;
+
+        /**
+         * These are the buffers shared by connections, each borrowing
+         * one only while it has data to receive.
+         */
+        std::shared_ptr< BufferPool > receiveBuffers;
+
+        /**
+         * This is where to add samples of the memory held by the
+         * session of the transport while it's idle, or nullptr if
+         * they aren't kept.
+         */
+        std::shared_ptr< IdleSessionMemory > idleMemory;
+
+        /**
+         * This is how long to wait for the TCP connection to the
+         * SMTP server to be made, or zero to wait as long as the
+         * operating system does.
+         */
+        std::chrono::milliseconds connectTimeout = std::chrono::milliseconds(0);
+
+        /**
+         * This is the TCP connection to the SMTP server most recently
+         * connected, if it's a SourceBoundConnection.
+         */
+        std::shared_ptr< SourceBoundConnection > sourceBoundConnection;
+
+        /**
+         * This is used to look up the addresses of SMTP servers.
+         * If it's nullptr, the system resolver is called directly.
+         */
+        std::shared_ptr< Resolver > resolver;
+
+        /**
+         * This is the template from which to make a return path for each
+         * recipient, sending each recipient a transaction of its own,
+         * or an empty string if transactions are sent as they are.
+         */
+        std::string returnPathTemplate;
+
+        /**
+         * This turns each transaction into one for each recipient,
+         * if a return path template was given.
+         */
+        std::shared_ptr< VerpConnection > verp;
+
+        /**
+         * This is the function to call to publish any diagnostic messages
+         * from the connections made by the transport.
+         */
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate;
+
+        /**
+         * This indicates whether or not the transport is counted by
+         * the handshake limiter as setting up a connection.
+         */
+        std::atomic< bool > settingUp{false};
+
+        /**
+         * This is the host name and port number of the SMTP server
+         * most recently connected, used to label TCP statistics.
+         */
+        std::string destination;
+
+        /**
+         * This is used to sample the TCP statistics of the connection
+         * to the SMTP server.
+         */
+        TcpInfoSampler tcpInfo;
+
+        /**
+         * These are the TCP statistics of the connection to the SMTP
+         * server, sampled as soon as the connection was made.
+         */
+        TcpInfoSample connectTcpInfo;
+
+        /**
+         * This keeps track of the capabilities and negative replies
+         * of the SMTP server most recently connected.
+         */
+        std::shared_ptr< ReplyMonitor > replies;
+
+        /**
+         * Indicate that the connection is done setting up, whether or not
+         * it succeeded, so that another connection may begin setting up.
+         */
+        void SetupFinished() {
+            if (settingUp.exchange(false)) {
+                handshakeLimiter->Release();
+            }
+        }
+
+        /**
+         * Give back the transport's place among the connections setting
+         * up, in case it's dropped while still setting up, such as when
+         * a connection is made but never becomes ready.
+         */
+        ~SmtpTransport() noexcept {
+            SetupFinished();
+        }
+
+        /**
+         * Add a sample of the memory held by the connection to the
+         * SMTP server, which is waiting for the next e-mail to send.
+         */
+        void SampleIdleMemory() {
+            if (
+                (idleMemory != nullptr)
+                && (sourceBoundConnection != nullptr)
+            ) {
+                idleMemory->Add(sourceBoundConnection->GetMemoryUsage());
+            }
+        }
 
         // Smtp::Client::Transport
 
@@ -39,25 +285,92 @@ namespace {
             const std::string& hostNameOrAddress,
             uint16_t port
         ) override {
-            std::shared_ptr< SystemAbstractions::INetworkConnection > serverConnection
-                = std::make_shared< SystemAbstractions::NetworkConnection >();
-            std::shared_ptr < TlsDecorator::TlsDecorator > tls;
-            tls = std::make_shared< TlsDecorator::TlsDecorator >();
-            tls->ConfigureAsClient(
-                serverConnection,
-                caCerts,
-                hostNameOrAddress
+            std::shared_ptr< SystemAbstractions::INetworkConnection > tcpConnection;
+#ifndef _WIN32
+            // SourceBoundConnection doesn't hold a receive buffer while
+            // idle, and gives up connecting after a timeout, so it's used
+            // wherever it's supported, whether or not there are any
+            // local addresses to which to bind.
+            sourceBoundConnection = std::make_shared< SourceBoundConnection >(
+                sourceAddresses,
+                receiveBuffers
             );
-            serverConnection = tls;
-            const auto hostAddress = SystemAbstractions::NetworkConnection::GetAddressOfHost(
-                hostNameOrAddress
+            sourceBoundConnection->SetConnectTimeout(connectTimeout);
+            if (diagnosticMessageDelegate != nullptr) {
+                (void)sourceBoundConnection->SubscribeToDiagnostics(diagnosticMessageDelegate);
+            }
+            tcpConnection = sourceBoundConnection;
+#else /* _WIN32 */
+            if (
+                (sourceAddresses != nullptr)
+                && !sourceAddresses->IsEmpty()
+            ) {
+                // This reports that binding isn't supported here.
+                tcpConnection = std::make_shared< SourceBoundConnection >(
+                    sourceAddresses,
+                    receiveBuffers
+                );
+                if (diagnosticMessageDelegate != nullptr) {
+                    (void)tcpConnection->SubscribeToDiagnostics(diagnosticMessageDelegate);
+                }
+            } else {
+                tcpConnection = std::make_shared< SystemAbstractions::NetworkConnection >();
+            }
+#endif /* not _WIN32 / _WIN32 */
+            std::shared_ptr< SystemAbstractions::INetworkConnection > serverConnection = tcpConnection;
+            if (useTls) {
+                std::shared_ptr < TlsDecorator::TlsDecorator > tls;
+                tls = std::make_shared< TlsDecorator::TlsDecorator >();
+                const auto currentCaCerts = std::atomic_load(&caCerts);
+                tls->ConfigureAsClient(
+                    serverConnection,
+                    *currentCaCerts,
+                    hostNameOrAddress
+                );
+                serverConnection = tls;
+            }
+            // Sessions are recorded as the server sees them, so below
+            // the layer which turns one transaction into several.
+            if (!traceFileName.empty()) {
+                const auto trace = std::make_shared< SessionTraceWriter >();
+                if (trace->Open(traceFileName)) {
+                    serverConnection = std::make_shared< RecordingConnection >(
+                        serverConnection,
+                        trace
+                    );
+                } else if (diagnosticMessageDelegate != nullptr) {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                        "Unable to record session to '" + traceFileName + "'"
+                    );
+                }
+            }
+            if (!returnPathTemplate.empty()) {
+                verp = std::make_shared< VerpConnection >(
+                    serverConnection,
+                    returnPathTemplate,
+                    diagnosticMessageDelegate
+                );
+                serverConnection = verp;
+            }
+            replies = std::make_shared< ReplyMonitor >(serverConnection);
+            serverConnection = replies;
+            const auto hostAddress = (
+                (resolver == nullptr)
+                ? SystemAbstractions::NetworkConnection::GetAddressOfHost(hostNameOrAddress)
+                : resolver->Resolve(hostNameOrAddress).get()
             );
             if (hostAddress == 0) {
                 return nullptr;
             }
             if (!serverConnection->Connect(hostAddress, port)) {
+                SetupFinished();
                 return nullptr;
             }
+            destination = hostNameOrAddress + ":" + std::to_string(port);
+            tcpInfo.Attach(sourceBoundConnection);
+            connectTcpInfo = tcpInfo.Sample();
             return serverConnection;
         }
     };
@@ -70,7 +383,7 @@ namespace {
         fprintf(
             stderr,
             (
-                "Usage: Newman MAIL CERTS\n"
+                "Usage: Newman [OPTIONS] MAIL CERTS\n"
                 "\n"
                 "Send an e-mail using SMTP.\n"
                 "\n"
@@ -78,11 +391,105 @@ namespace {
                         "the e-mail to send.  The e-mail should contain custom headers\n"
                         "(X-SMTP-Hostname, X-SMTP-Port, X-SMTP-Username, X_SMTP-Password)\n"
                         "which are stripped out before sending, and used to configure\n"
-                        "the SMTP client.\n"
+                        "the SMTP client.  If MAIL is a directory, every .eml file\n"
+                        "in it is sent, reusing sessions where possible.\n"
                 "\n"
                 "CERTS  Path to file (in Privacy Enhanced Mail format, or .pem)\n"
                         "containing one or more SSL certificates which the client should\n"
                         "consider trusted and root certificate authorites.\n"
+                "\n"
+                "Options:\n"
+                "\n"
+                "--latency-history=PATH\n"
+                        "Path to file in which to keep how long each phase of\n"
+                        "sending e-mail took with each SMTP server, so that\n"
+                        "timeouts can be adapted to each server.\n"
+                "--timeout-percentile=P   (default: 99)\n"
+                "--timeout-multiplier=M   (default: 3)\n"
+                        "Wait M times the P-th percentile of past durations\n"
+                        "of a phase before giving up on it.\n"
+                "--timeout-floor=MS       (default: 500)\n"
+                "--timeout-ceiling=MS     (default: 60000)\n"
+                        "Limits on timeouts, in milliseconds.\n"
+                "--timeout-initial=MS     (default: 5000)\n"
+                        "Timeout used until enough durations are known.\n"
+                "--max-handshakes=N       (default: 0, or no limit)\n"
+                        "Maximum number of connections which may be performing\n"
+                        "the TLS handshake and authenticating at the same time.\n"
+                "--max-destinations=N     (default: 0, or no limit)\n"
+                        "Maximum number of SMTP servers (or accounts) to which\n"
+                        "to send a batch of e-mails at the same time.\n"
+                "--source-addresses=A,B,...\n"
+                        "Local addresses from which to connect to SMTP servers.\n"
+                "--source-selection=round-robin|least-loaded\n"
+                        "How to choose the local address for each connection.\n"
+                "--max-connections-per-source=N  (default: 0, or no limit)\n"
+                        "Maximum number of connections open from any one\n"
+                        "local address.\n"
+                "--load-sessions=N        (default: 0, or no load test)\n"
+                        "Load-test the SMTP server by sending MAIL over and over\n"
+                        "using N concurrent sessions.\n"
+                "--load-rate=R            (default: 10)\n"
+                        "Average number of messages to send per second.\n"
+                "--load-arrivals=poisson|constant\n"
+                        "How the times at which messages are sent are spaced.\n"
+                "--load-duration=S        (default: 60)\n"
+                        "Number of seconds to keep starting new messages.\n"
+                "--load-drain=S           (default: 10)\n"
+                        "Number of seconds after that to finish messages\n"
+                        "held back because every session was busy.\n"
+                "--load-seed=N            (default: 1)\n"
+                        "Seed for the times at which messages are sent.\n"
+                "--load-report=PREFIX\n"
+                        "Write the latency distribution of each phase to\n"
+                        "PREFIX.PHASE.hgrm in HdrHistogram's format.\n"
+                "--tls=on|off             (default: on)\n"
+                        "Whether or not to protect connections with TLS.\n"
+                "--record=PATH\n"
+                        "Record the bytes exchanged with the SMTP server,\n"
+                        "and when, to PATH (PATH.N for each session of a load\n"
+                        "test), for replay by NewmanReplay.\n"
+                "--delivered-index=PATH\n"
+                        "Path to file in which to keep track of e-mails the\n"
+                        "SMTP server has accepted, by Message-ID and by a hash\n"
+                        "of recipients and body.  E-mails found in it are\n"
+                        "skipped rather than sent again.\n"
+                "--delivered-retention=HOURS  (default: 168)\n"
+                        "How long to remember each e-mail accepted.\n"
+                "--routes=PATH\n"
+                        "Path to file of routes choosing the SMTP server and\n"
+                        "credentials of e-mails by X-Tenant header, sender\n"
+                        "domain, or recipient domain.  E-mails with the custom\n"
+                        "X-SMTP headers use those instead.\n"
+                "--node=ID\n"
+                        "Claim each e-mail of a MAIL directory shared with other\n"
+                        "Newman processes before sending it, as node ID, and\n"
+                        "remove it once sent.\n"
+                "--nodes=ID,ID,...\n"
+                        "Nodes sharing the MAIL directory.  Each SMTP server\n"
+                        "is assigned to one node, which sends all its e-mails.\n"
+                "--lease=SECONDS          (default: 300)\n"
+                        "How long a claim lasts before another node may\n"
+                        "take it over.\n"
+                "--dns-server=ADDRESS[:PORT]\n"
+                        "Look up SMTP servers by querying this DNS server\n"
+                        "directly, all at once, rather than one at a time\n"
+                        "through the system resolver.\n"
+                "--dns-timeout=MS         (default: 1000)\n"
+                        "How long to wait for the DNS server to answer before\n"
+                        "asking again (up to 3 times).\n"
+                "--dns-cache=SECONDS      (default: 300)\n"
+                        "Longest time to keep an address looked up.\n"
+                "--verp=TEMPLATE\n"
+                        "Send each recipient a transaction of its own, with\n"
+                        "a return path made from TEMPLATE by replacing {local}\n"
+                        "and {domain} with the parts of the recipient's address,\n"
+                        "such as bounces+{local}={domain}@example.com.\n"
+                "\n"
+                "Send SIGUSR1 to print a snapshot of statistics.  Send SIGHUP\n"
+                "to reload CERTS for connections made from then on, and the\n"
+                "routes given by --routes for e-mails routed from then on.\n"
+                "Send SIGINT to stop waiting on the SMTP server and exit.\n"
             )
         );
     }
@@ -90,7 +497,25 @@ namespace {
     /**
      * This flag indicates whether or not the application should shut down.
      */
-    bool shutDown = false;
+    std::atomic< bool > shutDown(false);
+
+    /**
+     * This flag indicates whether or not a snapshot of statistics
+     * should be published.
+     */
+    std::atomic< bool > statsRequested(false);
+
+    /**
+     * This flag indicates whether or not the configuration
+     * should be reloaded.
+     */
+    std::atomic< bool > reloadRequested(false);
+
+    /**
+     * This is the function to call to reload the configuration,
+     * when requested.
+     */
+    std::function< void() > reloadDelegate;
 
     /**
      * This contains variables set through the operating system environment
@@ -106,6 +531,123 @@ namespace {
          * This is the path to the file containing the CA certificates.
          */
         std::string caCertsFileName;
+
+        /**
+         * This is the path to the file in which to keep the durations
+         * of each phase of sending e-mail with each SMTP server.
+         */
+        std::string latencyHistoryFileName;
+
+        /**
+         * These are the parameters used to compute timeouts.
+         */
+        AdaptiveTimeouts::Configuration timeouts;
+
+        /**
+         * This is the maximum number of connections which may be
+         * setting up at the same time, or zero for no limit.
+         */
+        size_t maxHandshakes = 0;
+
+        /**
+         * This is the maximum number of SMTP servers (or accounts)
+         * to which to send e-mails at the same time, or zero if there
+         * is no limit.
+         */
+        size_t maxDestinations = 0;
+
+        /**
+         * These are the local addresses, in host byte order, to which
+         * connections are bound.  If there are none, the operating system
+         * chooses.
+         */
+        std::vector< uint32_t > sourceAddresses;
+
+        /**
+         * This selects how the local address for each connection is chosen.
+         */
+        SourceAddressPool::Selection sourceSelection = SourceAddressPool::Selection::RoundRobin;
+
+        /**
+         * This is the maximum number of connections which may be open
+         * from any one local address, or zero for no limit.
+         */
+        size_t maxConnectionsPerSource = 0;
+
+        /**
+         * These are the parameters of the load test, if one
+         * is to be performed.
+         */
+        LoadGenerator::Configuration load;
+
+        /**
+         * This is the beginning of the paths of the files to which
+         * to write the latency distributions measured by the load test,
+         * or an empty string if they shouldn't be written.
+         */
+        std::string loadReportPrefix;
+
+        /**
+         * This indicates whether or not connections are protected by TLS.
+         */
+        bool useTls = true;
+
+        /**
+         * This is the path to the file in which to record the session
+         * with the SMTP server, or an empty string if the session
+         * shouldn't be recorded.
+         */
+        std::string traceFileName;
+
+        /**
+         * This is the path to the file in which to keep track of
+         * e-mails accepted by the SMTP server, or an empty string
+         * if they shouldn't be tracked.
+         */
+        std::string deliveredIndexFileName;
+
+        /**
+         * This is how long to remember each e-mail accepted
+         * by the SMTP server.
+         */
+        std::chrono::seconds deliveredRetention = std::chrono::hours(168);
+
+        /**
+         * This is the path to the file of routes used to decide where
+         * to send e-mails which don't say themselves, or an empty string
+         * if there are no routes.
+         */
+        std::string routesFileName;
+
+        /**
+         * This identifies this process among those sharing a directory
+         * of e-mails, or is an empty string if the directory isn't shared.
+         */
+        std::string nodeId;
+
+        /**
+         * These identify all the processes sharing a directory of
+         * e-mails, among which SMTP servers are partitioned.
+         */
+        std::vector< std::string > nodes;
+
+        /**
+         * This is how long a claim on an e-mail in a shared directory
+         * lasts before another process may take it over.
+         */
+        std::chrono::seconds leaseDuration = std::chrono::seconds(300);
+
+        /**
+         * These are the parameters used to look up SMTP servers.
+         */
+        Resolver::Configuration resolver;
+
+        /**
+         * This is the template from which to make a return path for each
+         * recipient, or an empty string if e-mails aren't sent with
+         * a return path for each recipient.
+         */
+        std::string returnPathTemplate;
     };
 
     /**
@@ -121,15 +663,73 @@ namespace {
         shutDown = true;
     }
 
+    /**
+     * This function is set up to be called when the SIGUSR1 signal is
+     * received by the program.  It just sets the "statsRequested" flag
+     * and relies on the program to be polling the flag to detect
+     * when it's been set.
+     *
+     * @param[in] sig
+     *     This is the signal for which this function was called.
+     */
+    void StatsRequestHandler(int) {
+        statsRequested = true;
+    }
+
+    /**
+     * This function is set up to be called when the SIGHUP signal is
+     * received by the program.  It just sets the "reloadRequested" flag
+     * and relies on the program to be polling the flag to detect
+     * when it's been set.
+     *
+     * @param[in] sig
+     *     This is the signal for which this function was called.
+     */
+    void ReloadRequestHandler(int) {
+        reloadRequested = true;
+    }
+
+    /**
+     * Publish a snapshot of statistics.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void PublishStats(
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        diagnosticMessageDelegate(
+            "Newman",
+            3,
+            "Statistics: " + TakeStatsSnapshot().ToString()
+        );
+    }
+
+    /**
+     * Return the number of microseconds elapsed since the given time.
+     *
+     * @param[in] start
+     *     This is the time from which to measure.
+     *
+     * @return
+     *     The number of microseconds elapsed since the given time
+     *     is returned.
+     */
+    uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+        return (uint64_t)std::chrono::duration_cast< std::chrono::microseconds >(
+            std::chrono::steady_clock::now() - start
+        ).count();
+    }
+
     /**
      * This function updates the program environment to incorporate
-     * any applicable command-line arguments.
+     * the given command-line option.
      *
-     * @param[in] argc
-     *     This is the number of command-line arguments given to the program.
+     * @param[in] name
+     *     This is the name of the option.
      *
-     * @param[in] argv
-     *     This is the array of command-line arguments given to the program.
+     * @param[in] value
+     *     This is the value given for the option.
      *
      * @param[in,out] environment
      *     This is the environment to update.
@@ -140,47 +740,432 @@ namespace {
      * @return
      *     An indication of whether or not the function succeeded is returned.
      */
-    bool ProcessCommandLineArguments(
-        int argc,
-        char* argv[],
+    bool ProcessCommandLineOption(
+        const std::string& name,
+        const std::string& value,
         Environment& environment,
         SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
     ) {
-        bool emailFileNameSet = false;
-        size_t state = 0;
-        for (int i = 1; i < argc; ++i) {
-            const std::string arg(argv[i]);
-            switch (state) {
-                case 0: { // MAIL
-                    environment.emailFileName = arg;
-                    emailFileNameSet = true;
-                    state = 1;
-                } break;
-
-                case 1: { // CERTS (optional)
-                    environment.caCertsFileName = arg;
-                    state = 2;
-                } break;
-
-                case 2: { // extra argument
+        double number = 0.0;
+        const auto isNumber = (
+            (sscanf(value.c_str(), "%lf", &number) == 1)
+            && (number >= 0.0)
+        );
+        if (name == "latency-history") {
+            environment.latencyHistoryFileName = value;
+            return true;
+        } else if (name == "source-addresses") {
+            size_t start = 0;
+            while (start <= value.length()) {
+                auto end = value.find(',', start);
+                if (end == std::string::npos) {
+                    end = value.length();
+                }
+                const auto sourceAddress = SystemAbstractions::NetworkConnection::GetAddressOfHost(
+                    value.substr(start, end - start)
+                );
+                if (sourceAddress == 0) {
                     diagnosticMessageDelegate(
                         "Newman",
                         SystemAbstractions::DiagnosticsSender::Levels::ERROR,
-                        "extra arguments given"
+                        "invalid source address '" + value.substr(start, end - start) + "'"
                     );
                     return false;
-                } break;
+                }
+                environment.sourceAddresses.push_back(sourceAddress);
+                start = end + 1;
             }
-        }
-        if (!emailFileNameSet) {
-            diagnosticMessageDelegate(
-                "Newman",
-                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
-                "no MAIL given"
-            );
-            return false;
-        }
-        return true;
+            return true;
+        } else if (name == "source-selection") {
+            if (value == "round-robin") {
+                environment.sourceSelection = SourceAddressPool::Selection::RoundRobin;
+            } else if (value == "least-loaded") {
+                environment.sourceSelection = SourceAddressPool::Selection::LeastLoaded;
+            } else {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "invalid source selection '" + value + "'"
+                );
+                return false;
+            }
+            return true;
+        } else if (name == "load-arrivals") {
+            if (value == "poisson") {
+                environment.load.arrivals = LoadGenerator::Arrivals::Poisson;
+            } else if (value == "constant") {
+                environment.load.arrivals = LoadGenerator::Arrivals::Constant;
+            } else {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "invalid load arrivals '" + value + "'"
+                );
+                return false;
+            }
+            return true;
+        } else if (name == "load-report") {
+            environment.loadReportPrefix = value;
+            return true;
+        } else if (name == "tls") {
+            if (value == "on") {
+                environment.useTls = true;
+            } else if (value == "off") {
+                environment.useTls = false;
+            } else {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "invalid TLS setting '" + value + "'"
+                );
+                return false;
+            }
+            return true;
+        } else if (name == "record") {
+            environment.traceFileName = value;
+            return true;
+        } else if (name == "delivered-index") {
+            environment.deliveredIndexFileName = value;
+            return true;
+        } else if (name == "routes") {
+            environment.routesFileName = value;
+            return true;
+        } else if (name == "dns-server") {
+            const auto delimiter = value.find(':');
+            environment.resolver.server = SystemAbstractions::NetworkConnection::GetAddressOfHost(
+                value.substr(0, delimiter)
+            );
+            unsigned int port = 53;
+            if (
+                (environment.resolver.server == 0)
+                || (
+                    (delimiter != std::string::npos)
+                    && (
+                        (sscanf(value.c_str() + delimiter + 1, "%u", &port) != 1)
+                        || (port == 0)
+                        || (port > 65535)
+                    )
+                )
+            ) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "invalid DNS server '" + value + "'"
+                );
+                return false;
+            }
+            environment.resolver.port = (uint16_t)port;
+            return true;
+        } else if (name == "verp") {
+            if (value.find('@') == std::string::npos) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "invalid return path template '" + value + "'"
+                );
+                return false;
+            }
+            environment.returnPathTemplate = value;
+            return true;
+        } else if (name == "node") {
+            if (!SpoolLease::IsValidOwner(value)) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "invalid node ID '" + value + "'"
+                );
+                return false;
+            }
+            environment.nodeId = value;
+            return true;
+        } else if (name == "nodes") {
+            size_t start = 0;
+            while (start <= value.length()) {
+                auto end = value.find(',', start);
+                if (end == std::string::npos) {
+                    end = value.length();
+                }
+                const auto node = value.substr(start, end - start);
+                if (!SpoolLease::IsValidOwner(node)) {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                        "invalid node ID '" + node + "'"
+                    );
+                    return false;
+                }
+                environment.nodes.push_back(node);
+                start = end + 1;
+            }
+            return true;
+        } else if (!isNumber) {
+            diagnosticMessageDelegate(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "invalid value given for option '" + name + "'"
+            );
+            return false;
+        } else if (name == "timeout-percentile") {
+            environment.timeouts.percentile = number;
+        } else if (name == "timeout-multiplier") {
+            environment.timeouts.multiplier = number;
+        } else if (name == "timeout-floor") {
+            environment.timeouts.floor = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+        } else if (name == "timeout-ceiling") {
+            environment.timeouts.ceiling = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+        } else if (name == "timeout-initial") {
+            environment.timeouts.initial = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+        } else if (name == "max-handshakes") {
+            environment.maxHandshakes = (size_t)number;
+        } else if (name == "max-destinations") {
+            environment.maxDestinations = (size_t)number;
+        } else if (name == "max-connections-per-source") {
+            environment.maxConnectionsPerSource = (size_t)number;
+        } else if (name == "load-sessions") {
+            environment.load.sessions = (size_t)number;
+        } else if (name == "load-rate") {
+            environment.load.rate = number;
+        } else if (name == "load-duration") {
+            environment.load.duration = std::chrono::milliseconds((std::chrono::milliseconds::rep)(number * 1000.0));
+        } else if (name == "load-drain") {
+            environment.load.drain = std::chrono::milliseconds((std::chrono::milliseconds::rep)(number * 1000.0));
+        } else if (name == "load-seed") {
+            environment.load.seed = (uint64_t)number;
+        } else if (name == "delivered-retention") {
+            environment.deliveredRetention = std::chrono::seconds((std::chrono::seconds::rep)(number * 3600.0));
+        } else if (name == "lease") {
+            environment.leaseDuration = std::chrono::seconds((std::chrono::seconds::rep)number);
+        } else if (name == "dns-timeout") {
+            environment.resolver.timeout = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+        } else if (name == "dns-cache") {
+            environment.resolver.cacheTime = std::chrono::seconds((std::chrono::seconds::rep)number);
+        } else {
+            diagnosticMessageDelegate(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "unknown option '" + name + "'"
+            );
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[in,out] environment
+     *     This is the environment to update.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(
+        int argc,
+        char* argv[],
+        Environment& environment,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        bool emailFileNameSet = false;
+        size_t state = 0;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            if (
+                (state == 0)
+                && (arg.substr(0, 2) == "--")
+            ) {
+                const auto delimiter = arg.find('=');
+                if (delimiter == std::string::npos) {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                        "no value given for option '" + arg.substr(2) + "'"
+                    );
+                    return false;
+                }
+                if (
+                    !ProcessCommandLineOption(
+                        arg.substr(2, delimiter - 2),
+                        arg.substr(delimiter + 1),
+                        environment,
+                        diagnosticMessageDelegate
+                    )
+                ) {
+                    return false;
+                }
+                continue;
+            }
+            switch (state) {
+                case 0: { // MAIL
+                    environment.emailFileName = arg;
+                    emailFileNameSet = true;
+                    state = 1;
+                } break;
+
+                case 1: { // CERTS (optional)
+                    environment.caCertsFileName = arg;
+                    state = 2;
+                } break;
+
+                case 2: { // extra argument
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                        "extra arguments given"
+                    );
+                    return false;
+                } break;
+            }
+        }
+        if (!emailFileNameSet) {
+            diagnosticMessageDelegate(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "no MAIL given"
+            );
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Read the certificates of the certificate authorities
+     * which the client should trust.
+     *
+     * @param[in] caCertsFileName
+     *     This is the path to the file containing the certificates.
+     *
+     * @return
+     *     The certificates are returned, or nullptr if the file couldn't
+     *     be read, or doesn't hold at least one whole certificate and
+     *     nothing but whole certificates (as when it's only partly
+     *     written while being replaced).
+     */
+    std::shared_ptr< const std::string > LoadCaCerts(const std::string& caCertsFileName) {
+        std::ifstream caCertsFile(caCertsFileName);
+        if (!caCertsFile.is_open()) {
+            return nullptr;
+        }
+        std::ostringstream caCertsBuilder;
+        std::string line;
+        size_t begun = 0;
+        size_t ended = 0;
+        while (std::getline(caCertsFile, line)) {
+            if (line.compare(0, 11, "-----BEGIN ") == 0) {
+                if (begun != ended) {
+                    return nullptr;
+                }
+                ++begun;
+            } else if (line.compare(0, 9, "-----END ") == 0) {
+                if (begun != ended + 1) {
+                    return nullptr;
+                }
+                ++ended;
+            }
+            caCertsBuilder << line << "\r\n";
+        }
+        if (
+            caCertsFile.bad()
+            || (begun == 0)
+            || (begun != ended)
+        ) {
+            return nullptr;
+        }
+        return std::make_shared< const std::string >(caCertsBuilder.str());
+    }
+
+    /**
+     * Read the certificates of the certificate authorities which
+     * the client should trust again, and if they've changed, have the
+     * given transport use them for any connections it makes from now on.
+     * Connections already made are left alone.  If the certificates
+     * can't be read, the transport keeps using the ones it has.
+     *
+     * @param[in,out] transport
+     *     This is the transport which should use the new certificates.
+     *
+     * @param[in] caCertsFileName
+     *     This is the path to the file containing the certificates.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void ReloadCaCerts(
+        SmtpTransport& transport,
+        const std::string& caCertsFileName,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        const auto caCerts = LoadCaCerts(caCertsFileName);
+        if (caCerts == nullptr) {
+            diagnosticMessageDelegate(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "Unable to read CA certificates from '" + caCertsFileName + "'; keeping the current ones."
+            );
+            return;
+        }
+        if (*caCerts == *std::atomic_load(&transport.caCerts)) {
+            diagnosticMessageDelegate("Newman", 3, "CA certificates unchanged.");
+            return;
+        }
+        std::atomic_store(&transport.caCerts, caCerts);
+        diagnosticMessageDelegate(
+            "Newman",
+            3,
+            "CA certificates reloaded; new connections will use them."
+        );
+    }
+
+    /**
+     * Load the routes again into a new routing table, and if they
+     * loaded, have e-mails routed from now on use the new table.
+     * If the routes can't be loaded, the current table is kept.
+     *
+     * @param[in,out] routingTable
+     *     This is the routing table to replace.
+     *
+     * @param[in] routesFileName
+     *     This is the path to the file containing the routes.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void ReloadRoutingTable(
+        std::shared_ptr< const RoutingTable >& routingTable,
+        const std::string& routesFileName,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        const auto newRoutingTable = std::make_shared< RoutingTable >();
+        std::string error;
+        if (!newRoutingTable->Load(routesFileName, error)) {
+            diagnosticMessageDelegate(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "Unable to load routes from '" + routesFileName + "': " + error + "; keeping the current ones."
+            );
+            return;
+        }
+        std::atomic_store(
+            &routingTable,
+            std::shared_ptr< const RoutingTable >(newRoutingTable)
+        );
+        diagnosticMessageDelegate(
+            "Newman",
+            3,
+            (
+                "Reloaded " + std::to_string(newRoutingTable->GetSize())
+                + " route(s); e-mails routed from now on will use them."
+            )
+        );
     }
 
     using LoginFunction = std::function<
@@ -192,7 +1177,7 @@ namespace {
 
     LoginFunction SetupClient(
         Smtp::Client& client,
-        const std::string& caCertsFileName,
+        std::shared_ptr< SmtpTransport > transport,
         SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
     ) {
         auto saslLogin = std::make_shared< Sasl::Client::Login >();
@@ -203,7 +1188,6 @@ namespace {
             Hash::SHA256_BLOCK_SIZE,
             256
         );
-        auto transport = std::make_shared< SmtpTransport >();
         client.Configure(transport);
         auto auth = std::make_shared< SmtpAuth::Client >();
         auth->SubscribeToDiagnostics(diagnosticMessageDelegate);
@@ -211,13 +1195,6 @@ namespace {
         auth->Register("PLAIN", 2, saslPlain);
         auth->Register("SCRAM-SHA-256", 3, saslScram);
         client.RegisterExtension("AUTH", auth);
-        std::ifstream caCertsFile(caCertsFileName);
-        std::ostringstream caCertsBuilder;
-        std::string line;
-        while (std::getline(caCertsFile, line)) {
-            caCertsBuilder << line << "\r\n";
-        }
-        transport->caCerts = caCertsBuilder.str();
         return [auth](
             const std::string& username,
             const std::string& password
@@ -227,12 +1204,54 @@ namespace {
     }
 
     struct Email {
+        /**
+         * This is the path to the file from which the e-mail was read.
+         */
+        std::string fileName;
+
         MessageHeaders::MessageHeaders headers;
-        std::string body;
+
+        /**
+         * These are the values of the well-known headers of the e-mail,
+         * classified once when the headers are parsed.
+         */
+        WellKnownHeaderValues wellKnownHeaders;
+
+        /**
+         * This is the body of the e-mail, shared with any other e-mails
+         * whose bodies are identical, or nullptr if it hasn't been
+         * read yet.
+         */
+        BodyStore::Body body;
+
+        /**
+         * This is where the body begins in the file of the e-mail,
+         * so that the body can be read once it's about to be sent,
+         * rather than along with the headers.
+         */
+        std::streamoff bodyOffset = 0;
+
+        /**
+         * These are the recipients of the e-mail, one per line,
+         * from which (along with the body) the e-mail's content is
+         * identified in the index of e-mails accepted by the SMTP server.
+         */
+        std::string recipientList;
+
+        /**
+         * This is the claim on the file of the e-mail, if it's
+         * in a directory shared with other processes.
+         */
+        std::shared_ptr< SpoolLease > lease;
     };
 
-    Email ReadEmail(const std::string& emailFileName) {
+    Email ReadEmail(
+        const std::string& emailFileName,
+        BodyStore& bodyStore
+    ) {
         Email email;
+        email.fileName = emailFileName;
+        std::string body;
         std::ifstream emailFile(emailFileName);
         std::string buffer;
         std::string line;
@@ -240,7 +1259,7 @@ namespace {
         while (std::getline(emailFile, line)) {
             const std::string lineWithNewLine = line + "\r\n";
             if (headersComplete) {
-                email.body += lineWithNewLine;
+                body += lineWithNewLine;
             } else {
                 buffer += lineWithNewLine;
                 size_t bytesConsumed = 0;
@@ -255,72 +1274,527 @@ namespace {
                 }
                 if (headersParseResponse == MessageHeaders::MessageHeaders::State::Complete) {
                     headersComplete = true;
-                    email.body = buffer;
+                    email.wellKnownHeaders = ClassifyHeaders(email.headers);
+                    body = buffer;
+
+                    // Leave the body to be read when it's needed, unless
+                    // some of it was already read along with the headers.
+                    email.bodyOffset = emailFile.tellg();
+                    if (
+                        body.empty()
+                        && (email.bodyOffset >= 0)
+                    ) {
+                        return email;
+                    }
                 }
             }
         }
+        email.body = bodyStore.Intern(std::move(body));
         return email;
     }
 
     /**
-     * This is used to indicate what happened while waiting for a promise
-     * to be completed.
-     */
-    enum class WaitResult {
-        /**
-         * The promise was completed and indicated success.
-         */
-        Success,
-
-        /**
-         * The promise was completed and indicated failure.
-         */
-        Failure,
-
-        /**
-         * The promise did not complete.
-         */
-        Incomplete,
-    };
-
-    /**
-     * Wait for the given future to be completed.
+     * Return the body of the given e-mail, reading it from the e-mail's
+     * file if it hasn't been read yet.
      *
-     * @param[in] future
-     *     This is the future on which to wait.
+     * @param[in] email
+     *     This is the e-mail whose body is needed.
+     *
+     * @param[in] emailFileName
+     *     This is the path the e-mail's file has now.
+     *
+     * @param[in,out] bodyStore
+     *     This holds the bodies read so far which are still in use,
+     *     so that identical bodies are shared.
+     *
+     * @param[out] bodyDigest
+     *     This is where to store the digest of the body, if it's read
+     *     now, or an empty string if it was read already.
      *
      * @return
-     *     An indication of the result of the wait is returned.
-     *     See the definition of `WaitResult` for more details.
+     *     The body of the e-mail is returned, or nullptr if it
+     *     couldn't be read.
      */
-    WaitResult AwaitFuture(std::future< bool >& future) {
-        if (
-            future.wait_for(std::chrono::milliseconds(5000))
-            != std::future_status::ready
+    BodyStore::Body ReadEmailBody(
+        const Email& email,
+        const std::string& emailFileName,
+        BodyStore& bodyStore,
+        std::string& bodyDigest
+    ) {
+        bodyDigest.clear();
+        if (email.body != nullptr) {
+            return email.body;
+        }
+        std::ifstream emailFile(emailFileName);
+        if (!emailFile.seekg(email.bodyOffset)) {
+            return nullptr;
+        }
+        std::string text;
+        char buffer[65536];
+        while (
+            emailFile.read(buffer, sizeof(buffer))
+            || (emailFile.gcount() > 0)
         ) {
-            return WaitResult::Incomplete;
+            text.append(buffer, (size_t)emailFile.gcount());
         }
-        if (future.get()) {
-            return WaitResult::Success;
-        } else {
-            return WaitResult::Failure;
+        if (emailFile.bad()) {
+            return nullptr;
         }
+        auto body = EncodeBody(text, bodyDigest);
+        return bodyStore.Intern(std::move(body), bodyDigest);
     }
 
     /**
-     * Connect to the SMTP server, using parameters extracted
-     * from the given e-mail.
-     *
-     * @param[in,out] client
-     *     This is the SMTP client to use to connect to the SMTP server.
+     * Remove the custom headers used to configure the SMTP client
+     * from the given e-mail, so that they aren't sent.  Their values
+     * remain available among the well-known headers of the e-mail.
      *
      * @param[in,out] email
-     *     This is the e-mail from which to extract the SMTP server parameters.
-     *
-     * @param[in] provideCredentials
+     *     This is the e-mail from which to remove the headers.
+     */
+    void RemoveServerHeaders(Email& email) {
+        for (const auto header: {
+            WellKnownHeader::XSmtpServerHostname,
+            WellKnownHeader::XSmtpPort,
+            WellKnownHeader::XSmtpUsername,
+            WellKnownHeader::XSmtpPassword,
+            WellKnownHeader::XTenant,
+        }) {
+            if (email.wellKnownHeaders.Has(header)) {
+                email.headers.RemoveHeader(GetWellKnownHeaderName(header));
+            }
+        }
+    }
+
+    /**
+     * Return the domain of the given e-mail address.
+     *
+     * @param[in] address
+     *     This is the e-mail address whose domain should be returned.
+     *
+     * @return
+     *     The domain of the given e-mail address is returned,
+     *     or an empty string if it has none.
+     */
+    std::string GetDomain(const AddressView& address) {
+        for (size_t i = address.length; i > 0; --i) {
+            if (address.begin[i - 1] == '@') {
+                return std::string(address.begin + i, address.length - i);
+            }
+        }
+        return "";
+    }
+
+    /**
+     * Decide which SMTP server to send the given e-mail to, and how
+     * to log in, unless the e-mail says so itself with the custom
+     * X-SMTP headers.  E-mails to several recipients are routed by
+     * the domain of the first recipient.
+     *
+     * @param[in,out] email
+     *     This is the e-mail to route.
+     *
+     * @param[in] envelope
+     *     This holds the sender and recipients of the e-mail.
+     *
+     * @param[in] routingTable
+     *     These are the routes to use.
+     *
+     * @return
+     *     An indication of whether or not the e-mail has somewhere
+     *     to go is returned.
+     */
+    bool RouteEmail(
+        Email& email,
+        const Envelope& envelope,
+        const RoutingTable& routingTable
+    ) {
+        if (email.wellKnownHeaders.Has(WellKnownHeader::XSmtpServerHostname)) {
+            return true;
+        }
+        RoutingTable::Destination destination;
+        if (
+            !routingTable.Find(
+                email.wellKnownHeaders[WellKnownHeader::XTenant],
+                GetDomain(envelope.mailFrom),
+                GetDomain(envelope.recipients.front()),
+                destination
+            )
+        ) {
+            return false;
+        }
+        email.wellKnownHeaders[WellKnownHeader::XSmtpServerHostname] = destination.hostName;
+        email.wellKnownHeaders[WellKnownHeader::XSmtpPort] = destination.port;
+        email.wellKnownHeaders[WellKnownHeader::XSmtpUsername] = destination.username;
+        email.wellKnownHeaders[WellKnownHeader::XSmtpPassword] = destination.password;
+        return true;
+    }
+
+    /**
+     * Return the paths of the files containing the e-mails to send.
+     * If the given path is a directory, these are the paths of all
+     * files in it whose names end in ".eml", in order of name.
+     * Otherwise, it's the given path.
+     *
+     * @param[in] path
+     *     This is the path to a file containing an e-mail,
+     *     or a directory of such files.
+     *
+     * @param[in] includeClaimed
+     *     This indicates whether or not to include files claimed
+     *     by other processes sharing the directory.
+     *
+     * @return
+     *     The paths of the files containing the e-mails to send
+     *     are returned.
+     */
+    std::vector< std::string > ListEmailFileNames(
+        const std::string& path,
+        bool includeClaimed
+    ) {
+        struct stat status;
+        if (
+            (stat(path.c_str(), &status) != 0)
+            || ((status.st_mode & S_IFDIR) == 0)
+        ) {
+            return {path};
+        }
+        std::vector< std::string > names;
+#ifdef _WIN32
+        WIN32_FIND_DATAA findData;
+        const auto search = FindFirstFileA((path + "\\*.eml*").c_str(), &findData);
+        if (search != INVALID_HANDLE_VALUE) {
+            do {
+                const std::string name(findData.cFileName);
+                if (
+                    (name.substr(name.length() - 4) == ".eml")
+                    || (
+                        includeClaimed
+                        && (name.find(".eml.lease.") != std::string::npos)
+                    )
+                ) {
+                    names.push_back(name);
+                }
+            } while (FindNextFileA(search, &findData));
+            (void)FindClose(search);
+        }
+#else /* POSIX */
+        const auto directory = opendir(path.c_str());
+        if (directory != NULL) {
+            while (const auto entry = readdir(directory)) {
+                const std::string name(entry->d_name);
+                if (
+                    (
+                        (name.length() > 4)
+                        && (name.substr(name.length() - 4) == ".eml")
+                    )
+                    || (
+                        includeClaimed
+                        && (name.find(".eml.lease.") != std::string::npos)
+                    )
+                ) {
+                    names.push_back(name);
+                }
+            }
+            (void)closedir(directory);
+        }
+#endif /* _WIN32 / POSIX */
+        std::sort(names.begin(), names.end());
+        for (auto& name: names) {
+            name = path + "/" + name;
+        }
+        return names;
+    }
+
+    /**
+     * Return the recipients of the given envelope, one per line,
+     * as used to identify the content of an e-mail.
+     *
+     * @param[in] envelope
+     *     This holds the recipients of the e-mail.
+     *
+     * @return
+     *     The recipients of the envelope, one per line, are returned.
+     */
+    std::string GetRecipientList(const Envelope& envelope) {
+        std::string recipientList;
+        for (const auto& recipient: envelope.recipients) {
+            recipientList.append(recipient.begin, recipient.length);
+            recipientList += "\n";
+        }
+        return recipientList;
+    }
+
+    /**
+     * Return the keys identifying the given e-mail in the index
+     * of e-mails accepted by the SMTP server: one derived from its
+     * Message-ID, if it has one, and one derived from its recipients
+     * and body, so that an e-mail given a new Message-ID when it's
+     * regenerated is still recognized.
+     *
+     * @param[in] email
+     *     This is the e-mail to identify.
+     *
+     * @param[in] body
+     *     This is the body of the e-mail, or nullptr if it hasn't been
+     *     read yet, in which case only the key derived from the
+     *     Message-ID is returned.
+     *
+     * @param[in] bodyDigest
+     *     This is the digest of the body, as computed by DigestBody,
+     *     or an empty string if it should be computed if needed.
+     *     Bodies longer than one chunk are identified by their digest,
+     *     which is computed on several threads at once, rather than
+     *     hashed again as a whole.
+     *
+     * @return
+     *     The keys identifying the e-mail are returned.
+     */
+    std::vector< DeliveryIndex::Key > GetDeliveryKeys(
+        const Email& email,
+        const BodyStore::Body& body,
+        const std::string& bodyDigest
+    ) {
+        std::vector< DeliveryIndex::Key > keys;
+        if (email.wellKnownHeaders.Has(WellKnownHeader::MessageId)) {
+            keys.push_back(
+                DeliveryIndex::MakeKey(
+                    "message-id",
+                    email.wellKnownHeaders[WellKnownHeader::MessageId]
+                )
+            );
+        }
+        if (body != nullptr) {
+            std::string content = email.recipientList;
+            content += "\n";
+            if (body->length() <= BODY_CHUNK_SIZE) {
+                content += *body;
+                keys.push_back(DeliveryIndex::MakeKey("content", content));
+            } else {
+                content += (bodyDigest.empty() ? DigestBody(*body) : bodyDigest);
+                keys.push_back(DeliveryIndex::MakeKey("content-digest", content));
+            }
+        }
+        return keys;
+    }
+
+    /**
+     * Return whether or not the given e-mail is in the index of e-mails
+     * accepted by the SMTP server.
+     *
+     * Before bodies longer than one chunk were identified by their
+     * digest, they were identified by the body itself, like shorter
+     * ones, so if none of the given keys are found, the key the e-mail
+     * would have had then is looked for too.
+     *
+     * @param[in] deliveryIndex
+     *     This is the index of e-mails accepted by the SMTP server.
+     *
+     * @param[in] keys
+     *     These are the keys identifying the e-mail,
+     *     as returned by GetDeliveryKeys.
+     *
+     * @param[in] email
+     *     This is the e-mail to look for.
+     *
+     * @param[in] body
+     *     This is the body of the e-mail, or nullptr if it hasn't been
+     *     read yet.
+     *
+     * @return
+     *     An indication of whether or not the e-mail is in the index
+     *     is returned.
+     */
+    bool IsDelivered(
+        const DeliveryIndex& deliveryIndex,
+        const std::vector< DeliveryIndex::Key >& keys,
+        const Email& email,
+        const BodyStore::Body& body
+    ) {
+        for (const auto key: keys) {
+            if (deliveryIndex.Contains(key)) {
+                return true;
+            }
+        }
+        if (
+            (body != nullptr)
+            && (body->length() > BODY_CHUNK_SIZE)
+        ) {
+            std::string content = email.recipientList;
+            content += "\n";
+            content += *body;
+            return deliveryIndex.Contains(DeliveryIndex::MakeKey("content", content));
+        }
+        return false;
+    }
+
+    /**
+     * This is used to indicate what happened while waiting for a promise
+     * to be completed.
+     */
+    enum class WaitResult {
+        /**
+         * The promise was completed and indicated success.
+         */
+        Success,
+
+        /**
+         * The promise was completed and indicated failure.
+         */
+        Failure,
+
+        /**
+         * The promise did not complete.
+         */
+        Incomplete,
+    };
+
+    /**
+     * Wait for the given future to be completed.  While waiting,
+     * publish statistics if requested, and give up early if
+     * the program is asked to shut down.
+     *
+     * @param[in] future
+     *     This is the future on which to wait.
+     *
+     * @param[in] timeout
+     *     This is how long to wait before giving up.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     *
+     * @param[in] madeProgress
+     *     If not nullptr, this is checked while waiting, and each time
+     *     it returns true, the full timeout starts over.
+     *
+     * @return
+     *     An indication of the result of the wait is returned.
+     *     See the definition of `WaitResult` for more details.
+     */
+    WaitResult AwaitFuture(
+        std::future< bool >& future,
+        std::chrono::milliseconds timeout,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate,
+        std::function< bool() > madeProgress = nullptr
+    ) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (
+            future.wait_for(std::chrono::milliseconds(100))
+            != std::future_status::ready
+        ) {
+            if (statsRequested.exchange(false)) {
+                PublishStats(diagnosticMessageDelegate);
+            }
+            if (
+                reloadRequested.exchange(false)
+                && (reloadDelegate != nullptr)
+            ) {
+                reloadDelegate();
+            }
+            if (
+                (madeProgress != nullptr)
+                && madeProgress()
+            ) {
+                deadline = std::chrono::steady_clock::now() + timeout;
+            }
+            if (shutDown) {
+                return WaitResult::Incomplete;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                IncrementCounter(Counter::Timeouts);
+                return WaitResult::Incomplete;
+            }
+        }
+        if (future.get()) {
+            return WaitResult::Success;
+        } else {
+            return WaitResult::Failure;
+        }
+    }
+
+    /**
+     * Return the host name and port number of the SMTP server
+     * to which the given e-mail is to be sent, used to keep track
+     * of how the server performs.
+     *
+     * @param[in] email
+     *     This is the e-mail whose SMTP server should be identified.
+     *
+     * @return
+     *     The host name and port number of the SMTP server are returned.
+     */
+    std::string GetDestination(const Email& email) {
+        return (
+            email.wellKnownHeaders[WellKnownHeader::XSmtpServerHostname]
+            + ":"
+            + email.wellKnownHeaders[WellKnownHeader::XSmtpPort]
+        );
+    }
+
+    /**
+     * Record how long a phase of sending the given e-mail took,
+     * unless the phase was cut short because the program is
+     * shutting down.  Phases which timed out are recorded too,
+     * so that timeouts can grow for a server which has slowed down.
+     *
+     * @param[in,out] timeouts
+     *     This is where to record durations used to adapt timeouts.
+     *
+     * @param[in] email
+     *     This is the e-mail being sent.
+     *
+     * @param[in] phase
+     *     This identifies the phase of sending the e-mail.
+     *
+     * @param[in] start
+     *     This is when the phase started.
+     *
+     * @param[in] completed
+     *     This indicates whether the phase completed (true)
+     *     or timed out (false).
+     *
+     * @param[in] occurrences
+     *     This is the number of times the phase happened back to back
+     *     in the time measured, as when an e-mail is sent in one mail
+     *     transaction per recipient.  The duration recorded is that
+     *     of one occurrence.
+     */
+    void RecordPhase(
+        AdaptiveTimeouts& timeouts,
+        const Email& email,
+        Phase phase,
+        std::chrono::steady_clock::time_point start,
+        bool completed,
+        size_t occurrences = 1
+    ) {
+        if (shutDown) {
+            return;
+        }
+        const auto duration = MicrosecondsSince(start) / std::max(occurrences, (size_t)1);
+        if (completed) {
+            RecordLatency(phase, duration);
+        }
+        timeouts.Record(GetDestination(email), phase, duration);
+    }
+
+    /**
+     * Connect to the SMTP server, using parameters extracted
+     * from the given e-mail.
+     *
+     * @param[in,out] client
+     *     This is the SMTP client to use to connect to the SMTP server.
+     *
+     * @param[in] email
+     *     This is the e-mail from which to extract the SMTP server parameters.
+     *
+     * @param[in] provideCredentials
      *     This is the function to call to provide the SMTP client with
      *     the login credentials to use with the SMTP server.
      *
+     * @param[in,out] timeouts
+     *     This is used to decide how long to wait for the connection,
+     *     and to record how long it took.
+     *
      * @param[in] diagnosticMessageDelegate
      *     This is the function to call to publish any diagnostic messages.
      *
@@ -330,19 +1804,16 @@ namespace {
      */
     bool ConnectToServer(
         Smtp::Client& client,
-        Email& email,
+        const Email& email,
         LoginFunction provideCredentials,
+        AdaptiveTimeouts& timeouts,
         SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
     ) {
         diagnosticMessageDelegate("Newman", 3, "Connecting to SMTP server.");
-        const auto serverHostName = email.headers.GetHeaderValue("X-SMTP-Server-Hostname");
-        email.headers.RemoveHeader("X-SMTP-Server-Hostname");
-        const auto serverPortNumberAsString = email.headers.GetHeaderValue("X-SMTP-Port");
-        email.headers.RemoveHeader("X-SMTP-Port");
-        const auto username = email.headers.GetHeaderValue("X-SMTP-Username");
-        email.headers.RemoveHeader("X-SMTP-Username");
-        const auto password = email.headers.GetHeaderValue("X-SMTP-Password");
-        email.headers.RemoveHeader("X-SMTP-Password");
+        const auto& serverHostName = email.wellKnownHeaders[WellKnownHeader::XSmtpServerHostname];
+        const auto& serverPortNumberAsString = email.wellKnownHeaders[WellKnownHeader::XSmtpPort];
+        const auto& username = email.wellKnownHeaders[WellKnownHeader::XSmtpUsername];
+        const auto& password = email.wellKnownHeaders[WellKnownHeader::XSmtpPassword];
         provideCredentials(username, password);
         uint16_t serverPortNumber = 0;
         (void)sscanf(
@@ -350,11 +1821,38 @@ namespace {
             "%" SCNu16,
             &serverPortNumber
         );
+        IncrementCounter(Counter::ConnectAttempts);
+        const auto start = std::chrono::steady_clock::now();
         auto futureConnectSuccess = client.Connect(
             serverHostName,
             serverPortNumber
         );
-        return futureConnectSuccess.get();
+        const auto connectResult = AwaitFuture(
+            futureConnectSuccess,
+            timeouts.GetTimeout(GetDestination(email), Phase::Connect),
+            diagnosticMessageDelegate
+        );
+        switch (connectResult) {
+            case WaitResult::Success: {
+                RecordPhase(timeouts, email, Phase::Connect, start, true);
+            } return true;
+
+            case WaitResult::Incomplete: {
+                if (shutDown) {
+                    break;
+                }
+                RecordPhase(timeouts, email, Phase::Connect, start, false);
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    "Timeout waiting to connect to the SMTP server!"
+                );
+            } break;
+
+            default: break;
+        }
+        IncrementCounter(Counter::ConnectFailures);
+        return false;
     }
 
     /**
@@ -365,6 +1863,9 @@ namespace {
      *     client/server is either ready to accept the next e-mail, or
      *     the connection between them has been broken.
      *
+     * @param[in] timeout
+     *     This is how long to wait before giving up.
+     *
      * @param[in] diagnosticMessageDelegate
      *     This is the function to call to publish any diagnostic messages.
      *
@@ -378,9 +1879,10 @@ namespace {
      */
     bool WaitForClientReadyToSend(
         std::future< bool >& readyOrBroken,
+        std::chrono::milliseconds timeout,
         SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
     ) {
-        switch (AwaitFuture(readyOrBroken)) {
+        switch (AwaitFuture(readyOrBroken, timeout, diagnosticMessageDelegate)) {
             case WaitResult::Failure: {
                 diagnosticMessageDelegate(
                     "Newman",
@@ -401,89 +1903,1326 @@ namespace {
         }
     }
 
-}
-
-/**
- * This function is the entrypoint of the program.
- * It just sets up the web client, using it to fetch a resource
- * and generate a report.  It registers the SIGINT signal to know
- * when the web client should be shut down early.
- *
- * The program is terminated after either a report is generated
- * or the SIGINT signal is caught.
- *
- * @param[in] argc
- *     This is the number of command-line arguments given to the program.
- *
- * @param[in] argv
- *     This is the array of command-line arguments given to the program.
- */
-int main(int argc, char* argv[]) {
-#ifdef _WIN32
-    //_crtBreakAlloc = 18;
-    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
-#endif /* _WIN32 */
-    const auto previousInterruptHandler = signal(SIGINT, InterruptHandler);
-    Environment environment;
-    (void)setbuf(stdout, NULL);
-    const auto diagnosticsPublisher = SystemAbstractions::DiagnosticsStreamReporter(stdout, stderr);
-    if (!ProcessCommandLineArguments(argc, argv, environment, diagnosticsPublisher)) {
-        PrintUsageInformation();
-        return EXIT_FAILURE;
-    }
-    Smtp::Client client;
-    client.SubscribeToDiagnostics(diagnosticsPublisher, 1);
-    const auto provideCredentials = SetupClient(
-        client,
-        environment.caCertsFileName,
-        diagnosticsPublisher
-    );
-    auto email = ReadEmail(environment.emailFileName);
-    auto readyOrBroken = client.GetReadyOrBrokenFuture();
-    const auto connectSuccess = ConnectToServer(
-        client,
-        email,
-        provideCredentials,
-        diagnosticsPublisher
-    );
-    if (connectSuccess) {
-        diagnosticsPublisher("Newman", 3, "Connected to SMTP server.");
-    } else {
-        diagnosticsPublisher(
-            "Newman",
-            SystemAbstractions::DiagnosticsSender::Levels::WARNING,
-            "There was a problem connecting to the SMTP server!"
+    /**
+     * Wait for the SMTP client/server to be ready to accept the first
+     * e-mail after connecting, and record how long it took.
+     *
+     * @param[in,out] readyOrBroken
+     *     This is the future end of the promise set when the SMTP
+     *     client/server is either ready to accept the next e-mail, or
+     *     the connection between them has been broken.
+     *
+     * @param[in,out] transport
+     *     This is the transport used to connect to the SMTP server.
+     *
+     * @param[in,out] timeouts
+     *     This is used to decide how long to wait, and to record
+     *     how long it took.
+     *
+     * @param[in] email
+     *     This is the e-mail being sent.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     *
+     * @return
+     *     An indication of whether or not the SMTP client/server are ready
+     *     to accept the next e-mail is returned.
+     */
+    bool AwaitReady(
+        std::future< bool >& readyOrBroken,
+        SmtpTransport& transport,
+        AdaptiveTimeouts& timeouts,
+        const Email& email,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        const auto readyStart = std::chrono::steady_clock::now();
+        const auto readyTimeout = timeouts.GetTimeout(GetDestination(email), Phase::Ready);
+        const auto ready = WaitForClientReadyToSend(
+            readyOrBroken,
+            readyTimeout,
+            diagnosticMessageDelegate
         );
-        return EXIT_FAILURE;
-    }
-    diagnosticsPublisher("Newman", 3, "Preparing to send e-mail...");
-    if (!WaitForClientReadyToSend(readyOrBroken, diagnosticsPublisher)) {
-        return EXIT_FAILURE;
+        transport.SetupFinished();
+        if (
+            ready
+            || (std::chrono::steady_clock::now() - readyStart >= readyTimeout)
+        ) {
+            RecordPhase(timeouts, email, Phase::Ready, readyStart, ready);
+        }
+        return ready;
     }
-    diagnosticsPublisher("Newman", 3, "Sending e-mail.");
-    auto sendCompleted = client.SendMail(email.headers, email.body);
-    diagnosticsPublisher("Newman", 3, "Waiting for e-mail to be sent...");
-    switch (AwaitFuture(sendCompleted)) {
-        case WaitResult::Failure: {
-            diagnosticsPublisher(
-                "Newman",
-                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
-                "There was a problem sending the e-mail!"
-            );
-        } return EXIT_FAILURE;
 
-        case WaitResult::Incomplete: {
-            diagnosticsPublisher(
-                "Newman",
-                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
-                "Timeout waiting for server to accept the e-mail!"
-            );
-        } return EXIT_FAILURE;
+    /**
+     * Return the number of mail transactions in which the given e-mail
+     * is sent using the given transport: one per recipient if each
+     * recipient is given its own return path, or else just one.
+     *
+     * @param[in] email
+     *     This is the e-mail to send.
+     *
+     * @param[in] transport
+     *     This is the transport of the session sending the e-mail.
+     *
+     * @return
+     *     The number of mail transactions in which the e-mail
+     *     is sent is returned.
+     */
+    size_t CountTransactions(
+        const Email& email,
+        const SmtpTransport& transport
+    ) {
+        if (transport.returnPathTemplate.empty()) {
+            return 1;
+        }
+        return std::max(
+            (size_t)std::count(
+                email.recipientList.begin(),
+                email.recipientList.end(),
+                '\n'
+            ),
+            (size_t)1
+        );
+    }
+
+    /**
+     * Send the given e-mail, wait for the SMTP server to accept it,
+     * and record how long it took.
+     *
+     * @param[in,out] client
+     *     This is the SMTP client to use to send the e-mail.
+     *
+     * @param[in,out] timeouts
+     *     This is used to decide how long to wait, and to record
+     *     how long it took.
+     *
+     * @param[in] email
+     *     This is the e-mail to send.
+     *
+     * @param[in] transport
+     *     This is the transport of the session sending the e-mail.
+     *     If it sends each recipient a transaction of its own, the
+     *     timeout for one transaction is allowed for each, starting
+     *     over whenever the server replies, and the duration recorded
+     *     is that of one transaction.
+     *
+     * @param[in] body
+     *     This is the body of the e-mail.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     *
+     * @return
+     *     An indication of what happened while waiting for the
+     *     e-mail to be accepted is returned.
+     */
+    WaitResult SendEmail(
+        Smtp::Client& client,
+        AdaptiveTimeouts& timeouts,
+        const Email& email,
+        const SmtpTransport& transport,
+        const std::string& body,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        const auto numTransactions = CountTransactions(email, transport);
+        std::function< bool() > madeProgress;
+        const auto verp = transport.verp;
+        if (verp != nullptr) {
+            auto replyCount = verp->GetReplyCount();
+            madeProgress = [verp, replyCount]() mutable {
+                const auto newReplyCount = verp->GetReplyCount();
+                if (newReplyCount == replyCount) {
+                    return false;
+                }
+                replyCount = newReplyCount;
+                return true;
+            };
+        }
+        const auto sendStart = std::chrono::steady_clock::now();
+        auto sendCompleted = client.SendMail(email.headers, body);
+        const auto sendResult = AwaitFuture(
+            sendCompleted,
+            timeouts.GetTimeout(GetDestination(email), Phase::Send),
+            diagnosticMessageDelegate,
+            madeProgress
+        );
+        if (sendResult == WaitResult::Success) {
+            RecordPhase(timeouts, email, Phase::Send, sendStart, true, numTransactions);
+            IncrementCounter(Counter::MessagesSent);
+        } else {
+            if (
+                (sendResult == WaitResult::Incomplete)
+                && !shutDown
+            ) {
+                RecordPhase(timeouts, email, Phase::Send, sendStart, false, numTransactions);
+            }
+            IncrementCounter(Counter::MessagesFailed);
+        }
+        return sendResult;
+    }
+
+    /**
+     * Publish the given TCP statistics of the connection
+     * to the SMTP server.
+     *
+     * @param[in] transport
+     *     This is the transport used to connect to the SMTP server.
+     *
+     * @param[in] phase
+     *     This identifies the point in the session at which
+     *     the statistics were sampled.
+     *
+     * @param[in] sample
+     *     These are the statistics to publish.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void ReportTcpInfo(
+        const SmtpTransport& transport,
+        const std::string& phase,
+        const TcpInfoSample& sample,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        diagnosticMessageDelegate(
+            "Newman",
+            3,
+            "TCP (" + transport.destination + ") at " + phase + ": " + sample.ToString()
+        );
+    }
+
+    /**
+     * Publish how each local address has been used to connect
+     * to SMTP servers, if any were given.
+     *
+     * @param[in] sourceAddresses
+     *     These are the local addresses used to connect to SMTP servers.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void PublishSourceAddressUsage(
+        const SourceAddressPool& sourceAddresses,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        if (sourceAddresses.IsEmpty()) {
+            return;
+        }
+        diagnosticMessageDelegate(
+            "Newman",
+            3,
+            "Source addresses: " + sourceAddresses.Summarize()
+        );
+    }
+
+    /**
+     * Publish how the buffers shared by connections to receive data
+     * have been used, and how much memory sessions held while idle.
+     *
+     * @param[in] receiveBuffers
+     *     These are the buffers shared by connections to receive data.
+     *
+     * @param[in] idleMemory
+     *     These are the samples of the memory held by idle sessions.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void PublishReceiveBufferUsage(
+        const BufferPool& receiveBuffers,
+        const IdleSessionMemory& idleMemory,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        const auto stats = receiveBuffers.GetStats();
+        if (stats.acquisitions == 0) {
+            return;
+        }
+        diagnosticMessageDelegate(
+            "Newman",
+            3,
+            "Receive buffers: " + stats.ToString()
+        );
+        if (idleMemory.samples > 0) {
+            diagnosticMessageDelegate(
+                "Newman",
+                3,
+                "Memory per idle session: " + idleMemory.ToString()
+            );
+        }
+    }
+
+    /**
+     * Publish how many lookups were made to find SMTP servers,
+     * and how many were avoided.
+     *
+     * @param[in] resolver
+     *     This is used to look up the addresses of SMTP servers.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void PublishResolverStats(
+        const Resolver& resolver,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        const auto stats = resolver.GetStats();
+        if (stats.requests == 0) {
+            return;
+        }
+        diagnosticMessageDelegate(
+            "Newman",
+            3,
+            "DNS: " + stats.ToString()
+        );
+    }
+
+    /**
+     * This holds everything used by one session with an SMTP server.
+     */
+    struct Session {
+        /**
+         * This is the SMTP client used to send e-mail.
+         */
+        Smtp::Client client;
+
+        /**
+         * This is the transport used to connect to the SMTP server.
+         */
+        std::shared_ptr< SmtpTransport > transport;
+    };
+
+    /**
+     * Open a session with the SMTP server to which the given e-mail
+     * is to be sent, and wait for it to be ready to accept e-mail.
+     *
+     * @param[in] email
+     *     This is the e-mail from which to extract the SMTP server parameters.
+     *
+     * @param[in] templateTransport
+     *     This is the transport whose settings (and current CA
+     *     certificates) are copied by the transport of the session.
+     *
+     * @param[in] traceFileName
+     *     This is the path to the file in which to record the session,
+     *     or an empty string if the session shouldn't be recorded.
+     *
+     * @param[in,out] timeouts
+     *     This is used to decide how long to wait for each phase,
+     *     and to record how long it took.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     *
+     * @param[in] reportProgress
+     *     This indicates whether or not to publish the progress of the
+     *     session, along with the TCP statistics of its connection.
+     *
+     * @return
+     *     The session is returned, or nullptr if it couldn't be opened.
+     */
+    std::shared_ptr< Session > OpenSession(
+        const Email& email,
+        const SmtpTransport& templateTransport,
+        const std::string& traceFileName,
+        AdaptiveTimeouts& timeouts,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate,
+        bool reportProgress
+    ) {
+        const auto session = std::make_shared< Session >();
+        session->client.SubscribeToDiagnostics(diagnosticMessageDelegate, 1);
+        session->transport = std::make_shared< SmtpTransport >();
+        std::atomic_store(
+            &session->transport->caCerts,
+            std::atomic_load(&templateTransport.caCerts)
+        );
+        session->transport->handshakeLimiter = templateTransport.handshakeLimiter;
+        session->transport->sourceAddresses = templateTransport.sourceAddresses;
+        session->transport->receiveBuffers = templateTransport.receiveBuffers;
+        session->transport->idleMemory = templateTransport.idleMemory;
+        session->transport->connectTimeout = timeouts.GetTimeout(GetDestination(email), Phase::Connect);
+        session->transport->resolver = templateTransport.resolver;
+        session->transport->returnPathTemplate = templateTransport.returnPathTemplate;
+        session->transport->diagnosticMessageDelegate = diagnosticMessageDelegate;
+        session->transport->useTls = templateTransport.useTls;
+        session->transport->traceFileName = traceFileName;
+        const auto provideCredentials = SetupClient(
+            session->client,
+            session->transport,
+            diagnosticMessageDelegate
+        );
+        auto readyOrBroken = session->client.GetReadyOrBrokenFuture();
+
+        // Wait for a place among the connections setting up before
+        // starting to connect, so that the wait isn't held against
+        // the time allowed to connect, nor recorded as part of it.
+        const auto& handshakeLimiter = session->transport->handshakeLimiter;
+        if (handshakeLimiter != nullptr) {
+            if (!handshakeLimiter->Acquire([]{ return (bool)shutDown; })) {
+                return nullptr;
+            }
+            session->transport->settingUp = true;
+        }
+        if (
+            !ConnectToServer(
+                session->client,
+                email,
+                provideCredentials,
+                timeouts,
+                diagnosticMessageDelegate
+            )
+        ) {
+            if (reportProgress) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    "There was a problem connecting to the SMTP server!"
+                );
+            }
+            session->transport->SetupFinished();
+            return nullptr;
+        }
+        if (reportProgress) {
+            diagnosticMessageDelegate("Newman", 3, "Connected to SMTP server.");
+            ReportTcpInfo(*session->transport, "connect", session->transport->connectTcpInfo, diagnosticMessageDelegate);
+            diagnosticMessageDelegate("Newman", 3, "Preparing to send e-mail...");
+        }
+        if (
+            !AwaitReady(
+                readyOrBroken,
+                *session->transport,
+                timeouts,
+                email,
+                diagnosticMessageDelegate
+            )
+        ) {
+            if (reportProgress) {
+                ReportTcpInfo(*session->transport, "close", session->transport->tcpInfo.Sample(), diagnosticMessageDelegate);
+            }
+            return nullptr;
+        }
+        if (reportProgress) {
+            ReportTcpInfo(*session->transport, "ready", session->transport->tcpInfo.Sample(), diagnosticMessageDelegate);
+            const auto capabilities = session->transport->replies->GetCapabilities().ToString();
+            if (!capabilities.empty()) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    3,
+                    "SMTP server supports: " + capabilities
+                );
+            }
+        }
+        return session;
+    }
+
+    /**
+     * Load-test the SMTP server by sending the given e-mail over
+     * and over, using several concurrent sessions.
+     *
+     * @param[in] environment
+     *     This holds the parameters of the load test.
+     *
+     * @param[in] email
+     *     This is the e-mail to send.
+     *
+     * @param[in] templateTransport
+     *     This is the transport whose settings (and current CA
+     *     certificates) are copied by the transport of each session.
+     *
+     * @param[in,out] timeouts
+     *     This is used to decide how long to wait for each phase,
+     *     and to record how long it took.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     *
+     * @return
+     *     The results of the load test are returned.
+     */
+    LoadGenerator::Report RunLoadTest(
+        const Environment& environment,
+        const Email& email,
+        std::shared_ptr< SmtpTransport > templateTransport,
+        AdaptiveTimeouts& timeouts,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        const auto sessionsOpened = std::make_shared< std::atomic< size_t > >(0);
+        const auto openSession = [
+            &environment,
+            sessionsOpened,
+            &email,
+            templateTransport,
+            &timeouts,
+            diagnosticMessageDelegate
+        ]() -> LoadGenerator::SendDelegate {
+            const auto sessionNumber = ++*sessionsOpened;
+            std::string traceFileName;
+            if (!environment.traceFileName.empty()) {
+                traceFileName = (
+                    environment.traceFileName + "." + std::to_string(sessionNumber)
+                );
+            }
+            const auto session = OpenSession(
+                email,
+                *templateTransport,
+                traceFileName,
+                timeouts,
+                diagnosticMessageDelegate,
+                false
+            );
+            if (session == nullptr) {
+                return nullptr;
+            }
+            return [session, &email, &timeouts, diagnosticMessageDelegate]{
+                if (
+                    SendEmail(
+                        session->client,
+                        timeouts,
+                        email,
+                        *session->transport,
+                        *email.body,
+                        diagnosticMessageDelegate
+                    ) != WaitResult::Success
+                ) {
+                    return false;
+                }
+                session->transport->SampleIdleMemory();
+                return true;
+            };
+        };
+        LoadGenerator loadGenerator;
+        loadGenerator.Configure(environment.load);
+        return loadGenerator.Run(
+            openSession,
+            []{ return (bool)shutDown; }
+        );
+    }
+
+    /**
+     * Return whether or not the given e-mails are to be sent
+     * to the same SMTP server using the same credentials,
+     * so that they can be sent in the same session.
+     *
+     * @param[in] lhs
+     *     This is the first e-mail to compare.
+     *
+     * @param[in] rhs
+     *     This is the second e-mail to compare.
+     *
+     * @return
+     *     An indication of whether or not the e-mails can be sent
+     *     in the same session is returned.
+     */
+    bool CanShareSession(
+        const Email& lhs,
+        const Email& rhs
+    ) {
+        for (const auto header: {
+            WellKnownHeader::XSmtpServerHostname,
+            WellKnownHeader::XSmtpPort,
+            WellKnownHeader::XSmtpUsername,
+            WellKnownHeader::XSmtpPassword,
+        }) {
+            if (lhs.wellKnownHeaders[header] != rhs.wellKnownHeaders[header]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * This counts what became of the e-mails of a batch.
+     */
+    struct BatchOutcome {
+        /**
+         * This is the number of e-mails accepted by the SMTP server.
+         */
+        size_t sent = 0;
+
+        /**
+         * This is the number of e-mails which could not be sent.
+         */
+        size_t failed = 0;
+
+        /**
+         * This is the number of e-mails skipped because they were
+         * found in the index of e-mails already delivered.
+         */
+        size_t skipped = 0;
+
+        /**
+         * This is the number of e-mails left to the processes which
+         * took over the claims on them.
+         */
+        size_t lostClaims = 0;
+
+        /**
+         * Add the counts of the given outcome to these.
+         *
+         * @param[in] other
+         *     This is the outcome to add.
+         *
+         * @return
+         *     A reference to this outcome is returned.
+         */
+        BatchOutcome& operator+=(const BatchOutcome& other) {
+            sent += other.sent;
+            failed += other.failed;
+            skipped += other.skipped;
+            lostClaims += other.lostClaims;
+            return *this;
+        }
+    };
+
+    /**
+     * Send the given e-mails, all of which go to the same SMTP server
+     * using the same credentials, over as few sessions as possible.
+     * A new session is opened only after a session breaks.
+     *
+     * @param[in] emails
+     *     These are the e-mails to send.
+     *
+     * @param[in] environment
+     *     This holds the path to the file in which to record sessions,
+     *     the path to the index of e-mails already delivered, and how
+     *     long to extend claims on e-mails in a shared directory.
+     *
+     * @param[in] templateTransport
+     *     This is the transport whose settings (and current CA
+     *     certificates) are copied by the transport of each session.
+     *
+     * @param[in,out] sessionsOpened
+     *     This is the number of sessions opened so far, by this and any
+     *     other batches being sent at the same time, used to give
+     *     each recorded session its own file.
+     *
+     * @param[in,out] deliveryIndex
+     *     This is where to record e-mails accepted by the SMTP server,
+     *     if an index of them is kept.
+     *
+     * @param[in,out] bodyStore
+     *     This holds the bodies of e-mails being sent, so that
+     *     identical bodies are shared.
+     *
+     * @param[in,out] timeouts
+     *     This is used to decide how long to wait for each phase,
+     *     and to record how long it took.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     *
+     * @return
+     *     How many of the e-mails were sent, not sent, skipped,
+     *     or left to others is returned.
+     */
+    BatchOutcome SendBatch(
+        const std::vector< const Email* >& emails,
+        const Environment& environment,
+        const SmtpTransport& templateTransport,
+        std::atomic< size_t >& sessionsOpened,
+        DeliveryIndex& deliveryIndex,
+        BodyStore& bodyStore,
+        AdaptiveTimeouts& timeouts,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        BatchOutcome outcome;
+        std::shared_ptr< Session > session;
+
+        // The body store only shares a body while something holds it,
+        // so the body of the e-mail most recently read is held until the
+        // next body is read, letting e-mails in a row with the same body
+        // share it instead of each reading it again.
+        BodyStore::Body previousBody;
+        for (size_t i = 0; i < emails.size(); ++i) {
+            const auto& email = *emails[i];
+            if (shutDown) {
+                IncrementCounter(Counter::MessagesFailed, emails.size() - i);
+                outcome.failed += emails.size() - i;
+                break;
+            }
+            if (
+                (email.lease != nullptr)
+                && !email.lease->Renew(environment.leaseDuration)
+            ) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    "Lost the claim on e-mail '" + email.fileName + "'; leaving it to its new holder."
+                );
+                ++outcome.lostClaims;
+                continue;
+            }
+
+            // The body of an e-mail is read only once it's needed: to look
+            // for the e-mail in the index of e-mails already delivered,
+            // before any session is used for it, or else once a session
+            // is ready to take it, so that bodies of e-mails which can't
+            // be sent are never read, and only bodies being sent are held.
+            const auto readBody = [&](std::string& bodyDigest){
+                const auto body = ReadEmailBody(
+                    email,
+                    (email.lease == nullptr) ? email.fileName : email.lease->GetFileName(),
+                    bodyStore,
+                    bodyDigest
+                );
+                if (body == nullptr) {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                        "Unable to read the body of e-mail '" + email.fileName + "'"
+                    );
+                    if (email.lease != nullptr) {
+                        (void)email.lease->Release();
+                    }
+                    IncrementCounter(Counter::MessagesFailed);
+                    ++outcome.failed;
+                } else {
+                    previousBody = body;
+                }
+                return body;
+            };
+            std::string bodyDigest;
+            BodyStore::Body body;
+            std::vector< DeliveryIndex::Key > deliveryKeys;
+            if (!environment.deliveredIndexFileName.empty()) {
+                body = readBody(bodyDigest);
+                if (body == nullptr) {
+                    continue;
+                }
+                deliveryKeys = GetDeliveryKeys(email, body, bodyDigest);
+                if (IsDelivered(deliveryIndex, deliveryKeys, email, body)) {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        3,
+                        "E-mail '" + email.fileName + "' was already delivered; skipping."
+                    );
+                    if (email.lease != nullptr) {
+                        (void)email.lease->Complete();
+                    }
+                    ++outcome.skipped;
+                    continue;
+                }
+            }
+            if (session == nullptr) {
+                const auto sessionNumber = sessionsOpened++;
+                std::string traceFileName = environment.traceFileName;
+                if (
+                    !traceFileName.empty()
+                    && (sessionNumber > 0)
+                ) {
+                    traceFileName += "." + std::to_string(sessionNumber);
+                }
+                session = OpenSession(
+                    email,
+                    templateTransport,
+                    traceFileName,
+                    timeouts,
+                    diagnosticMessageDelegate,
+                    true
+                );
+                if (session == nullptr) {
+                    IncrementCounter(Counter::MessagesFailed, emails.size() - i);
+                    outcome.failed += emails.size() - i;
+                    break;
+                }
+            }
+            if (body == nullptr) {
+                body = readBody(bodyDigest);
+                if (body == nullptr) {
+                    continue;
+                }
+            }
+            diagnosticMessageDelegate("Newman", 3, "Sending e-mail '" + email.fileName + "'.");
+            const auto sendResult = SendEmail(
+                session->client,
+                timeouts,
+                email,
+                *session->transport,
+                *body,
+                diagnosticMessageDelegate
+            );
+            ReportTcpInfo(*session->transport, "data", session->transport->tcpInfo.Sample(), diagnosticMessageDelegate);
+            switch (sendResult) {
+                case WaitResult::Success: {
+                    if (
+                        (email.lease != nullptr)
+                        && !email.lease->Complete()
+                    ) {
+                        diagnosticMessageDelegate(
+                            "Newman",
+                            SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                            "Lost the claim on e-mail '" + email.fileName + "' while sending it."
+                        );
+                    }
+                    for (const auto key: deliveryKeys) {
+                        if (!deliveryIndex.Add(key)) {
+                            diagnosticMessageDelegate(
+                                "Newman",
+                                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                                "Unable to record delivery in '" + environment.deliveredIndexFileName + "'"
+                            );
+                            break;
+                        }
+                    }
+                    ++outcome.sent;
+                    session->transport->SampleIdleMemory();
+                } break;
+
+                case WaitResult::Failure: {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                        "There was a problem sending the e-mail!"
+                    );
+                } break;
+
+                case WaitResult::Incomplete: {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                        "Timeout waiting for server to accept the e-mail!"
+                    );
+                } break;
 
-        default: break;
+                default: break;
+            }
+            if (sendResult != WaitResult::Success) {
+                const auto negativeReply = session->transport->replies->GetLastNegativeReply();
+                if (!negativeReply.empty()) {
+                    diagnosticMessageDelegate(
+                        "Newman",
+                        SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                        "SMTP server replied: " + negativeReply
+                    );
+                }
+                if (email.lease != nullptr) {
+                    (void)email.lease->Release();
+                }
+                ++outcome.failed;
+                ReportTcpInfo(*session->transport, "close", session->transport->tcpInfo.Sample(), diagnosticMessageDelegate);
+                session = nullptr;
+            }
+        }
+        if (session != nullptr) {
+            ReportTcpInfo(*session->transport, "close", session->transport->tcpInfo.Sample(), diagnosticMessageDelegate);
+        }
+        return outcome;
+    }
+
+    /**
+     * Write the latency distribution of each phase measured by
+     * a load test to its own file, if a beginning of the paths of
+     * the files was given.
+     *
+     * @param[in] environment
+     *     This holds the beginning of the paths of the files.
+     *
+     * @param[in] report
+     *     These are the results of the load test.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void WriteLoadReport(
+        const Environment& environment,
+        const LoadGenerator::Report& report,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        if (environment.loadReportPrefix.empty()) {
+            return;
+        }
+        const auto stats = TakeStatsSnapshot();
+        const std::pair< const char*, const LatencyHistogram* > distributions[] = {
+            {"connect", &stats.latencies[static_cast< size_t >(Phase::Connect)]},
+            {"ready", &stats.latencies[static_cast< size_t >(Phase::Ready)]},
+            {"send", &stats.latencies[static_cast< size_t >(Phase::Send)]},
+            {"response", &report.responseTimes},
+            {"start-delay", &report.startDelays},
+        };
+        for (const auto& distribution: distributions) {
+            const auto fileName = (
+                environment.loadReportPrefix + "." + distribution.first + ".hgrm"
+            );
+            std::ofstream file(fileName);
+            file << distribution.second->FormatPercentileDistribution(1000.0);
+            if (!file) {
+                diagnosticMessageDelegate(
+                    "Newman",
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    "Unable to write load report to '" + fileName + "'"
+                );
+            }
+        }
+    }
+
+    /**
+     * Save the durations of each phase of sending e-mail, if a file
+     * in which to keep them was given.
+     *
+     * @param[in] environment
+     *     This holds the path to the file in which to save durations.
+     *
+     * @param[in] timeouts
+     *     This holds the durations to save.
+     *
+     * @param[in] diagnosticMessageDelegate
+     *     This is the function to call to publish any diagnostic messages.
+     */
+    void SaveLatencyHistory(
+        const Environment& environment,
+        const AdaptiveTimeouts& timeouts,
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate
+    ) {
+        if (environment.latencyHistoryFileName.empty()) {
+            return;
+        }
+        if (!timeouts.Save(environment.latencyHistoryFileName)) {
+            diagnosticMessageDelegate(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "Unable to save latency history to '" + environment.latencyHistoryFileName + "'"
+            );
+        }
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ * It just sets up the web client, using it to fetch a resource
+ * and generate a report.  It registers the SIGINT signal to know
+ * when the web client should be shut down early.
+ *
+ * The program is terminated after either a report is generated
+ * or the SIGINT signal is caught.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    //_crtBreakAlloc = 18;
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif /* _WIN32 */
+    const auto previousInterruptHandler = signal(SIGINT, InterruptHandler);
+#ifdef SIGUSR1
+    const auto previousStatsRequestHandler = signal(SIGUSR1, StatsRequestHandler);
+#endif /* SIGUSR1 */
+#ifdef SIGHUP
+    const auto previousReloadRequestHandler = signal(SIGHUP, ReloadRequestHandler);
+#endif /* SIGHUP */
+    Environment environment;
+    (void)setbuf(stdout, NULL);
+    const auto diagnosticsPublisher = SystemAbstractions::DiagnosticsStreamReporter(stdout, stderr);
+    if (!ProcessCommandLineArguments(argc, argv, environment, diagnosticsPublisher)) {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+    AdaptiveTimeouts timeouts;
+    timeouts.Configure(environment.timeouts);
+    if (
+        !environment.latencyHistoryFileName.empty()
+        && !timeouts.Load(environment.latencyHistoryFileName)
+    ) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+            "Unable to load latency history from '" + environment.latencyHistoryFileName + "'"
+        );
+    }
+    const auto handshakeLimiter = std::make_shared< HandshakeLimiter >();
+    handshakeLimiter->SetLimit(environment.maxHandshakes);
+    const auto sourceAddresses = std::make_shared< SourceAddressPool >();
+    sourceAddresses->Configure(
+        environment.sourceAddresses,
+        environment.sourceSelection,
+        environment.maxConnectionsPerSource
+    );
+    const auto receiveBuffers = std::make_shared< BufferPool >();
+    const auto idleMemory = std::make_shared< IdleSessionMemory >();
+    const auto transport = std::make_shared< SmtpTransport >();
+    transport->handshakeLimiter = handshakeLimiter;
+    transport->sourceAddresses = sourceAddresses;
+    transport->receiveBuffers = receiveBuffers;
+    transport->idleMemory = idleMemory;
+    const auto resolver = std::make_shared< Resolver >();
+    if (!resolver->Configure(environment.resolver)) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to set up DNS resolver"
+        );
+        return EXIT_FAILURE;
+    }
+    transport->resolver = resolver;
+    transport->returnPathTemplate = environment.returnPathTemplate;
+    transport->diagnosticMessageDelegate = diagnosticsPublisher;
+    transport->useTls = environment.useTls;
+    const auto caCerts = LoadCaCerts(environment.caCertsFileName);
+    if (caCerts != nullptr) {
+        std::atomic_store(&transport->caCerts, caCerts);
+    } else if (environment.useTls) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to read CA certificates from '" + environment.caCertsFileName + "'"
+        );
+        return EXIT_FAILURE;
+    }
+    const auto shared = !environment.nodeId.empty();
+    const auto emailFileNames = ListEmailFileNames(environment.emailFileName, shared);
+    if (emailFileNames.empty()) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "No e-mails found in '" + environment.emailFileName + "'"
+        );
+        return EXIT_FAILURE;
+    }
+    if (
+        !environment.nodes.empty()
+        && (
+            std::find(
+                environment.nodes.begin(),
+                environment.nodes.end(),
+                environment.nodeId
+            ) == environment.nodes.end()
+        )
+    ) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "The node given by --node must be one of those given by --nodes."
+        );
+        return EXIT_FAILURE;
+    }
+    HashRing nodes;
+    nodes.Configure(environment.nodes);
+    if (
+        (environment.load.sessions > 0)
+        && (
+            (emailFileNames.size() != 1)
+            || shared
+        )
+    ) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "A load test needs exactly one e-mail to send, not a shared directory."
+        );
+        return EXIT_FAILURE;
+    }
+    DeliveryIndex deliveryIndex;
+    if (
+        (environment.load.sessions == 0)
+        && !environment.deliveredIndexFileName.empty()
+        && !deliveryIndex.Open(
+            environment.deliveredIndexFileName,
+            environment.deliveredRetention
+        )
+    ) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to open delivered index '" + environment.deliveredIndexFileName + "'"
+        );
+        return EXIT_FAILURE;
+    }
+    auto routingTable = std::make_shared< RoutingTable >();
+    if (!environment.routesFileName.empty()) {
+        std::string error;
+        if (!routingTable->Load(environment.routesFileName, error)) {
+            diagnosticsPublisher(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "Unable to load routes from '" + environment.routesFileName + "': " + error
+            );
+            return EXIT_FAILURE;
+        }
+        diagnosticsPublisher(
+            "Newman",
+            3,
+            "Loaded " + std::to_string(routingTable->GetSize()) + " route(s)."
+        );
+    }
+    std::shared_ptr< const RoutingTable > currentRoutingTable = routingTable;
+    reloadDelegate = [&environment, transport, &currentRoutingTable, diagnosticsPublisher]{
+        ReloadCaCerts(*transport, environment.caCertsFileName, diagnosticsPublisher);
+        if (!environment.routesFileName.empty()) {
+            ReloadRoutingTable(currentRoutingTable, environment.routesFileName, diagnosticsPublisher);
+        }
+    };
+    BodyStore bodyStore;
+    std::vector< Email > emails;
+    size_t failed = 0;
+    size_t skipped = 0;
+    size_t leftToOthers = 0;
+    for (const auto& emailFileName: emailFileNames) {
+        if (
+            reloadRequested.exchange(false)
+            && (reloadDelegate != nullptr)
+        ) {
+            reloadDelegate();
+        }
+        if (
+            shared
+            && !SpoolLease::IsClaimable(emailFileName)
+        ) {
+            ++leftToOthers;
+            continue;
+        }
+        auto email = ReadEmail(emailFileName, bodyStore);
+        if (environment.load.sessions > 0) {
+            std::string bodyDigest;
+            email.body = ReadEmailBody(email, emailFileName, bodyStore, bodyDigest);
+        }
+        const auto envelope = BuildEnvelope(email.wellKnownHeaders);
+        struct stat status;
+        if (
+            shared
+            && envelope.recipients.empty()
+            && (stat(emailFileName.c_str(), &status) != 0)
+        ) {
+            // Another node claimed the file while it was being read.
+            ++leftToOthers;
+            continue;
+        }
+        if (envelope.recipients.empty()) {
+            diagnosticsPublisher(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "The e-mail '" + emailFileName + "' has no recipients!"
+            );
+            ++failed;
+            continue;
+        }
+        if (
+            !environment.routesFileName.empty()
+            && !RouteEmail(email, envelope, *std::atomic_load(&currentRoutingTable))
+        ) {
+            diagnosticsPublisher(
+                "Newman",
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "No route for the e-mail '" + emailFileName + "'!"
+            );
+            ++failed;
+            continue;
+        }
+        if (shared) {
+            const auto owner = nodes.GetOwner(GetDestination(email));
+            if (
+                !owner.empty()
+                && (owner != environment.nodeId)
+            ) {
+                ++leftToOthers;
+                continue;
+            }
+            email.lease = std::make_shared< SpoolLease >();
+            if (
+                !email.lease->Claim(
+                    emailFileName,
+                    environment.nodeId,
+                    environment.leaseDuration
+                )
+            ) {
+                ++leftToOthers;
+                continue;
+            }
+            email.fileName = SpoolLease::GetUnclaimedFileName(emailFileName);
+        }
+        diagnosticsPublisher(
+            "Newman",
+            3,
+            (
+                "E-mail '" + email.fileName + "' has "
+                + std::to_string(envelope.recipients.size())
+                + " recipient(s) (" + std::to_string(envelope.duplicatesRemoved)
+                + " duplicate(s) removed)."
+            )
+        );
+        email.recipientList = GetRecipientList(envelope);
+        if (!environment.deliveredIndexFileName.empty()) {
+            if (
+                IsDelivered(
+                    deliveryIndex,
+                    GetDeliveryKeys(email, email.body, ""),
+                    email,
+                    email.body
+                )
+            ) {
+                diagnosticsPublisher(
+                    "Newman",
+                    3,
+                    "E-mail '" + email.fileName + "' was already delivered; skipping."
+                );
+                if (email.lease != nullptr) {
+                    (void)email.lease->Complete();
+                }
+                ++skipped;
+                continue;
+            }
+        }
+        RemoveServerHeaders(email);
+
+        // Start looking up the SMTP server now, so that the lookups of
+        // all the servers in the batch happen while files are still
+        // being read, rather than one at a time as each is connected.
+        resolver->Prefetch(email.wellKnownHeaders[WellKnownHeader::XSmtpServerHostname]);
+        emails.push_back(std::move(email));
+    }
+    if (environment.load.sessions > 0) {
+        if (emails.empty()) {
+            return EXIT_FAILURE;
+        }
+        diagnosticsPublisher("Newman", 3, "Starting load test.");
+        const auto report = RunLoadTest(
+            environment,
+            emails.front(),
+            transport,
+            timeouts,
+            diagnosticsPublisher
+        );
+        diagnosticsPublisher("Newman", 3, "Load test: " + report.ToString());
+        WriteLoadReport(environment, report, diagnosticsPublisher);
+        PublishStats(diagnosticsPublisher);
+        PublishSourceAddressUsage(*sourceAddresses, diagnosticsPublisher);
+        PublishReceiveBufferUsage(*receiveBuffers, *idleMemory, diagnosticsPublisher);
+        PublishResolverStats(*resolver, diagnosticsPublisher);
+        SaveLatencyHistory(environment, timeouts, diagnosticsPublisher);
+        if (
+            (report.sent == 0)
+            || shutDown
+        ) {
+            return EXIT_FAILURE;
+        }
+        diagnosticsPublisher("Newman", 3, "Exiting...");
+        return EXIT_SUCCESS;
+    }
+
+    // Send e-mails going to the same SMTP server with the same
+    // credentials together, in their original order, so that they
+    // can share sessions.
+    std::vector< std::vector< const Email* > > batches;
+    for (const auto& email: emails) {
+        auto batch = std::find_if(
+            batches.begin(),
+            batches.end(),
+            [&email](const std::vector< const Email* >& batch){
+                return CanShareSession(*batch.front(), email);
+            }
+        );
+        if (batch == batches.end()) {
+            batches.emplace_back();
+            batch = batches.end() - 1;
+        }
+        batch->push_back(&email);
+    }
+
+    // Send to every destination at the same time (up to the limit given),
+    // so that each one's e-mails start going out as soon as its session
+    // is ready, and the whole batch takes as long as the slowest
+    // destination rather than all of them added up.
+    std::atomic< size_t > sessionsOpened(0);
+    std::atomic< size_t > nextBatch(0);
+    BatchOutcome outcome;
+    std::mutex outcomeMutex;
+    size_t numSenders = batches.size();
+    if (
+        (environment.maxDestinations > 0)
+        && (environment.maxDestinations < numSenders)
+    ) {
+        numSenders = environment.maxDestinations;
+    }
+    std::vector< std::thread > senders;
+    for (size_t i = 0; i < numSenders; ++i) {
+        senders.emplace_back(
+            [&]{
+                for (;;) {
+                    const auto batch = nextBatch++;
+                    if (batch >= batches.size()) {
+                        break;
+                    }
+                    const auto batchOutcome = SendBatch(
+                        batches[batch],
+                        environment,
+                        *transport,
+                        sessionsOpened,
+                        deliveryIndex,
+                        bodyStore,
+                        timeouts,
+                        diagnosticsPublisher
+                    );
+                    std::lock_guard< decltype(outcomeMutex) > lock(outcomeMutex);
+                    outcome += batchOutcome;
+                }
+            }
+        );
+    }
+    for (auto& sender: senders) {
+        sender.join();
+    }
+    failed += outcome.failed;
+    skipped += outcome.skipped;
+    if (emails.size() > 1) {
+        diagnosticsPublisher(
+            "Newman",
+            3,
+            (
+                "Read the bodies of " + std::to_string(bodyStore.GetInternCount())
+                + " of " + std::to_string(emails.size()) + " e-mails ("
+                + std::to_string(bodyStore.GetBytesSaved())
+                + " bytes saved by sharing identical bodies)."
+            )
+        );
+    }
+    PublishStats(diagnosticsPublisher);
+    PublishSourceAddressUsage(*sourceAddresses, diagnosticsPublisher);
+    PublishReceiveBufferUsage(*receiveBuffers, *idleMemory, diagnosticsPublisher);
+    PublishResolverStats(*resolver, diagnosticsPublisher);
+    SaveLatencyHistory(environment, timeouts, diagnosticsPublisher);
+    diagnosticsPublisher(
+        "Newman",
+        3,
+        std::to_string(outcome.sent) + " e-mail(s) successfully sent."
+    );
+    if (skipped > 0) {
+        diagnosticsPublisher(
+            "Newman",
+            3,
+            std::to_string(skipped) + " e-mail(s) were already delivered; skipped."
+        );
+    }
+    if (outcome.lostClaims > 0) {
+        diagnosticsPublisher(
+            "Newman",
+            3,
+            std::to_string(outcome.lostClaims) + " e-mail(s) left to the new holders of their claims."
+        );
+    }
+    if (failed > 0) {
+        diagnosticsPublisher(
+            "Newman",
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            std::to_string(failed) + " e-mail(s) could not be sent."
+        );
+        return EXIT_FAILURE;
+    }
+    if (leftToOthers > 0) {
+        diagnosticsPublisher(
+            "Newman",
+            3,
+            std::to_string(leftToOthers) + " e-mail(s) left to other nodes."
+        );
     }
-    diagnosticsPublisher("Newman", 3, "E-mail successfully sent.");
 //    const auto diagnosticsSubscription = client.SubscribeToDiagnostics(diagnosticsPublisher);
+#ifdef SIGHUP
+    (void)signal(SIGHUP, previousReloadRequestHandler);
+#endif /* SIGHUP */
+#ifdef SIGUSR1
+    (void)signal(SIGUSR1, previousStatsRequestHandler);
+#endif /* SIGUSR1 */
     (void)signal(SIGINT, previousInterruptHandler);
     diagnosticsPublisher("Newman", 3, "Exiting...");
     return EXIT_SUCCESS;
@@ -0,0 +1,128 @@
+/**
+ * @file AddressListTests.cpp
+ *
+ * This module contains the unit tests of the functions
+ * which extract addresses from address-list header values.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <AddressList.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <WellKnownHeaders.hpp>
+
+namespace {
+
+    /**
+     * Extract the addresses of all the mailboxes in the given
+     * address-list header value.
+     *
+     * @param[in] value
+     *     This is the address-list header value to parse.
+     *
+     * @return
+     *     Copies of the extracted addresses are returned.
+     */
+    std::vector< std::string > ParseAddresses(const std::string& value) {
+        std::vector< AddressView > views;
+        ParseAddressList(value, views);
+        std::vector< std::string > addresses;
+        for (const auto& view: views) {
+            addresses.push_back(view.ToString());
+        }
+        return addresses;
+    }
+
+    /**
+     * Set the value of the given header among the given well-known
+     * headers, marking it as present.
+     *
+     * @param[in,out] wellKnownHeaders
+     *     These are the well-known headers to update.
+     *
+     * @param[in] header
+     *     This identifies the header to set.
+     *
+     * @param[in] value
+     *     This is the value to give the header.
+     */
+    void SetHeader(
+        WellKnownHeaderValues& wellKnownHeaders,
+        WellKnownHeader header,
+        const std::string& value
+    ) {
+        wellKnownHeaders[header] = value;
+        wellKnownHeaders.present[static_cast< size_t >(header)] = true;
+    }
+
+}
+
+TEST(AddressListTests, PlainAddresses) {
+    EXPECT_EQ(
+        (std::vector< std::string >{"alex@example.com", "sam@example.org"}),
+        ParseAddresses("alex@example.com, sam@example.org")
+    );
+}
+
+TEST(AddressListTests, DisplayNamesAndCommentsSkipped) {
+    EXPECT_EQ(
+        (std::vector< std::string >{"alex@example.com", "sam@example.org", "kim@example.net"}),
+        ParseAddresses(
+            "Alex Example <alex@example.com>,"
+            " \"Example, Sam\" <sam@example.org>,"
+            " kim@example.net (Kim, at home)"
+        )
+    );
+}
+
+TEST(AddressListTests, FoldedValue) {
+    EXPECT_EQ(
+        (std::vector< std::string >{"alex@example.com", "sam@example.org", "kim@example.net"}),
+        ParseAddresses(
+            "Alex Example\r\n <alex@example.com>,\r\n"
+            "\tsam@example.org,\r\n"
+            " Kim <kim@example.net>"
+        )
+    );
+}
+
+TEST(AddressListTests, GroupNamesSkipped) {
+    EXPECT_EQ(
+        (std::vector< std::string >{"alex@example.com", "sam@example.org", "kim@example.net"}),
+        ParseAddresses("Team: alex@example.com, Sam <sam@example.org>;, kim@example.net")
+    );
+    EXPECT_TRUE(ParseAddresses("undisclosed-recipients:;").empty());
+}
+
+TEST(AddressListTests, EmptyValue) {
+    EXPECT_TRUE(ParseAddresses("").empty());
+    EXPECT_TRUE(ParseAddresses(" ,\r\n , ").empty());
+}
+
+TEST(AddressListTests, EnvelopeRecipientsDeduplicatedWithoutRegardToCase) {
+    WellKnownHeaderValues wellKnownHeaders;
+    SetHeader(wellKnownHeaders, WellKnownHeader::From, "Alex <alex@example.com>");
+    SetHeader(wellKnownHeaders, WellKnownHeader::To, "sam@example.org, Kim <kim@example.net>");
+    SetHeader(wellKnownHeaders, WellKnownHeader::Cc, "SAM@EXAMPLE.ORG, lee@example.com");
+    SetHeader(wellKnownHeaders, WellKnownHeader::Bcc, "Kim@Example.Net");
+    const auto envelope = BuildEnvelope(wellKnownHeaders);
+    EXPECT_EQ("alex@example.com", envelope.mailFrom.ToString());
+    ASSERT_EQ(3, envelope.recipients.size());
+    EXPECT_EQ("sam@example.org", envelope.recipients[0].ToString());
+    EXPECT_EQ("kim@example.net", envelope.recipients[1].ToString());
+    EXPECT_EQ("lee@example.com", envelope.recipients[2].ToString());
+    EXPECT_EQ(2, envelope.duplicatesRemoved);
+}
+
+TEST(AddressListTests, EnvelopeSenderPreferredOverFrom) {
+    WellKnownHeaderValues wellKnownHeaders;
+    SetHeader(wellKnownHeaders, WellKnownHeader::From, "alex@example.com, sam@example.org");
+    SetHeader(wellKnownHeaders, WellKnownHeader::Sender, "Sam <sam@example.org>");
+    SetHeader(wellKnownHeaders, WellKnownHeader::To, "kim@example.net");
+    const auto envelope = BuildEnvelope(wellKnownHeaders);
+    EXPECT_EQ("sam@example.org", envelope.mailFrom.ToString());
+    ASSERT_EQ(1, envelope.recipients.size());
+    EXPECT_EQ("kim@example.net", envelope.recipients[0].ToString());
+}
@@ -0,0 +1,128 @@
+/**
+ * @file DeliveryIndexTests.cpp
+ *
+ * This module contains the unit tests of the DeliveryIndex class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <DeliveryIndex.hpp>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+
+namespace {
+
+    /**
+     * This is the path of the file holding the index under test.
+     */
+    const std::string INDEX_FILE_NAME = "DeliveryIndexTests.idx";
+
+    /**
+     * This is how long the index under test keeps each key.
+     */
+    constexpr auto RETENTION = std::chrono::seconds(3600);
+
+    /**
+     * Return the size of the file with the given path.
+     *
+     * @param[in] fileName
+     *     This is the path of the file.
+     *
+     * @return
+     *     The size of the file is returned, or -1 if it couldn't be opened.
+     */
+    long GetFileSize(const std::string& fileName) {
+        const auto file = fopen(fileName.c_str(), "rb");
+        if (file == NULL) {
+            return -1;
+        }
+        (void)fseek(file, 0, SEEK_END);
+        const auto size = ftell(file);
+        (void)fclose(file);
+        return size;
+    }
+
+}
+
+/**
+ * This is the base for test fixtures used to test the DeliveryIndex class.
+ */
+struct DeliveryIndexTests
+    : public ::testing::Test
+{
+    // ::testing::Test
+
+    virtual void SetUp() override {
+        (void)remove(INDEX_FILE_NAME.c_str());
+    }
+
+    virtual void TearDown() override {
+        (void)remove(INDEX_FILE_NAME.c_str());
+    }
+};
+
+TEST_F(DeliveryIndexTests, KeysDependOnKind) {
+    EXPECT_EQ(
+        DeliveryIndex::MakeKey("message-id", "<a@example.com>"),
+        DeliveryIndex::MakeKey("message-id", "<a@example.com>")
+    );
+    EXPECT_NE(
+        DeliveryIndex::MakeKey("message-id", "<a@example.com>"),
+        DeliveryIndex::MakeKey("content", "<a@example.com>")
+    );
+}
+
+TEST_F(DeliveryIndexTests, KeysKeptAcrossReopen) {
+    {
+        DeliveryIndex index;
+        ASSERT_TRUE(index.Open(INDEX_FILE_NAME, RETENTION));
+        EXPECT_EQ(0, index.GetSize());
+        EXPECT_TRUE(index.Add(1));
+        EXPECT_TRUE(index.Add(2));
+        EXPECT_TRUE(index.Contains(1));
+        EXPECT_FALSE(index.Contains(3));
+    }
+    DeliveryIndex index;
+    ASSERT_TRUE(index.Open(INDEX_FILE_NAME, RETENTION));
+    EXPECT_EQ(2, index.GetSize());
+    EXPECT_TRUE(index.Contains(1));
+    EXPECT_TRUE(index.Contains(2));
+    EXPECT_FALSE(index.Contains(3));
+}
+
+TEST_F(DeliveryIndexTests, TornTailDroppedAndFileRealigned) {
+    long sizeWithOneKey = 0;
+    {
+        DeliveryIndex index;
+        ASSERT_TRUE(index.Open(INDEX_FILE_NAME, RETENTION));
+        ASSERT_TRUE(index.Add(1));
+        sizeWithOneKey = GetFileSize(INDEX_FILE_NAME);
+        ASSERT_TRUE(index.Add(2));
+    }
+    const auto intactSize = GetFileSize(INDEX_FILE_NAME);
+    const auto recordSize = intactSize - sizeWithOneKey;
+    ASSERT_GT(recordSize, 0);
+
+    // Simulate a crash in the middle of recording a key.
+    const auto file = fopen(INDEX_FILE_NAME.c_str(), "ab");
+    ASSERT_FALSE(file == NULL);
+    (void)fwrite("\x01\x02\x03\x04\x05", 5, 1, file);
+    (void)fclose(file);
+    {
+        DeliveryIndex index;
+        ASSERT_TRUE(index.Open(INDEX_FILE_NAME, RETENTION));
+        EXPECT_EQ(2, index.GetSize());
+        ASSERT_TRUE(index.Add(3));
+    }
+
+    // The torn record is cut off, so the key added after it isn't
+    // misaligned by it.
+    EXPECT_EQ(intactSize + recordSize, GetFileSize(INDEX_FILE_NAME));
+    DeliveryIndex index;
+    ASSERT_TRUE(index.Open(INDEX_FILE_NAME, RETENTION));
+    EXPECT_EQ(3, index.GetSize());
+    EXPECT_TRUE(index.Contains(1));
+    EXPECT_TRUE(index.Contains(2));
+    EXPECT_TRUE(index.Contains(3));
+}
@@ -0,0 +1,90 @@
+/**
+ * @file HashRingTests.cpp
+ *
+ * This module contains the unit tests of the HashRing class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <gtest/gtest.h>
+#include <HashRing.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the number of keys looked up in tests of how keys
+     * are spread among nodes.
+     */
+    constexpr size_t NUM_KEYS = 3000;
+
+    /**
+     * Return the key looked up in tests of how keys are spread
+     * among nodes, at the given position.
+     */
+    std::string MakeKey(size_t i) {
+        return "mx" + std::to_string(i) + ".example.com:25";
+    }
+
+}
+
+TEST(HashRingTests, NoNodes) {
+    HashRing ring;
+    EXPECT_EQ("", ring.GetOwner(MakeKey(0)));
+    ring.Configure({});
+    EXPECT_EQ("", ring.GetOwner(MakeKey(0)));
+}
+
+TEST(HashRingTests, OneNodeOwnsEverything) {
+    HashRing ring;
+    ring.Configure({"node-a"});
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_EQ("node-a", ring.GetOwner(MakeKey(i)));
+    }
+}
+
+TEST(HashRingTests, OwnersDontDependOnNodeOrder) {
+    HashRing ring1;
+    ring1.Configure({"node-a", "node-b", "node-c"});
+    HashRing ring2;
+    ring2.Configure({"node-c", "node-a", "node-b"});
+    for (size_t i = 0; i < NUM_KEYS; ++i) {
+        const auto key = MakeKey(i);
+        EXPECT_EQ(ring1.GetOwner(key), ring2.GetOwner(key)) << key;
+    }
+}
+
+TEST(HashRingTests, KeysSpreadAmongNodes) {
+    HashRing ring;
+    ring.Configure({"node-a", "node-b", "node-c"});
+    std::map< std::string, size_t > keysOwned;
+    for (size_t i = 0; i < NUM_KEYS; ++i) {
+        ++keysOwned[ring.GetOwner(MakeKey(i))];
+    }
+    ASSERT_EQ(3, keysOwned.size());
+    for (const auto& node: keysOwned) {
+        EXPECT_GT(node.second, NUM_KEYS / 6) << node.first;
+    }
+}
+
+TEST(HashRingTests, AddingNodeOnlyMovesKeysToIt) {
+    HashRing ring;
+    ring.Configure({"node-a", "node-b", "node-c"});
+    std::vector< std::string > owners;
+    for (size_t i = 0; i < NUM_KEYS; ++i) {
+        owners.push_back(ring.GetOwner(MakeKey(i)));
+    }
+    ring.Configure({"node-a", "node-b", "node-c", "node-d"});
+    size_t moved = 0;
+    for (size_t i = 0; i < NUM_KEYS; ++i) {
+        const auto owner = ring.GetOwner(MakeKey(i));
+        if (owner != owners[i]) {
+            EXPECT_EQ("node-d", owner) << MakeKey(i);
+            ++moved;
+        }
+    }
+    EXPECT_GT(moved, 0);
+    EXPECT_LT(moved, NUM_KEYS / 2);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file ReplyParserTests.cpp
+ *
+ * This module contains the unit tests of the ReplyParser class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <gtest/gtest.h>
+#include <ReplyParser.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is what the tests keep of each reply parsed, since the
+     * views in a reply are only valid during the call to the delegate.
+     */
+    struct ParsedReply {
+        unsigned int code = 0;
+        std::string enhancedStatus;
+        std::string text;
+        std::string lines;
+        size_t numLines = 0;
+    };
+
+}
+
+/**
+ * This is the base for test fixtures used to test the ReplyParser class.
+ */
+struct ReplyParserTests
+    : public ::testing::Test
+{
+    // Properties
+
+    /**
+     * These are the replies parsed.
+     */
+    std::vector< ParsedReply > replies;
+
+    /**
+     * This is the unit under test.
+     */
+    ReplyParser parser;
+
+    // Methods
+
+    ReplyParserTests()
+        : parser(
+            [this](const ReplyParser::Reply& reply){
+                ParsedReply parsedReply;
+                parsedReply.code = reply.code;
+                parsedReply.enhancedStatus = reply.enhancedStatus.ToString();
+                parsedReply.text = reply.text.ToString();
+                parsedReply.lines = reply.lines.ToString();
+                parsedReply.numLines = reply.numLines;
+                replies.push_back(parsedReply);
+            }
+        )
+    {
+    }
+
+    /**
+     * Give the parser the given data.
+     *
+     * @param[in] data
+     *     This is the data to give the parser.
+     *
+     * @return
+     *     An indication of whether or not the data was well formed
+     *     is returned.
+     */
+    bool Parse(const std::string& data) {
+        return parser.Parse((const uint8_t*)data.data(), data.size());
+    }
+};
+
+TEST_F(ReplyParserTests, SingleLineReply) {
+    ASSERT_TRUE(Parse("250 2.1.0 Sender OK\r\n"));
+    ASSERT_EQ(1, replies.size());
+    EXPECT_EQ(250, replies[0].code);
+    EXPECT_EQ("2.1.0", replies[0].enhancedStatus);
+    EXPECT_EQ("Sender OK", replies[0].text);
+    EXPECT_EQ("250 2.1.0 Sender OK\r\n", replies[0].lines);
+    EXPECT_EQ(1, replies[0].numLines);
+}
+
+TEST_F(ReplyParserTests, ReplySplitMidLine) {
+    ASSERT_TRUE(Parse("250 2.1"));
+    EXPECT_TRUE(replies.empty());
+    ASSERT_TRUE(Parse(".0 Sender"));
+    EXPECT_TRUE(replies.empty());
+    ASSERT_TRUE(Parse(" OK\r"));
+    EXPECT_TRUE(replies.empty());
+    ASSERT_TRUE(Parse("\n354 Go ahead\r\n"));
+    ASSERT_EQ(2, replies.size());
+    EXPECT_EQ(250, replies[0].code);
+    EXPECT_EQ("2.1.0", replies[0].enhancedStatus);
+    EXPECT_EQ("Sender OK", replies[0].text);
+    EXPECT_EQ("250 2.1.0 Sender OK\r\n", replies[0].lines);
+    EXPECT_EQ(354, replies[1].code);
+    EXPECT_EQ("", replies[1].enhancedStatus);
+    EXPECT_EQ("Go ahead", replies[1].text);
+}
+
+TEST_F(ReplyParserTests, ReplyGivenOneByteAtATime) {
+    const std::string data = "220 mx.example.com ESMTP\r\n250-mx.example.com\r\n250 PIPELINING\r\n";
+    for (const auto c: data) {
+        ASSERT_TRUE(Parse(std::string(1, c)));
+    }
+    ASSERT_EQ(2, replies.size());
+    EXPECT_EQ(220, replies[0].code);
+    EXPECT_EQ("mx.example.com ESMTP", replies[0].text);
+    EXPECT_EQ(250, replies[1].code);
+    EXPECT_EQ(2, replies[1].numLines);
+    EXPECT_EQ("250-mx.example.com\r\n250 PIPELINING\r\n", replies[1].lines);
+}
+
+TEST_F(ReplyParserTests, MultiLineReplySplitBetweenLines) {
+    ASSERT_TRUE(Parse("250-mx.example.com Hello\r\n250-PIPE"));
+    EXPECT_TRUE(replies.empty());
+    ASSERT_TRUE(Parse("LINING\r\n250-SIZE 35882577\r\n250 AUTH PLAIN LOGIN\r\n"));
+    ASSERT_EQ(1, replies.size());
+    EXPECT_EQ(250, replies[0].code);
+    EXPECT_EQ("mx.example.com Hello", replies[0].text);
+    EXPECT_EQ(4, replies[0].numLines);
+}
+
+TEST_F(ReplyParserTests, MismatchedCodesInMultiLineReplyNotWellFormed) {
+    EXPECT_FALSE(Parse("250-first\r\n251 second\r\n"));
+    EXPECT_TRUE(replies.empty());
+}
+
+TEST_F(ReplyParserTests, RecoverAfterReplyNotWellFormed) {
+    EXPECT_FALSE(Parse("hello\r\n"));
+    ASSERT_TRUE(Parse("221 Bye\r\n"));
+    ASSERT_EQ(1, replies.size());
+    EXPECT_EQ(221, replies[0].code);
+    EXPECT_EQ("Bye", replies[0].text);
+}
+
+TEST_F(ReplyParserTests, ParseCapabilities) {
+    ASSERT_TRUE(
+        Parse(
+            "250-mx.example.com Hello\r\n"
+            "250-PIPELINING\r\n"
+            "250-SIZE 35882577\r\n"
+            "250-auth PLAIN LOGIN XOAUTH2\r\n"
+            "250 ENHANCEDSTATUSCODES\r\n"
+        )
+    );
+    ASSERT_EQ(1, replies.size());
+    ReplyParser::Capabilities capabilities;
+    ReplyParser reparser(
+        [&capabilities](const ReplyParser::Reply& reply){
+            EXPECT_TRUE(ReplyParser::ParseCapabilities(reply, capabilities));
+        }
+    );
+    ASSERT_TRUE(reparser.Parse((const uint8_t*)replies[0].lines.data(), replies[0].lines.size()));
+    EXPECT_TRUE(capabilities.Has(ReplyParser::Capability::Pipelining));
+    EXPECT_TRUE(capabilities.Has(ReplyParser::Capability::Size));
+    EXPECT_EQ(35882577, capabilities.maxSize);
+    EXPECT_TRUE(capabilities.Has(ReplyParser::Capability::Auth));
+    EXPECT_TRUE(capabilities.Has(ReplyParser::AuthMechanism::Plain));
+    EXPECT_TRUE(capabilities.Has(ReplyParser::AuthMechanism::XOAuth2));
+    EXPECT_FALSE(capabilities.Has(ReplyParser::AuthMechanism::CramMd5));
+    EXPECT_TRUE(capabilities.Has(ReplyParser::Capability::EnhancedStatusCodes));
+    EXPECT_FALSE(capabilities.Has(ReplyParser::Capability::StartTls));
+}
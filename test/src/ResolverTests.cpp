@@ -0,0 +1,334 @@
+/**
+ * @file ResolverTests.cpp
+ *
+ * This module contains the unit tests of the Resolver class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <functional>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <Resolver.hpp>
+#include <stdint.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the address of the host answering as the DNS server.
+     */
+    constexpr uint32_t LOCALHOST = 0x7F000001;
+
+    /**
+     * This is the type of function which makes the answer
+     * to a query, from the query itself.
+     */
+    using AnswerDelegate = std::function<
+        std::vector< uint8_t >(const std::vector< uint8_t >& query)
+    >;
+
+    /**
+     * Return the given 16-bit number in network byte order.
+     */
+    std::vector< uint8_t > Uint16(uint16_t value) {
+        return {(uint8_t)(value >> 8), (uint8_t)value};
+    }
+
+    /**
+     * Return the given 32-bit number in network byte order.
+     */
+    std::vector< uint8_t > Uint32(uint32_t value) {
+        return {
+            (uint8_t)(value >> 24),
+            (uint8_t)(value >> 16),
+            (uint8_t)(value >> 8),
+            (uint8_t)value,
+        };
+    }
+
+    /**
+     * Append the given bytes to the given message.
+     */
+    void Append(
+        std::vector< uint8_t >& message,
+        const std::vector< uint8_t >& bytes
+    ) {
+        message.insert(message.end(), bytes.begin(), bytes.end());
+    }
+
+    /**
+     * Start an answer to the given query, copying its ID and question,
+     * with the given response code and number of answer records.
+     *
+     * @param[in] query
+     *     This is the query being answered.
+     *
+     * @param[in] responseCode
+     *     This is the response code of the answer.
+     *
+     * @param[in] numAnswers
+     *     This is the number of answer records to follow.
+     *
+     * @return
+     *     The start of the answer is returned.
+     */
+    std::vector< uint8_t > StartAnswer(
+        const std::vector< uint8_t >& query,
+        uint8_t responseCode,
+        uint16_t numAnswers
+    ) {
+        std::vector< uint8_t > answer(query.begin(), query.begin() + 2);
+        Append(answer, {0x81, (uint8_t)(0x80 | responseCode)});
+        Append(answer, Uint16(1));
+        Append(answer, Uint16(numAnswers));
+        Append(answer, Uint16(0));
+        Append(answer, Uint16(0));
+        answer.insert(answer.end(), query.begin() + 12, query.end());
+        return answer;
+    }
+
+    /**
+     * Append a resource record to the given answer.
+     *
+     * @param[in,out] answer
+     *     This is the answer to which to append the record.
+     *
+     * @param[in] name
+     *     This is the (possibly compressed) name of the record.
+     *
+     * @param[in] type
+     *     This is the type of the record.
+     *
+     * @param[in] data
+     *     This is the data of the record.
+     */
+    void AppendRecord(
+        std::vector< uint8_t >& answer,
+        const std::vector< uint8_t >& name,
+        uint16_t type,
+        const std::vector< uint8_t >& data
+    ) {
+        Append(answer, name);
+        Append(answer, Uint16(type));
+        Append(answer, Uint16(1));
+        Append(answer, Uint32(60));
+        Append(answer, Uint16((uint16_t)data.size()));
+        Append(answer, data);
+    }
+
+    /**
+     * This answers queries sent to a UDP port on the local host,
+     * as a DNS server would.
+     */
+    struct MockDnsServer {
+        // Properties
+
+        /**
+         * This is the socket on which queries are received.
+         */
+        int sock = -1;
+
+        /**
+         * This is the port on which queries are received.
+         */
+        uint16_t port = 0;
+
+        /**
+         * This is the function which makes the answer to each query.
+         */
+        AnswerDelegate answerDelegate;
+
+        /**
+         * This is the number of queries received.
+         */
+        std::atomic< size_t > queries{0};
+
+        /**
+         * This is set to stop the server.
+         */
+        std::atomic< bool > stop{false};
+
+        /**
+         * This is the thread which answers queries.
+         */
+        std::thread worker;
+
+        // Methods
+
+        ~MockDnsServer() noexcept {
+            stop = true;
+            if (worker.joinable()) {
+                worker.join();
+            }
+            if (sock >= 0) {
+                (void)close(sock);
+            }
+        }
+
+        /**
+         * Start answering queries with the given function.
+         *
+         * @param[in] newAnswerDelegate
+         *     This is the function which makes the answer to each query.
+         *
+         * @return
+         *     An indication of whether or not the server started
+         *     is returned.
+         */
+        bool Start(AnswerDelegate newAnswerDelegate) {
+            answerDelegate = newAnswerDelegate;
+            sock = socket(AF_INET, SOCK_DGRAM, 0);
+            if (sock < 0) {
+                return false;
+            }
+            struct sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(LOCALHOST);
+            socklen_t addressLength = sizeof(address);
+            if (
+                (bind(sock, (struct sockaddr*)&address, sizeof(address)) != 0)
+                || (getsockname(sock, (struct sockaddr*)&address, &addressLength) != 0)
+            ) {
+                return false;
+            }
+            port = ntohs(address.sin_port);
+            worker = std::thread([this]{ Serve(); });
+            return true;
+        }
+
+        /**
+         * Answer queries until told to stop.
+         */
+        void Serve() {
+            while (!stop) {
+                struct pollfd readable = {};
+                readable.fd = sock;
+                readable.events = POLLIN;
+                if (poll(&readable, 1, 50) <= 0) {
+                    continue;
+                }
+                std::vector< uint8_t > query(512);
+                struct sockaddr_in client = {};
+                socklen_t clientLength = sizeof(client);
+                const auto amount = recvfrom(
+                    sock,
+                    query.data(),
+                    query.size(),
+                    0,
+                    (struct sockaddr*)&client,
+                    &clientLength
+                );
+                if (amount < 12) {
+                    continue;
+                }
+                query.resize((size_t)amount);
+                ++queries;
+                const auto answer = answerDelegate(query);
+                if (answer.empty()) {
+                    continue;
+                }
+                (void)sendto(
+                    sock,
+                    answer.data(),
+                    answer.size(),
+                    0,
+                    (struct sockaddr*)&client,
+                    clientLength
+                );
+            }
+        }
+    };
+
+}
+
+/**
+ * This is the base for test fixtures used to test the Resolver class.
+ */
+struct ResolverTests
+    : public ::testing::Test
+{
+    // Properties
+
+    /**
+     * This answers the queries of the unit under test.
+     */
+    MockDnsServer server;
+
+    /**
+     * This is the unit under test.
+     */
+    Resolver resolver;
+
+    // Methods
+
+    /**
+     * Start the DNS server, answering queries with the given function,
+     * and have the unit under test send its queries to it.
+     *
+     * @param[in] answerDelegate
+     *     This is the function which makes the answer to each query.
+     */
+    void Start(AnswerDelegate answerDelegate) {
+        ASSERT_TRUE(server.Start(answerDelegate));
+        Resolver::Configuration configuration;
+        configuration.server = LOCALHOST;
+        configuration.port = server.port;
+        configuration.timeout = std::chrono::milliseconds(200);
+        configuration.attempts = 1;
+        ASSERT_TRUE(resolver.Configure(configuration));
+    }
+};
+
+TEST_F(ResolverTests, DottedDecimalNotLookedUp) {
+    EXPECT_EQ(0x0A000203, resolver.Resolve("10.0.2.3").get());
+}
+
+TEST_F(ResolverTests, AnswerWithCompressedNames) {
+    Start(
+        [](const std::vector< uint8_t >& query){
+            // The CNAME record points back to the name in the question
+            // (offset 12), and the A record points to the CNAME's data,
+            // which itself ends with a pointer to the question's name.
+            auto answer = StartAnswer(query, 0, 2);
+            AppendRecord(answer, {0xC0, 12}, 5, {5, 'a', 'l', 'i', 'a', 's', 0xC0, 12});
+            const auto aliasOffset = (uint8_t)(answer.size() - 8);
+            AppendRecord(answer, {0xC0, aliasOffset}, 1, {192, 0, 2, 7});
+            return answer;
+        }
+    );
+    EXPECT_EQ(0xC0000207, resolver.Resolve("mx.example.com").get());
+    EXPECT_EQ(1, server.queries);
+
+    // The answer is cached.
+    EXPECT_EQ(0xC0000207, resolver.Resolve("MX.Example.com").get());
+    EXPECT_EQ(1, server.queries);
+}
+
+TEST_F(ResolverTests, NameWithPointerLoopRejected) {
+    Start(
+        [](const std::vector< uint8_t >& query){
+            auto answer = StartAnswer(query, 0, 1);
+            const auto recordOffset = (uint8_t)answer.size();
+            AppendRecord(answer, {0xC0, recordOffset}, 1, {192, 0, 2, 7});
+            return answer;
+        }
+    );
+    EXPECT_EQ(0, resolver.Resolve("loop.example.com").get());
+}
+
+TEST_F(ResolverTests, NonexistentName) {
+    Start(
+        [](const std::vector< uint8_t >& query){
+            return StartAnswer(query, 3, 0);
+        }
+    );
+    EXPECT_EQ(0, resolver.Resolve("nx.example.com").get());
+}
@@ -0,0 +1,154 @@
+/**
+ * @file SpoolLeaseTests.cpp
+ *
+ * This module contains the unit tests of the SpoolLease class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <SpoolLease.hpp>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the path of the e-mail file claimed by the leases under test.
+     */
+    const std::string EMAIL_FILE_NAME = "SpoolLeaseTests.eml";
+
+    /**
+     * Check whether or not a file exists at the given path.
+     *
+     * @param[in] fileName
+     *     This is the path to check.
+     *
+     * @return
+     *     An indication of whether or not a file exists at the given path
+     *     is returned.
+     */
+    bool FileExists(const std::string& fileName) {
+        struct stat status;
+        return (stat(fileName.c_str(), &status) == 0);
+    }
+
+}
+
+/**
+ * This is the base for test fixtures used to test the SpoolLease class.
+ */
+struct SpoolLeaseTests
+    : public ::testing::Test
+{
+    // Properties
+
+    /**
+     * These are the paths the e-mail file may have been left with.
+     */
+    std::vector< std::string > fileNames;
+
+    // Methods
+
+    /**
+     * Remember the path the given lease has given the e-mail file,
+     * so that it's removed once the test is done.
+     *
+     * @param[in] lease
+     *     This is the lease whose file to remember.
+     *
+     * @return
+     *     The path the lease has given the e-mail file is returned.
+     */
+    std::string Track(const SpoolLease& lease) {
+        const auto fileName = lease.GetFileName();
+        fileNames.push_back(fileName);
+        return fileName;
+    }
+
+    // ::testing::Test
+
+    virtual void SetUp() override {
+        const auto file = fopen(EMAIL_FILE_NAME.c_str(), "wb");
+        ASSERT_FALSE(file == NULL);
+        (void)fputs("Subject: Test\r\n\r\nHello\r\n", file);
+        (void)fclose(file);
+        fileNames.push_back(EMAIL_FILE_NAME);
+    }
+
+    virtual void TearDown() override {
+        for (const auto& fileName: fileNames) {
+            (void)remove(fileName.c_str());
+        }
+    }
+};
+
+TEST_F(SpoolLeaseTests, ClaimRenamesFile) {
+    SpoolLease lease;
+    ASSERT_TRUE(lease.Claim(EMAIL_FILE_NAME, "nodeA", std::chrono::seconds(60)));
+    const auto claimedFileName = Track(lease);
+    EXPECT_NE(EMAIL_FILE_NAME, claimedFileName);
+    EXPECT_FALSE(FileExists(EMAIL_FILE_NAME));
+    EXPECT_TRUE(FileExists(claimedFileName));
+    EXPECT_EQ(EMAIL_FILE_NAME, SpoolLease::GetUnclaimedFileName(claimedFileName));
+    EXPECT_FALSE(SpoolLease::IsClaimable(claimedFileName));
+    EXPECT_EQ(1, lease.GetFence());
+}
+
+TEST_F(SpoolLeaseTests, UnexpiredLeaseNotTakenOver) {
+    SpoolLease holder;
+    ASSERT_TRUE(holder.Claim(EMAIL_FILE_NAME, "nodeA", std::chrono::seconds(60)));
+    const auto claimedFileName = Track(holder);
+    SpoolLease contender;
+    EXPECT_FALSE(contender.Claim(EMAIL_FILE_NAME, "nodeB", std::chrono::seconds(60)));
+    EXPECT_FALSE(contender.Claim(claimedFileName, "nodeB", std::chrono::seconds(60)));
+    EXPECT_TRUE(FileExists(claimedFileName));
+    EXPECT_TRUE(holder.Renew(std::chrono::seconds(60)));
+    Track(holder);
+}
+
+TEST_F(SpoolLeaseTests, ExpiredLeaseTakenOver) {
+    SpoolLease staleHolder;
+    ASSERT_TRUE(staleHolder.Claim(EMAIL_FILE_NAME, "nodeA", std::chrono::seconds(0)));
+    const auto expiredFileName = Track(staleHolder);
+    EXPECT_TRUE(SpoolLease::IsClaimable(expiredFileName));
+    SpoolLease newHolder;
+    ASSERT_TRUE(newHolder.Claim(expiredFileName, "nodeB", std::chrono::seconds(60)));
+    const auto claimedFileName = Track(newHolder);
+    EXPECT_EQ(2, newHolder.GetFence());
+    EXPECT_FALSE(FileExists(expiredFileName));
+    EXPECT_TRUE(FileExists(claimedFileName));
+
+    // The holder whose lease was taken over can no longer act on the file.
+    EXPECT_FALSE(staleHolder.Renew(std::chrono::seconds(60)));
+    EXPECT_FALSE(staleHolder.Complete());
+    EXPECT_FALSE(staleHolder.Release());
+    EXPECT_TRUE(FileExists(claimedFileName));
+    EXPECT_FALSE(FileExists(EMAIL_FILE_NAME));
+
+    EXPECT_TRUE(newHolder.Complete());
+    EXPECT_FALSE(FileExists(claimedFileName));
+}
+
+TEST_F(SpoolLeaseTests, ReleaseRestoresFile) {
+    {
+        SpoolLease lease;
+        ASSERT_TRUE(lease.Claim(EMAIL_FILE_NAME, "nodeA", std::chrono::seconds(60)));
+        Track(lease);
+        EXPECT_TRUE(lease.Release());
+        EXPECT_TRUE(FileExists(EMAIL_FILE_NAME));
+    }
+    SpoolLease lease;
+    ASSERT_TRUE(lease.Claim(EMAIL_FILE_NAME, "nodeB", std::chrono::seconds(60)));
+    Track(lease);
+}
+
+TEST_F(SpoolLeaseTests, ValidOwners) {
+    EXPECT_TRUE(SpoolLease::IsValidOwner("node-1_a"));
+    EXPECT_FALSE(SpoolLease::IsValidOwner(""));
+    EXPECT_FALSE(SpoolLease::IsValidOwner("node.1"));
+    EXPECT_FALSE(SpoolLease::IsValidOwner("node/1"));
+}
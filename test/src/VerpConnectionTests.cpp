@@ -0,0 +1,474 @@
+/**
+ * @file VerpConnectionTests.cpp
+ *
+ * This module contains the unit tests of the VerpConnection class.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <SystemAbstractions/INetworkConnection.hpp>
+#include <VerpConnection.hpp>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the template from which the return path
+     * of each recipient is made.
+     */
+    const std::string RETURN_PATH_TEMPLATE = "bounces+{local}={domain}@list.example.com";
+
+    /**
+     * This is the message content the client sends, including the line
+     * marking its end.
+     */
+    const std::string CONTENT = "Subject: Hello\r\n\r\nHi there\r\n.\r\n";
+
+    /**
+     * This stands in for the connection to an SMTP server.  It answers
+     * each command as a server would, turning down any recipient
+     * whose address begins with "bad", and holds its replies until
+     * they're delivered, so the tests decide when the server replies.
+     */
+    struct MockSmtpServer
+        : public SystemAbstractions::INetworkConnection
+    {
+        // Properties
+
+        /**
+         * This indicates whether or not the server lists the
+         * PIPELINING capability in its reply to EHLO.
+         */
+        bool pipelining = false;
+
+        /**
+         * This is everything received from the client.
+         */
+        std::string received;
+
+        /**
+         * This holds what's been received from the client
+         * which hasn't been handled yet.
+         */
+        std::string unhandled;
+
+        /**
+         * This holds the replies not yet delivered to the client.
+         */
+        std::string replies;
+
+        /**
+         * This indicates whether or not the server is receiving
+         * message content.
+         */
+        bool receivingContent = false;
+
+        /**
+         * This indicates whether or not a mail transaction is started.
+         */
+        bool mailTransaction = false;
+
+        /**
+         * This is the number of recipients accepted in the
+         * current mail transaction.
+         */
+        size_t recipients = 0;
+
+        /**
+         * This is the number of messages accepted.
+         */
+        size_t messagesAccepted = 0;
+
+        /**
+         * This is the function to call to deliver data to the client.
+         */
+        MessageReceivedDelegate messageReceivedDelegate;
+
+        // Methods
+
+        /**
+         * Deliver the replies held, if any, to the client, split in two
+         * so that the client has to put replies back together.
+         *
+         * @return
+         *     An indication of whether or not there were any replies
+         *     to deliver is returned.
+         */
+        bool DeliverReplies() {
+            if (replies.empty()) {
+                return false;
+            }
+            std::string data;
+            data.swap(replies);
+            const auto half = data.length() / 2;
+            messageReceivedDelegate(std::vector< uint8_t >(data.begin(), data.begin() + half));
+            messageReceivedDelegate(std::vector< uint8_t >(data.begin() + half, data.end()));
+            return true;
+        }
+
+        /**
+         * Handle the given command line from the client.
+         *
+         * @param[in] line
+         *     This is the command line, without its line ending.
+         */
+        void HandleCommand(const std::string& line) {
+            if (line.compare(0, 5, "EHLO ") == 0) {
+                replies += "250-mx.example.com\r\n";
+                if (pipelining) {
+                    replies += "250-PIPELINING\r\n";
+                }
+                replies += "250 SIZE 1000000\r\n";
+            } else if (line == "NOOP") {
+                replies += "250 2.0.0 OK\r\n";
+            } else if (line.compare(0, 10, "MAIL FROM:") == 0) {
+                if (mailTransaction) {
+                    replies += "503 5.5.1 Nested MAIL command\r\n";
+                } else {
+                    mailTransaction = true;
+                    replies += "250 2.1.0 OK\r\n";
+                }
+            } else if (line.compare(0, 8, "RCPT TO:") == 0) {
+                if (!mailTransaction) {
+                    replies += "503 5.5.1 Need MAIL command\r\n";
+                } else if (line.compare(8, 4, "<bad") == 0) {
+                    replies += "550 5.1.1 No such user\r\n";
+                } else {
+                    ++recipients;
+                    replies += "250 2.1.5 OK\r\n";
+                }
+            } else if (line == "DATA") {
+                if (recipients == 0) {
+                    replies += "554 5.5.1 No valid recipients\r\n";
+                } else {
+                    receivingContent = true;
+                    replies += "354 Go ahead\r\n";
+                }
+            } else if (line == "RSET") {
+                mailTransaction = false;
+                recipients = 0;
+                replies += "250 2.0.0 OK\r\n";
+            } else if (line == "QUIT") {
+                replies += "221 2.0.0 Bye\r\n";
+            } else {
+                replies += "500 5.5.2 Unrecognized command\r\n";
+            }
+        }
+
+        // SystemAbstractions::INetworkConnection
+
+        virtual SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+            SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate,
+            size_t
+        ) override {
+            return []{};
+        }
+
+        virtual bool Connect(uint32_t, uint16_t) override {
+            return true;
+        }
+
+        virtual bool Process(
+            MessageReceivedDelegate messageReceivedDelegate,
+            BrokenDelegate
+        ) override {
+            this->messageReceivedDelegate = messageReceivedDelegate;
+            replies += "220 mx.example.com ESMTP\r\n";
+            return true;
+        }
+
+        virtual uint32_t GetPeerAddress() const override {
+            return 0;
+        }
+
+        virtual uint16_t GetPeerPort() const override {
+            return 0;
+        }
+
+        virtual bool IsConnected() const override {
+            return true;
+        }
+
+        virtual uint32_t GetBoundAddress() const override {
+            return 0;
+        }
+
+        virtual uint16_t GetBoundPort() const override {
+            return 0;
+        }
+
+        virtual void SendMessage(const std::vector< uint8_t >& message) override {
+            const std::string data(message.begin(), message.end());
+            received += data;
+            unhandled += data;
+            for (;;) {
+                if (receivingContent) {
+                    const auto end = unhandled.find("\r\n.\r\n");
+                    if (end == std::string::npos) {
+                        return;
+                    }
+                    unhandled.erase(0, end + 5);
+                    receivingContent = false;
+                    mailTransaction = false;
+                    recipients = 0;
+                    ++messagesAccepted;
+                    replies += "250 2.0.0 Queued\r\n";
+                    continue;
+                }
+                const auto lineEnd = unhandled.find("\r\n");
+                if (lineEnd == std::string::npos) {
+                    return;
+                }
+                const auto line = unhandled.substr(0, lineEnd);
+                unhandled.erase(0, lineEnd + 2);
+                HandleCommand(line);
+            }
+        }
+
+        virtual void Close(bool) override {
+        }
+    };
+
+}
+
+/**
+ * This is the base for test fixtures used to test the VerpConnection class.
+ */
+struct VerpConnectionTests
+    : public ::testing::Test
+{
+    // Properties
+
+    /**
+     * This stands in for the SMTP server.
+     */
+    std::shared_ptr< MockSmtpServer > server = std::make_shared< MockSmtpServer >();
+
+    /**
+     * This is the unit under test.
+     */
+    std::shared_ptr< VerpConnection > verp;
+
+    /**
+     * This holds the reply lines delivered to the client
+     * which haven't been looked at yet.
+     */
+    std::vector< std::string > replyLines;
+
+    /**
+     * This holds what's been delivered to the client after
+     * the last complete reply line.
+     */
+    std::string partialReplyLine;
+
+    /**
+     * These are the warnings published by the unit under test.
+     */
+    std::vector< std::string > warnings;
+
+    // Methods
+
+    /**
+     * Set up the unit under test, have it receive the server's
+     * greeting, and have the client send EHLO.
+     *
+     * @param[in] pipelining
+     *     This indicates whether or not the server supports pipelining.
+     */
+    void Start(bool pipelining) {
+        server->pipelining = pipelining;
+        verp = std::make_shared< VerpConnection >(
+            server,
+            RETURN_PATH_TEMPLATE,
+            [this](
+                std::string,
+                size_t,
+                std::string message
+            ){
+                warnings.push_back(message);
+            }
+        );
+        ASSERT_TRUE(
+            verp->Process(
+                [this](const std::vector< uint8_t >& message){
+                    partialReplyLine.append(message.begin(), message.end());
+                    for (;;) {
+                        const auto lineEnd = partialReplyLine.find("\r\n");
+                        if (lineEnd == std::string::npos) {
+                            break;
+                        }
+                        replyLines.push_back(partialReplyLine.substr(0, lineEnd));
+                        partialReplyLine.erase(0, lineEnd + 2);
+                    }
+                },
+                [](bool){}
+            )
+        );
+        EXPECT_EQ("220 mx.example.com ESMTP", Command(""));
+        (void)Command("EHLO client.example.com\r\n");
+        replyLines.clear();
+    }
+
+    /**
+     * Have the client send the given data, and have the server
+     * answer until the client has been given a reply.
+     *
+     * @param[in] data
+     *     This is what the client sends.
+     *
+     * @return
+     *     The first line of the reply the client was given
+     *     is returned, or an empty string if it wasn't given one.
+     */
+    std::string Command(const std::string& data) {
+        if (!data.empty()) {
+            verp->SendMessage(std::vector< uint8_t >(data.begin(), data.end()));
+        }
+        while (
+            replyLines.empty()
+            && server->DeliverReplies()
+        ) {
+        }
+        while (server->DeliverReplies()) {
+        }
+        if (replyLines.empty()) {
+            return "";
+        }
+        const auto reply = replyLines.front();
+        replyLines.erase(replyLines.begin());
+        return reply;
+    }
+
+    /**
+     * Have the client send an e-mail to the given recipients.
+     *
+     * @param[in] recipients
+     *     These are the addresses of the recipients.
+     *
+     * @return
+     *     The first line of the reply the client was given to the
+     *     message content is returned.
+     */
+    std::string SendMail(const std::vector< std::string >& recipients) {
+        EXPECT_EQ("250 OK", Command("MAIL FROM:<sender@example.com>\r\n"));
+        for (const auto& recipient: recipients) {
+            EXPECT_EQ("250 OK", Command("RCPT TO:<" + recipient + ">\r\n"));
+        }
+        EXPECT_EQ(0, Command("DATA\r\n").compare(0, 4, "354 "));
+        return Command(CONTENT);
+    }
+};
+
+TEST_F(VerpConnectionTests, MakeReturnPath) {
+    EXPECT_EQ(
+        "bounces+alex=example.org@list.example.com",
+        VerpConnection::MakeReturnPath(RETURN_PATH_TEMPLATE, "alex@example.org")
+    );
+    EXPECT_EQ(
+        "b+{x}+j.d=",
+        VerpConnection::MakeReturnPath("b+{x}+{local}={domain}", "j.d")
+    );
+}
+
+TEST_F(VerpConnectionTests, OneTransactionPerRecipient) {
+    Start(false);
+    EXPECT_EQ(
+        "250 OK: accepted for 2 of 2 recipients",
+        SendMail({"alex@example.org", "sam@example.net"})
+    );
+    EXPECT_EQ(2, server->messagesAccepted);
+    EXPECT_NE(
+        std::string::npos,
+        server->received.find(
+            "MAIL FROM:<bounces+alex=example.org@list.example.com>\r\n"
+            "RCPT TO:<alex@example.org>\r\n"
+        )
+    );
+    EXPECT_NE(
+        std::string::npos,
+        server->received.find(
+            "MAIL FROM:<bounces+sam=example.net@list.example.com>\r\n"
+            "RCPT TO:<sam@example.net>\r\n"
+        )
+    );
+    EXPECT_TRUE(warnings.empty());
+    EXPECT_GT(verp->GetReplyCount(), 0);
+}
+
+TEST_F(VerpConnectionTests, RcptRejectedWithoutPipelining) {
+    Start(false);
+    EXPECT_EQ(
+        "250 OK: accepted for 2 of 3 recipients",
+        SendMail({"alex@example.org", "bad@example.org", "sam@example.net"})
+    );
+    EXPECT_EQ(2, server->messagesAccepted);
+
+    // Without pipelining, the transaction is reset as soon as
+    // the recipient is turned down, without sending DATA.
+    EXPECT_NE(
+        std::string::npos,
+        server->received.find(
+            "RCPT TO:<bad@example.org>\r\n"
+            "RSET\r\n"
+            "MAIL FROM:<bounces+sam=example.net@list.example.com>\r\n"
+        )
+    );
+    ASSERT_EQ(1, warnings.size());
+    EXPECT_NE(std::string::npos, warnings[0].find("<bad@example.org>"));
+    EXPECT_NE(std::string::npos, warnings[0].find("550 5.1.1 No such user"));
+
+    // The connection is ready for the next transaction.
+    EXPECT_EQ(
+        "250 OK: accepted for 1 of 1 recipients",
+        SendMail({"kim@example.com"})
+    );
+    EXPECT_EQ(3, server->messagesAccepted);
+}
+
+TEST_F(VerpConnectionTests, RcptRejectedWithPipelining) {
+    Start(true);
+    EXPECT_EQ(
+        "250 OK: accepted for 2 of 3 recipients",
+        SendMail({"alex@example.org", "bad@example.org", "sam@example.net"})
+    );
+    EXPECT_EQ(2, server->messagesAccepted);
+
+    // With pipelining, the commands of each transaction are sent
+    // together, so DATA follows the recipient turned down, and the
+    // transaction is reset once DATA is turned down too.
+    EXPECT_NE(
+        std::string::npos,
+        server->received.find(
+            "MAIL FROM:<bounces+bad=example.org@list.example.com>\r\n"
+            "RCPT TO:<bad@example.org>\r\n"
+            "DATA\r\n"
+        )
+    );
+    EXPECT_NE(std::string::npos, server->received.find("RSET\r\n"));
+    ASSERT_EQ(1, warnings.size());
+    EXPECT_NE(std::string::npos, warnings[0].find("<bad@example.org>"));
+    EXPECT_NE(std::string::npos, warnings[0].find("550 5.1.1 No such user"));
+    EXPECT_EQ(
+        "250 OK: accepted for 1 of 1 recipients",
+        SendMail({"kim@example.com"})
+    );
+    EXPECT_EQ(3, server->messagesAccepted);
+}
+
+TEST_F(VerpConnectionTests, AllRecipientsRejected) {
+    for (const auto pipelining: {false, true}) {
+        server = std::make_shared< MockSmtpServer >();
+        warnings.clear();
+        Start(pipelining);
+        EXPECT_EQ(
+            "550 5.1.1 No such user",
+            SendMail({"bad@example.org"})
+        ) << "pipelining: " << pipelining;
+        EXPECT_EQ(0, server->messagesAccepted);
+        EXPECT_EQ(1, warnings.size());
+    }
+}
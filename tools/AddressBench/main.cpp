@@ -0,0 +1,342 @@
+/**
+ * @file main.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the program which measures how fast Newman extracts the recipients
+ * of e-mails from their address-list headers.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <MessageHeaders/MessageHeaders.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "AddressList.hpp"
+#include "WellKnownHeaders.hpp"
+
+namespace {
+
+    /**
+     * This function prints to the standard error stream information
+     * about how to use this program.
+     */
+    void PrintUsageInformation() {
+        fprintf(
+            stderr,
+            (
+                "Usage: NewmanAddressBench [OPTIONS]\n"
+                "\n"
+                "Measure how fast the recipients of an e-mail are extracted from\n"
+                "its To, Cc, and Bcc headers, comparing Newman's address-list\n"
+                "parser with splitting the headers into values through\n"
+                "MessageHeaders and copying out each address.  The headers are\n"
+                "generated, folded, with display names on some addresses, and\n"
+                "with some addresses repeated in a different case.\n"
+                "\n"
+                "Options:\n"
+                "\n"
+                "--emails=N                 (default: 1000)\n"
+                        "Number of times the headers are parsed.\n"
+                "--addresses=N              (default: 5000)\n"
+                        "Number of addresses in the headers of each e-mail.\n"
+                "--duplicates=PERCENT       (default: 10)\n"
+                        "Share of addresses which repeat an earlier one.\n"
+            )
+        );
+    }
+
+    /**
+     * This contains variables set through the operating system environment
+     * or the command-line arguments.
+     */
+    struct Environment {
+        size_t emails = 1000;
+        size_t addresses = 5000;
+        size_t duplicates = 10;
+    };
+
+    /**
+     * These are the headers which list recipients, in the order
+     * addresses are spread over them.
+     */
+    const char* const RECIPIENT_HEADERS[] = {
+        "To",
+        "Cc",
+        "Bcc",
+    };
+
+    /**
+     * Generate the headers of an e-mail with the given number of
+     * recipient addresses, folding each address-list header so that
+     * no line is longer than 78 characters.
+     *
+     * @param[in] environment
+     *     This holds the shape of the headers.
+     *
+     * @param[out] numRecipients
+     *     This is where to store the number of distinct recipients.
+     *
+     * @return
+     *     The headers of the e-mail, ending with the empty line which
+     *     separates them from the body, are returned.
+     */
+    std::string GenerateHeaders(
+        const Environment& environment,
+        size_t& numRecipients
+    ) {
+        const auto numHeaders = sizeof(RECIPIENT_HEADERS) / sizeof(RECIPIENT_HEADERS[0]);
+        std::vector< std::string > lists(numHeaders);
+        std::vector< std::string > lines(numHeaders);
+        numRecipients = 0;
+        for (size_t i = 0; i < environment.addresses; ++i) {
+            const auto list = i % numHeaders;
+            std::string address;
+            if (
+                (numRecipients > 0)
+                && ((i * environment.duplicates) % 100 < environment.duplicates)
+            ) {
+                address = "USER" + std::to_string(i % numRecipients) + "@EXAMPLE.COM";
+            } else {
+                address = "user" + std::to_string(numRecipients++) + "@example.com";
+            }
+            std::string mailbox;
+            if (i % 2 == 0) {
+                mailbox = "Recipient Number " + std::to_string(i) + " <" + address + ">";
+            } else {
+                mailbox = address;
+            }
+            if (!lines[list].empty()) {
+                lines[list] += ",";
+                if (lines[list].length() + mailbox.length() + 2 > 78) {
+                    lists[list] += lines[list] + "\r\n";
+                    lines[list].clear();
+                }
+                lines[list] += " ";
+            }
+            lines[list] += mailbox;
+        }
+        std::string headers = (
+            "From: Sender <sender@example.com>\r\n"
+            "Subject: Benchmark\r\n"
+            "Message-ID: <benchmark@example.com>\r\n"
+        );
+        for (size_t i = 0; i < numHeaders; ++i) {
+            lists[i] += lines[i];
+            if (!lists[i].empty()) {
+                headers += std::string(RECIPIENT_HEADERS[i]) + ":" + lists[i] + "\r\n";
+            }
+        }
+        headers += "\r\n";
+        return headers;
+    }
+
+    /**
+     * Extract the recipients of an e-mail the way it's done without
+     * Newman's address-list parser: split each address-list header
+     * into values through MessageHeaders, copy out the address of each,
+     * and remove duplicates by comparing lowercase copies.
+     *
+     * @param[in] headers
+     *     These are the headers of the e-mail.
+     *
+     * @return
+     *     The number of distinct recipients is returned.
+     */
+    size_t CountRecipientsWithMessageHeaders(const MessageHeaders::MessageHeaders& headers) {
+        std::vector< std::string > recipients;
+        std::unordered_set< std::string > seen;
+        for (const auto name: RECIPIENT_HEADERS) {
+            if (!headers.HasHeader(name)) {
+                continue;
+            }
+            for (const auto& value: headers.GetHeaderMultiValue(name)) {
+                auto begin = value.find('<');
+                auto end = std::string::npos;
+                if (begin == std::string::npos) {
+                    begin = value.find_first_not_of(" \t\r\n");
+                    end = value.find_last_not_of(" \t\r\n");
+                    if (begin == std::string::npos) {
+                        continue;
+                    }
+                    ++end;
+                } else {
+                    ++begin;
+                    end = value.find('>', begin);
+                    if (end == std::string::npos) {
+                        continue;
+                    }
+                }
+                auto address = value.substr(begin, end - begin);
+                auto key = address;
+                std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+                if (seen.insert(std::move(key)).second) {
+                    recipients.push_back(std::move(address));
+                }
+            }
+        }
+        return recipients.size();
+    }
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[in,out] environment
+     *     This is the environment to update.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(
+        int argc,
+        char* argv[],
+        Environment& environment
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            const auto delimiter = arg.find('=');
+            if (
+                (arg.substr(0, 2) != "--")
+                || (delimiter == std::string::npos)
+            ) {
+                fprintf(stderr, "error: unrecognized argument '%s'\n", arg.c_str());
+                return false;
+            }
+            const auto name = arg.substr(2, delimiter - 2);
+            const auto value = arg.substr(delimiter + 1);
+            const auto number = (size_t)strtoull(value.c_str(), NULL, 10);
+            if (name == "emails") {
+                environment.emails = number;
+            } else if (name == "addresses") {
+                environment.addresses = number;
+            } else if (name == "duplicates") {
+                environment.duplicates = number;
+            } else {
+                fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                return false;
+            }
+        }
+        if (environment.duplicates > 100) {
+            fprintf(stderr, "error: duplicates must be no more than 100 percent\n");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Return the number of seconds since the given time.
+     */
+    double SecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration< double >(
+            std::chrono::steady_clock::now() - start
+        ).count();
+    }
+
+    /**
+     * Print how fast addresses were extracted one way.
+     */
+    void PrintRate(
+        const char* method,
+        uint64_t addresses,
+        double seconds
+    ) {
+        printf(
+            "%-16s %.3f s: %.0f addresses/s, %.1f ns/address\n",
+            method,
+            seconds,
+            (seconds > 0.0) ? (addresses / seconds) : 0.0,
+            (addresses > 0) ? (seconds * 1e9 / addresses) : 0.0
+        );
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ * It extracts the recipients of a generated e-mail over and over,
+ * both through MessageHeaders and with Newman's address-list parser,
+ * and reports how fast each was.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Environment environment;
+    if (!ProcessCommandLineArguments(argc, argv, environment)) {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+    size_t numRecipients = 0;
+    const auto rawHeaders = GenerateHeaders(environment, numRecipients);
+    MessageHeaders::MessageHeaders headers;
+    size_t bodyOffset = 0;
+    if (
+        headers.ParseRawMessage(rawHeaders, bodyOffset)
+        != MessageHeaders::MessageHeaders::State::Complete
+    ) {
+        fprintf(stderr, "error: generated headers were not well formed\n");
+        return EXIT_FAILURE;
+    }
+
+    // Both ways start from headers already parsed, since every e-mail's
+    // headers are parsed whichever way its recipients are extracted.
+    auto start = std::chrono::steady_clock::now();
+    uint64_t messageHeadersRecipients = 0;
+    for (size_t i = 0; i < environment.emails; ++i) {
+        messageHeadersRecipients += CountRecipientsWithMessageHeaders(headers);
+    }
+    const auto messageHeadersSeconds = SecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    uint64_t addressListRecipients = 0;
+    for (size_t i = 0; i < environment.emails; ++i) {
+        const auto wellKnownHeaders = ClassifyHeaders(headers);
+        addressListRecipients += BuildEnvelope(wellKnownHeaders).recipients.size();
+    }
+    const auto addressListSeconds = SecondsSince(start);
+
+    const auto expected = (uint64_t)numRecipients * environment.emails;
+    if (
+        (messageHeadersRecipients != expected)
+        || (addressListRecipients != expected)
+    ) {
+        fprintf(
+            stderr,
+            "error: found %llu (MessageHeaders) and %llu (AddressList) recipients, expected %llu\n",
+            (unsigned long long)messageHeadersRecipients,
+            (unsigned long long)addressListRecipients,
+            (unsigned long long)expected
+        );
+        return EXIT_FAILURE;
+    }
+    const auto addresses = (uint64_t)environment.addresses * environment.emails;
+    printf(
+        "%zu e-mails of %zu addresses (%zu distinct, %zu bytes of headers)\n",
+        environment.emails,
+        environment.addresses,
+        numRecipients,
+        rawHeaders.length()
+    );
+    PrintRate("MessageHeaders", addresses, messageHeadersSeconds);
+    PrintRate("AddressList", addresses, addressListSeconds);
+    if (addressListSeconds > 0.0) {
+        printf("speedup: %.1fx\n", messageHeadersSeconds / addressListSeconds);
+    }
+    return EXIT_SUCCESS;
+}
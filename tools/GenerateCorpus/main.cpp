@@ -0,0 +1,417 @@
+/**
+ * @file main.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the program which generates collections of e-mails for
+ * benchmarking Newman.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <fstream>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "Random.hpp"
+
+namespace {
+
+    /**
+     * This function prints to the standard error stream information
+     * about how to use this program.
+     */
+    void PrintUsageInformation() {
+        fprintf(
+            stderr,
+            (
+                "Usage: NewmanGenerateCorpus [OPTIONS] DIRECTORY\n"
+                "\n"
+                "Generate e-mails (in Electronic Mail Format, or .eml) for Newman\n"
+                "to send.  The same options and seed always generate the same\n"
+                "e-mails.  Lines end in a single line feed, as Newman expects\n"
+                "of files it reads.\n"
+                "\n"
+                "DIRECTORY  Path to directory in which to write the e-mails.\n"
+                "\n"
+                "Options:\n"
+                "\n"
+                "--seed=N                   (default: 1)\n"
+                "--count=N                  (default: 100)\n"
+                "--server=HOST:PORT         (default: localhost:465)\n"
+                "--username=NAME            (default: alex@example.com)\n"
+                "--password=SECRET          (default: hunter2)\n"
+                "--body-median=BYTES        (default: 2000)\n"
+                "--body-sigma=S             (default: 1.5)\n"
+                        "Body sizes are log-normally distributed.\n"
+                "--headers-mean=N           (default: 6)\n"
+                        "Mean number of extra headers per e-mail.\n"
+                "--fold-probability=P       (default: 0.3)\n"
+                        "Probability that a header is folded.\n"
+                "--recipients-mean=N        (default: 2)\n"
+                "--recipients-max=N         (default: 100)\n"
+                "--attachment-probability=P (default: 0.2)\n"
+                "--attachment-median=BYTES  (default: 50000)\n"
+                "--line-length-mean=N       (default: 60)\n"
+                "--line-length-max=N        (default: 998)\n"
+                "--eight-bit-probability=P  (default: 0.1)\n"
+                        "Probability that an e-mail's body contains\n"
+                        "8-bit (UTF-8) text.\n"
+            )
+        );
+    }
+
+    /**
+     * This contains variables set through the operating system environment
+     * or the command-line arguments.
+     */
+    struct Environment {
+        std::string directory;
+        uint64_t seed = 1;
+        size_t count = 100;
+        std::string server = "localhost:465";
+        std::string username = "alex@example.com";
+        std::string password = "hunter2";
+        double bodyMedian = 2000.0;
+        double bodySigma = 1.5;
+        double headersMean = 6.0;
+        double foldProbability = 0.3;
+        double recipientsMean = 2.0;
+        size_t recipientsMax = 100;
+        double attachmentProbability = 0.2;
+        double attachmentMedian = 50000.0;
+        double lineLengthMean = 60.0;
+        size_t lineLengthMax = 998;
+        double eightBitProbability = 0.1;
+    };
+
+    /**
+     * These are words used to make up text.  Some are 8-bit (UTF-8).
+     */
+    const char* const ASCII_WORDS[] = {
+        "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+        "invoice", "meeting", "report", "update", "please", "review",
+        "attached", "schedule", "thanks", "regards", "tomorrow", "project",
+        "delivery", "account", "summary", "question", "a", "of", "to", "and",
+    };
+    const char* const EIGHT_BIT_WORDS[] = {
+        "caf\xC3\xA9", "na\xC3\xAFve", "\xC3\xBC" "ber", "stra\xC3\x9F" "e",
+        "\xE6\x97\xA5\xE6\x9C\xAC", "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82",
+    };
+
+    /**
+     * Generate the next word of text.
+     */
+    std::string Word(Random& generator, bool eightBit) {
+        if (
+            eightBit
+            && generator.Chance(0.2)
+        ) {
+            return EIGHT_BIT_WORDS[
+                generator.Below(sizeof(EIGHT_BIT_WORDS) / sizeof(EIGHT_BIT_WORDS[0]))
+            ];
+        }
+        return ASCII_WORDS[
+            generator.Below(sizeof(ASCII_WORDS) / sizeof(ASCII_WORDS[0]))
+        ];
+    }
+
+    /**
+     * Generate lines of text adding up to about the given number of bytes.
+     */
+    std::string Text(
+        Random& generator,
+        const Environment& environment,
+        size_t size,
+        bool eightBit
+    ) {
+        std::string text;
+        while (text.length() < size) {
+            auto lineLength = (size_t)generator.LogNormal(environment.lineLengthMean, 0.5);
+            if (lineLength > environment.lineLengthMax) {
+                lineLength = environment.lineLengthMax;
+            }
+            std::string line;
+            while (line.length() < lineLength) {
+                if (!line.empty()) {
+                    line += ' ';
+                }
+                line += Word(generator, eightBit);
+            }
+            if (line.length() > environment.lineLengthMax) {
+                line.resize(environment.lineLengthMax);
+            }
+            // Leading periods would need to be dot-stuffed; avoid them.
+            if (
+                !line.empty()
+                && (line[0] == '.')
+            ) {
+                line[0] = ',';
+            }
+            text += line + "\n";
+        }
+        return text;
+    }
+
+    /**
+     * Generate a base64-encoded attachment of about the given size.
+     */
+    std::string Attachment(Random& generator, size_t size) {
+        static const char alphabet[] = (
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+        );
+        std::string encoded;
+        encoded.reserve(size + size / 76 + 77);
+        while (encoded.length() < size) {
+            for (size_t i = 0; i < 76; ++i) {
+                encoded += alphabet[generator.Next() & 63];
+            }
+            encoded += "\n";
+        }
+        return encoded;
+    }
+
+    /**
+     * Format a header, possibly folding it after each comma-separated
+     * item, or in the middle of unstructured text.
+     */
+    std::string Header(
+        Random& generator,
+        const Environment& environment,
+        const std::string& name,
+        const std::vector< std::string >& items,
+        const std::string& separator
+    ) {
+        const auto fold = generator.Chance(environment.foldProbability);
+        std::string header = name + ":";
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0) {
+                header += separator;
+                if (fold) {
+                    header += "\n";
+                }
+            }
+            header += " " + items[i];
+        }
+        return header + "\n";
+    }
+
+    /**
+     * Generate one e-mail.
+     */
+    std::string Email(
+        Random& generator,
+        const Environment& environment,
+        size_t index
+    ) {
+        const auto hostEnd = environment.server.find(':');
+        const auto host = environment.server.substr(0, hostEnd);
+        const auto port = (
+            (hostEnd == std::string::npos)
+            ? std::string("465")
+            : environment.server.substr(hostEnd + 1)
+        );
+        const auto eightBit = generator.Chance(environment.eightBitProbability);
+        std::string email;
+        auto recipientsCount = 1 + generator.Geometric(environment.recipientsMean - 1.0);
+        if (recipientsCount > environment.recipientsMax) {
+            recipientsCount = environment.recipientsMax;
+        }
+        std::vector< std::string > recipients;
+        for (size_t i = 0; i < recipientsCount; ++i) {
+            recipients.push_back(
+                "<user" + std::to_string(generator.Below(100000))
+                + "@example" + std::to_string(generator.Below(10)) + ".com>"
+            );
+        }
+        email += Header(generator, environment, "To", recipients, ",");
+        email += "From: <" + environment.username + ">\n";
+        std::vector< std::string > subject;
+        const auto subjectWords = 1 + generator.Below(8);
+        for (size_t i = 0; i < subjectWords; ++i) {
+            subject.push_back(Word(generator, false));
+        }
+        email += Header(generator, environment, "Subject", subject, "");
+        email += (
+            "Message-ID: <" + std::to_string(environment.seed) + "."
+            + std::to_string(index) + "@corpus.newman.invalid>\n"
+        );
+        email += "MIME-Version: 1.0\n";
+        const auto extraHeaders = generator.Geometric(environment.headersMean);
+        for (size_t i = 0; i < extraHeaders; ++i) {
+            std::vector< std::string > words;
+            const auto headerWords = 1 + generator.Below(12);
+            for (size_t j = 0; j < headerWords; ++j) {
+                words.push_back(Word(generator, false));
+            }
+            email += Header(
+                generator,
+                environment,
+                "X-Corpus-" + std::to_string(i),
+                words,
+                ""
+            );
+        }
+        email += "X-SMTP-Server-Hostname: " + host + "\n";
+        email += "X-SMTP-Port: " + port + "\n";
+        email += "X-SMTP-Username: " + environment.username + "\n";
+        email += "X-SMTP-Password: " + environment.password + "\n";
+        const auto bodySize = (size_t)generator.LogNormal(
+            environment.bodyMedian,
+            environment.bodySigma
+        );
+        const auto text = Text(generator, environment, bodySize, eightBit);
+        const auto textHeaders = (
+            std::string("Content-Type: text/plain; charset=utf-8\n")
+            + "Content-Transfer-Encoding: " + (eightBit ? "8bit" : "7bit") + "\n"
+        );
+        if (generator.Chance(environment.attachmentProbability)) {
+            const auto boundary = "=_corpus_" + std::to_string(index);
+            email += "Content-Type: multipart/mixed; boundary=\"" + boundary + "\"\n";
+            email += "\n";
+            email += "--" + boundary + "\n" + textHeaders + "\n" + text;
+            email += (
+                "--" + boundary + "\n"
+                + "Content-Type: application/octet-stream\n"
+                + "Content-Transfer-Encoding: base64\n"
+                + "Content-Disposition: attachment; filename=\"file"
+                + std::to_string(index) + ".bin\"\n"
+                + "\n"
+            );
+            email += Attachment(
+                generator,
+                (size_t)generator.LogNormal(environment.attachmentMedian, 1.0)
+            );
+            email += "--" + boundary + "--\n";
+        } else {
+            email += textHeaders + "\n" + text;
+        }
+        return email;
+    }
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[in,out] environment
+     *     This is the environment to update.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(
+        int argc,
+        char* argv[],
+        Environment& environment
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            if (arg.substr(0, 2) != "--") {
+                if (!environment.directory.empty()) {
+                    fprintf(stderr, "error: extra arguments given\n");
+                    return false;
+                }
+                environment.directory = arg;
+                continue;
+            }
+            const auto delimiter = arg.find('=');
+            if (delimiter == std::string::npos) {
+                fprintf(stderr, "error: no value given for option '%s'\n", arg.c_str());
+                return false;
+            }
+            const auto name = arg.substr(2, delimiter - 2);
+            const auto value = arg.substr(delimiter + 1);
+            const auto number = strtod(value.c_str(), NULL);
+            if (name == "seed") {
+                environment.seed = strtoull(value.c_str(), NULL, 10);
+            } else if (name == "count") {
+                environment.count = (size_t)number;
+            } else if (name == "server") {
+                environment.server = value;
+            } else if (name == "username") {
+                environment.username = value;
+            } else if (name == "password") {
+                environment.password = value;
+            } else if (name == "body-median") {
+                environment.bodyMedian = number;
+            } else if (name == "body-sigma") {
+                environment.bodySigma = number;
+            } else if (name == "headers-mean") {
+                environment.headersMean = number;
+            } else if (name == "fold-probability") {
+                environment.foldProbability = number;
+            } else if (name == "recipients-mean") {
+                environment.recipientsMean = number;
+            } else if (name == "recipients-max") {
+                environment.recipientsMax = (size_t)number;
+            } else if (name == "attachment-probability") {
+                environment.attachmentProbability = number;
+            } else if (name == "attachment-median") {
+                environment.attachmentMedian = number;
+            } else if (name == "line-length-mean") {
+                environment.lineLengthMean = number;
+            } else if (name == "line-length-max") {
+                environment.lineLengthMax = (size_t)number;
+            } else if (name == "eight-bit-probability") {
+                environment.eightBitProbability = number;
+            } else {
+                fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                return false;
+            }
+        }
+        if (environment.directory.empty()) {
+            fprintf(stderr, "error: no DIRECTORY given\n");
+            return false;
+        }
+        if (
+            (environment.recipientsMax == 0)
+            || (environment.lineLengthMax == 0)
+        ) {
+            fprintf(stderr, "error: maximums must be at least 1\n");
+            return false;
+        }
+        return true;
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ * It generates the requested number of e-mails and writes each one
+ * to its own file in the given directory.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Environment environment;
+    if (!ProcessCommandLineArguments(argc, argv, environment)) {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+    Random generator(environment.seed);
+    for (size_t i = 0; i < environment.count; ++i) {
+        char fileName[32];
+        (void)snprintf(fileName, sizeof(fileName), "%08zu.eml", i);
+        const auto path = environment.directory + "/" + fileName;
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << Email(generator, environment, i);
+        if (!file) {
+            fprintf(stderr, "error: unable to write '%s'\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
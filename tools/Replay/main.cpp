@@ -0,0 +1,422 @@
+/**
+ * @file main.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the program which plays the server side of a recorded SMTP
+ * session, so that the session can be reproduced and benchmarked
+ * without the original SMTP server.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <inttypes.h>
+#include <memory>
+#include <mutex>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <SystemAbstractions/DiagnosticsStreamReporter.hpp>
+#include <SystemAbstractions/NetworkConnection.hpp>
+#include <SystemAbstractions/NetworkEndpoint.hpp>
+#include <thread>
+#include <vector>
+
+#include "SessionTrace.hpp"
+
+namespace {
+
+    /**
+     * This function prints to the standard error stream information
+     * about how to use this program.
+     */
+    void PrintUsageInformation() {
+        fprintf(
+            stderr,
+            (
+                "Usage: NewmanReplay [OPTIONS] TRACE\n"
+                "\n"
+                "Play the server side of the SMTP session recorded in TRACE\n"
+                "(by Newman's --record option) for each client which connects,\n"
+                "with the original timing or scaled.  Connections are not\n"
+                "encrypted, so have Newman connect with --tls=off.\n"
+                "\n"
+                "Options:\n"
+                "\n"
+                "--port=N                 (default: 2525)\n"
+                        "Port on which to accept connections.\n"
+                "--time-scale=X           (default: 1)\n"
+                        "Factor by which to multiply the server's recorded\n"
+                        "delays.  Zero responds as quickly as possible.\n"
+                "--client-timeout=MS      (default: 10000)\n"
+                        "How long to wait for the client to send what it\n"
+                        "sent in the recorded session.\n"
+                "\n"
+                "Send SIGINT to stop.\n"
+            )
+        );
+    }
+
+    /**
+     * This flag indicates whether or not the application should shut down.
+     */
+    std::atomic< bool > shutDown(false);
+
+    /**
+     * This function is set up to be called when the SIGINT signal is
+     * received by the program.  It just sets the "shutDown" flag
+     * and relies on the program to be polling the flag to detect
+     * when it's been set.
+     *
+     * @param[in] sig
+     *     This is the signal for which this function was called.
+     */
+    void InterruptHandler(int) {
+        shutDown = true;
+    }
+
+    /**
+     * This contains variables set through the operating system environment
+     * or the command-line arguments.
+     */
+    struct Environment {
+        /**
+         * This is the path to the file containing the recorded session.
+         */
+        std::string traceFileName;
+
+        /**
+         * This is the port on which to accept connections.
+         */
+        uint16_t port = 2525;
+
+        /**
+         * This is the factor by which to multiply the server's
+         * recorded delays.
+         */
+        double timeScale = 1.0;
+
+        /**
+         * This is how long to wait for the client to send what it
+         * sent in the recorded session.
+         */
+        std::chrono::milliseconds clientTimeout = std::chrono::milliseconds(10000);
+    };
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[in,out] environment
+     *     This is the environment to update.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(
+        int argc,
+        char* argv[],
+        Environment& environment
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            if (arg.substr(0, 2) != "--") {
+                if (!environment.traceFileName.empty()) {
+                    fprintf(stderr, "error: extra arguments given\n");
+                    return false;
+                }
+                environment.traceFileName = arg;
+                continue;
+            }
+            const auto delimiter = arg.find('=');
+            if (delimiter == std::string::npos) {
+                fprintf(stderr, "error: no value given for option '%s'\n", arg.c_str());
+                return false;
+            }
+            const auto name = arg.substr(2, delimiter - 2);
+            const auto value = arg.substr(delimiter + 1);
+            const auto number = strtod(value.c_str(), NULL);
+            if (name == "port") {
+                environment.port = (uint16_t)number;
+            } else if (name == "time-scale") {
+                environment.timeScale = number;
+            } else if (name == "client-timeout") {
+                environment.clientTimeout = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+            } else {
+                fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                return false;
+            }
+        }
+        if (environment.traceFileName.empty()) {
+            fprintf(stderr, "error: no TRACE given\n");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * This plays the server side of the recorded session
+     * for one client.
+     */
+    struct Session {
+        /**
+         * This identifies the session in reports.
+         */
+        size_t id = 0;
+
+        /**
+         * These are the bytes received from the client so far.
+         */
+        std::vector< uint8_t > received;
+
+        /**
+         * This indicates whether or not the client has closed
+         * (or broken) the connection.
+         */
+        bool broken = false;
+
+        /**
+         * This indicates whether or not the session is over.
+         */
+        std::atomic< bool > finished{false};
+
+        /**
+         * This is the thread which plays the server side.
+         */
+        std::thread worker;
+
+        /**
+         * This is used to synchronize access to the received bytes.
+         */
+        std::mutex mutex;
+
+        /**
+         * This is used to wake the worker when bytes are received,
+         * or the connection is broken.
+         */
+        std::condition_variable wakeCondition;
+
+        /**
+         * This is the connection to the client.  It's declared last
+         * so that it's destroyed first, before anything its delegates
+         * use.
+         */
+        std::shared_ptr< SystemAbstractions::NetworkConnection > connection;
+
+        /**
+         * Play the server side of the given recorded events.
+         *
+         * @param[in] events
+         *     These are the events of the recorded session.
+         *
+         * @param[in] environment
+         *     This holds the replay settings.
+         */
+        void Play(
+            const std::vector< TraceEvent >& events,
+            const Environment& environment
+        ) {
+            const auto start = std::chrono::steady_clock::now();
+            auto previous = start;
+            size_t expected = 0;
+            size_t differing = 0;
+            size_t played = 0;
+            bool stalled = false;
+            for (const auto& event: events) {
+                if (shutDown) {
+                    break;
+                }
+                if (event.type == TraceEventType::ClientData) {
+                    // The client's own delays aren't ours to reproduce;
+                    // wait for it to send as much as it did before.
+                    const auto begin = expected;
+                    expected += event.data.size();
+                    std::unique_lock< decltype(mutex) > lock(mutex);
+                    if (
+                        !wakeCondition.wait_for(
+                            lock,
+                            environment.clientTimeout,
+                            [this, expected]{
+                                return (
+                                    broken
+                                    || (received.size() >= expected)
+                                );
+                            }
+                        )
+                        || (received.size() < expected)
+                    ) {
+                        stalled = true;
+                        break;
+                    }
+                    for (size_t i = 0; i < event.data.size(); ++i) {
+                        if (received[begin + i] != event.data[i]) {
+                            ++differing;
+                        }
+                    }
+                    previous = std::chrono::steady_clock::now();
+                } else {
+                    const auto due = previous + std::chrono::duration_cast< std::chrono::steady_clock::duration >(
+                        std::chrono::duration< double, std::micro >(
+                            (double)event.delay * environment.timeScale
+                        )
+                    );
+                    std::this_thread::sleep_until(due);
+                    previous = std::chrono::steady_clock::now();
+                    if (event.type == TraceEventType::ServerData) {
+                        connection->SendMessage(event.data);
+                    } else if (event.type == TraceEventType::Closed) {
+                        connection->Close(true);
+                    }
+                }
+                ++played;
+            }
+            size_t receivedBytes;
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                receivedBytes = received.size();
+            }
+            printf(
+                (
+                    "session %zu: %s %zu/%zu events in %.1f ms; client bytes"
+                    " expected %zu, received %zu, differing %zu\n"
+                ),
+                id,
+                (stalled ? "stalled after" : "played"),
+                played,
+                events.size(),
+                std::chrono::duration< double, std::milli >(
+                    std::chrono::steady_clock::now() - start
+                ).count(),
+                expected,
+                receivedBytes,
+                differing
+            );
+            connection->Close(false);
+            finished = true;
+        }
+    };
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ * It loads the recorded session and plays its server side for each
+ * client which connects, until the SIGINT signal is caught.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Environment environment;
+    if (!ProcessCommandLineArguments(argc, argv, environment)) {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+    std::vector< TraceEvent > events;
+    if (!ReadSessionTrace(environment.traceFileName, events)) {
+        fprintf(
+            stderr,
+            "error: unable to read trace '%s'\n",
+            environment.traceFileName.c_str()
+        );
+        return EXIT_FAILURE;
+    }
+    const auto previousInterruptHandler = signal(SIGINT, InterruptHandler);
+    (void)setbuf(stdout, NULL);
+    const auto diagnosticsPublisher = SystemAbstractions::DiagnosticsStreamReporter(stdout, stderr);
+    std::mutex sessionsMutex;
+    std::vector< std::shared_ptr< Session > > sessions;
+    size_t nextSessionId = 1;
+    SystemAbstractions::NetworkEndpoint endpoint;
+    (void)endpoint.SubscribeToDiagnostics(diagnosticsPublisher);
+    const auto newConnectionDelegate = [&](
+        std::shared_ptr< SystemAbstractions::NetworkConnection > newConnection
+    ){
+        const auto session = std::make_shared< Session >();
+        session->connection = newConnection;
+        const auto sessionRaw = session.get();
+        if (
+            !newConnection->Process(
+                [sessionRaw](const std::vector< uint8_t >& message){
+                    std::lock_guard< decltype(sessionRaw->mutex) > lock(sessionRaw->mutex);
+                    sessionRaw->received.insert(
+                        sessionRaw->received.end(),
+                        message.begin(),
+                        message.end()
+                    );
+                    sessionRaw->wakeCondition.notify_all();
+                },
+                [sessionRaw](bool){
+                    std::lock_guard< decltype(sessionRaw->mutex) > lock(sessionRaw->mutex);
+                    sessionRaw->broken = true;
+                    sessionRaw->wakeCondition.notify_all();
+                }
+            )
+        ) {
+            return;
+        }
+        std::lock_guard< decltype(sessionsMutex) > lock(sessionsMutex);
+        session->id = nextSessionId++;
+        session->worker = std::thread(
+            [sessionRaw, &events, &environment]{
+                sessionRaw->Play(events, environment);
+            }
+        );
+        sessions.push_back(session);
+    };
+    if (
+        !endpoint.Open(
+            newConnectionDelegate,
+            nullptr,
+            SystemAbstractions::NetworkEndpoint::Mode::Connection,
+            0,
+            0,
+            environment.port
+        )
+    ) {
+        fprintf(stderr, "error: unable to listen on port %" PRIu16 "\n", environment.port);
+        (void)signal(SIGINT, previousInterruptHandler);
+        return EXIT_FAILURE;
+    }
+    printf(
+        "Replaying %zu events from '%s' on port %" PRIu16 "...\n",
+        events.size(),
+        environment.traceFileName.c_str(),
+        environment.port
+    );
+    while (!shutDown) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard< decltype(sessionsMutex) > lock(sessionsMutex);
+        for (auto it = sessions.begin(); it != sessions.end();) {
+            if ((*it)->finished) {
+                (*it)->worker.join();
+                it = sessions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    endpoint.Close();
+    {
+        std::lock_guard< decltype(sessionsMutex) > lock(sessionsMutex);
+        for (const auto& session: sessions) {
+            session->worker.join();
+        }
+        sessions.clear();
+    }
+    (void)signal(SIGINT, previousInterruptHandler);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file main.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the program which measures how fast Newman parses the replies
+ * of SMTP servers.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "ReplyParser.hpp"
+
+namespace {
+
+    /**
+     * This function prints to the standard error stream information
+     * about how to use this program.
+     */
+    void PrintUsageInformation() {
+        fprintf(
+            stderr,
+            (
+                "Usage: NewmanReplyBench [OPTIONS]\n"
+                "\n"
+                "Measure how many SMTP replies per second Newman parses.  The\n"
+                "replies are those of sessions each made up of a multi-line\n"
+                "EHLO reply followed by pipelined replies to sending e-mails,\n"
+                "received in chunks of a fixed size, so that replies are\n"
+                "often split across chunks.\n"
+                "\n"
+                "Options:\n"
+                "\n"
+                "--sessions=N               (default: 100000)\n"
+                "--emails=N                 (default: 5)\n"
+                        "Number of e-mails sent in each session.\n"
+                "--recipients=N             (default: 3)\n"
+                        "Number of recipients of each e-mail.\n"
+                "--capabilities=N           (default: 12)\n"
+                        "Number of lines in each EHLO reply after the first.\n"
+                "--chunk=BYTES              (default: 1460)\n"
+                        "Size of each piece of data given to the parser.\n"
+            )
+        );
+    }
+
+    /**
+     * This contains variables set through the operating system environment
+     * or the command-line arguments.
+     */
+    struct Environment {
+        size_t sessions = 100000;
+        size_t emails = 5;
+        size_t recipients = 3;
+        size_t capabilities = 12;
+        size_t chunk = 1460;
+    };
+
+    /**
+     * These are the capabilities listed in each EHLO reply, in turn.
+     */
+    const char* const CAPABILITIES[] = {
+        "PIPELINING",
+        "SIZE 35882577",
+        "ETRN",
+        "AUTH PLAIN LOGIN XOAUTH2",
+        "AUTH=PLAIN LOGIN",
+        "ENHANCEDSTATUSCODES",
+        "8BITMIME",
+        "DSN",
+        "SMTPUTF8",
+        "CHUNKING",
+        "BINARYMIME",
+        "VRFY",
+    };
+
+    /**
+     * Generate the replies of one SMTP session.
+     *
+     * @param[in] environment
+     *     This holds the shape of the session.
+     *
+     * @param[out] numReplies
+     *     This is where to store the number of replies generated.
+     *
+     * @return
+     *     The replies of the session are returned.
+     */
+    std::string GenerateSession(
+        const Environment& environment,
+        size_t& numReplies
+    ) {
+        std::string session = "220 mx.example.com ESMTP Postfix\r\n";
+        session += (environment.capabilities > 0) ? "250-" : "250 ";
+        session += "mx.example.com Hello client.example.com [192.0.2.1]\r\n";
+        const auto numCapabilities = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+        for (size_t i = 0; i < environment.capabilities; ++i) {
+            session += (i + 1 < environment.capabilities) ? "250-" : "250 ";
+            session += CAPABILITIES[i % numCapabilities];
+            session += "\r\n";
+        }
+        session += "235 2.7.0 Authentication successful\r\n";
+        numReplies = 4;
+        for (size_t i = 0; i < environment.emails; ++i) {
+            session += "250 2.1.0 Ok\r\n";
+            for (size_t j = 0; j < environment.recipients; ++j) {
+                session += "250 2.1.5 Ok\r\n";
+            }
+            session += "354 End data with <CR><LF>.<CR><LF>\r\n";
+            session += "250 2.0.0 Ok: queued as 4Bm2dX0Qz5z9sWc\r\n";
+            numReplies += 3 + environment.recipients;
+        }
+        session += "221 2.0.0 Bye\r\n";
+        return session;
+    }
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[in,out] environment
+     *     This is the environment to update.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(
+        int argc,
+        char* argv[],
+        Environment& environment
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            const auto delimiter = arg.find('=');
+            if (
+                (arg.substr(0, 2) != "--")
+                || (delimiter == std::string::npos)
+            ) {
+                fprintf(stderr, "error: unrecognized argument '%s'\n", arg.c_str());
+                return false;
+            }
+            const auto name = arg.substr(2, delimiter - 2);
+            const auto value = arg.substr(delimiter + 1);
+            const auto number = (size_t)strtoull(value.c_str(), NULL, 10);
+            if (name == "sessions") {
+                environment.sessions = number;
+            } else if (name == "emails") {
+                environment.emails = number;
+            } else if (name == "recipients") {
+                environment.recipients = number;
+            } else if (name == "capabilities") {
+                environment.capabilities = number;
+            } else if (name == "chunk") {
+                environment.chunk = number;
+            } else {
+                fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                return false;
+            }
+        }
+        if (environment.chunk == 0) {
+            fprintf(stderr, "error: chunk size must be at least 1\n");
+            return false;
+        }
+        return true;
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ * It feeds the replies of many generated SMTP sessions to a reply parser
+ * and reports how fast they were parsed.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Environment environment;
+    if (!ProcessCommandLineArguments(argc, argv, environment)) {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+    size_t repliesPerSession = 0;
+    const auto session = GenerateSession(environment, repliesPerSession);
+    const std::vector< uint8_t > data(session.begin(), session.end());
+    uint64_t replies = 0;
+    uint64_t checksum = 0;
+    uint64_t capabilityBits = 0;
+    ReplyParser parser(
+        [&](const ReplyParser::Reply& reply){
+            ++replies;
+            checksum += reply.code + reply.enhancedStatus.size + reply.text.size;
+            if (reply.numLines > 1) {
+                ReplyParser::Capabilities capabilities;
+                (void)ReplyParser::ParseCapabilities(reply, capabilities);
+                capabilityBits |= capabilities.supported;
+            }
+        }
+    );
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < environment.sessions; ++i) {
+        size_t offset = 0;
+        while (offset < data.size()) {
+            auto size = environment.chunk;
+            if (size > data.size() - offset) {
+                size = data.size() - offset;
+            }
+            if (!parser.Parse(data.data() + offset, size)) {
+                fprintf(stderr, "error: replies were not well formed\n");
+                return EXIT_FAILURE;
+            }
+            offset += size;
+        }
+    }
+    const auto seconds = std::chrono::duration< double >(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    const auto expected = (uint64_t)repliesPerSession * environment.sessions;
+    if (replies != expected) {
+        fprintf(
+            stderr,
+            "error: parsed %llu replies, expected %llu\n",
+            (unsigned long long)replies,
+            (unsigned long long)expected
+        );
+        return EXIT_FAILURE;
+    }
+    printf(
+        "%llu replies (%zu bytes per session) in %.3f s: %.0f replies/s, %.1f MB/s (checksum %llu, capabilities %llx)\n",
+        (unsigned long long)replies,
+        data.size(),
+        seconds,
+        (seconds > 0.0) ? (replies / seconds) : 0.0,
+        (seconds > 0.0) ? (data.size() * environment.sessions / seconds / 1e6) : 0.0,
+        (unsigned long long)checksum,
+        (unsigned long long)capabilityBits
+    );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,837 @@
+/**
+ * @file main.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the program which simulates Newman sending e-mail to modeled
+ * SMTP servers, for tuning how Newman schedules its work.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <deque>
+#include <fstream>
+#include <inttypes.h>
+#include <limits>
+#include <math.h>
+#include <queue>
+#include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "AdaptiveTimeouts.hpp"
+#include "DispatchWindow.hpp"
+#include "LatencyHistogram.hpp"
+#include "Random.hpp"
+
+namespace {
+
+    /**
+     * This function prints to the standard error stream information
+     * about how to use this program.
+     */
+    void PrintUsageInformation() {
+        fprintf(
+            stderr,
+            (
+                "Usage: NewmanSimulate [OPTIONS] MODEL\n"
+                "\n"
+                "Simulate Newman sending e-mail to modeled SMTP servers, using\n"
+                "a virtual clock, and report the same statistics Newman does.\n"
+                "The same model, options, and seed always give the same results.\n"
+                "\n"
+                "MODEL  Path to file describing the SMTP servers.  Each line\n"
+                        "is one of the following (times in milliseconds):\n"
+                "\n"
+                "  server NAME RATE MAX-CONNECTIONS TEMPFAIL\n"
+                "         CONNECT-MEDIAN CONNECT-SIGMA\n"
+                "         READY-MEDIAN READY-SIGMA\n"
+                "         SEND-MEDIAN SEND-SIGMA\n"
+                        "    E-mails arrive for the server at RATE per second\n"
+                        "    (Poisson), the server accepts at most\n"
+                        "    MAX-CONNECTIONS at once, fails a fraction TEMPFAIL\n"
+                        "    of sends, and each phase takes a log-normally\n"
+                        "    distributed time.\n"
+                "  outage NAME START DURATION\n"
+                        "    The server stops responding for DURATION, starting\n"
+                        "    at START.\n"
+                "  slowdown NAME START DURATION FACTOR\n"
+                        "    The server takes FACTOR times as long for every\n"
+                        "    phase for DURATION, starting at START.\n"
+                "\n"
+                "Lines beginning with '#' are ignored.\n"
+                "\n"
+                "Options:\n"
+                "\n"
+                "--seed=N                 (default: 1)\n"
+                "--duration=SECONDS       (default: 3600)\n"
+                "--timeout-percentile=P   (default: 99)\n"
+                "--timeout-multiplier=M   (default: 3)\n"
+                "--timeout-floor=MS       (default: 500)\n"
+                "--timeout-ceiling=MS     (default: 60000)\n"
+                "--timeout-initial=MS     (default: 5000)\n"
+                "--max-handshakes=N       (default: 0, or no limit)\n"
+                        "These have the same meaning as they do for Newman.\n"
+                "--window-max-delay=MS    (default: 0, or no window)\n"
+                        "Hold e-mails arriving for a server for up to MS\n"
+                        "before opening a session, so that e-mails arriving\n"
+                        "close together share one session, sent back to back.\n"
+                        "E-mails are only held if, at the rate they're arriving,\n"
+                        "another is expected in time, and never for longer\n"
+                        "than it takes to set up a session with the server.\n"
+                "--window-max-messages=N  (default: 20)\n"
+                        "Number of e-mails held for a server at which\n"
+                        "a session is opened right away.\n"
+            )
+        );
+    }
+
+    /**
+     * This is the number of phases of sending an e-mail.
+     */
+    constexpr size_t NUM_PHASES = static_cast< size_t >(Phase::Count);
+
+    /**
+     * This identifies a period of time during which a server
+     * behaves differently.
+     */
+    struct Disruption {
+        /**
+         * These are when the disruption starts and ends,
+         * in seconds since the simulation started.
+         */
+        double start = 0.0;
+        double end = 0.0;
+
+        /**
+         * This is the factor by which durations are multiplied,
+         * or infinity if the server doesn't respond at all.
+         */
+        double factor = 1.0;
+    };
+
+    /**
+     * This describes one modeled SMTP server, and holds the statistics
+     * of the simulation for it.
+     */
+    struct Server {
+        std::string name;
+        double rate = 1.0;
+        size_t maxConnections = 0;
+        double tempfail = 0.0;
+        double median[NUM_PHASES] = {};
+        double sigma[NUM_PHASES] = {};
+        std::vector< Disruption > disruptions;
+
+        // Simulation state
+        size_t connections = 0;
+
+        /**
+         * These are the arrival times of the e-mails waiting for
+         * a session, when e-mails are held in a window.
+         */
+        std::deque< double > waiting;
+
+        /**
+         * This is the number of sessions opened (or waiting to be)
+         * to send the waiting e-mails, when e-mails are held in
+         * a window.
+         */
+        size_t activeSessions = 0;
+
+        /**
+         * This indicates whether or not e-mails are being held
+         * until the window closes.
+         */
+        bool holding = false;
+
+        /**
+         * This identifies the latest window, so that windows
+         * which were closed early can be told apart.
+         */
+        uint64_t window = 0;
+
+        // Statistics
+        LatencyHistogram latencies[NUM_PHASES];
+        uint64_t arrived = 0;
+        uint64_t sent = 0;
+        uint64_t tempfailed = 0;
+        uint64_t refused = 0;
+        uint64_t sessions = 0;
+        LatencyHistogram waits;
+        uint64_t timeouts[NUM_PHASES] = {};
+        uint64_t falseTimeouts[NUM_PHASES] = {};
+        LatencyHistogram stuckDetection;
+    };
+
+    /**
+     * This contains variables set through the operating system environment
+     * or the command-line arguments.
+     */
+    struct Environment {
+        std::string modelFileName;
+        uint64_t seed = 1;
+        double duration = 3600.0;
+        AdaptiveTimeouts::Configuration timeouts;
+        size_t maxHandshakes = 0;
+        DispatchWindow::Configuration window;
+    };
+
+    /**
+     * This is something which happens at a particular time
+     * in the simulation.
+     */
+    struct Event {
+        enum class Kind {
+            /**
+             * A new e-mail is to be sent to the server.
+             */
+            Arrival,
+
+            /**
+             * A phase of sending an e-mail ends, either because
+             * it completed or because it timed out.
+             */
+            PhaseEnd,
+
+            /**
+             * The window in which e-mails for the server are held
+             * closes, and a session is opened to send them.
+             */
+            WindowEnd,
+        };
+
+        double time = 0.0;
+        uint64_t sequence = 0;
+        Kind kind = Kind::Arrival;
+        size_t server = 0;
+        size_t phase = 0;
+        bool completed = false;
+        bool failed = false;
+        double elapsed = 0.0;
+        uint64_t window = 0;
+
+        /**
+         * Events are ordered by time, and then by when they were
+         * scheduled, so that the simulation is deterministic.
+         */
+        bool operator>(const Event& other) const {
+            if (time != other.time) {
+                return (time > other.time);
+            }
+            return (sequence > other.sequence);
+        }
+    };
+
+    /**
+     * This runs the simulation.
+     */
+    class Simulation {
+        // Lifecycle management
+    public:
+        Simulation(
+            const Environment& environment,
+            std::vector< Server >& servers
+        )
+            : environment_(environment)
+            , servers_(servers)
+            , arrivals_(environment.seed)
+            , random_(Random(environment.seed).Next())
+        {
+            timeouts_.Configure(environment.timeouts);
+            window_.Configure(environment.window);
+        }
+
+        // Public methods
+    public:
+        void Run() {
+            for (size_t i = 0; i < servers_.size(); ++i) {
+                ScheduleArrival(i);
+            }
+            while (!events_.empty()) {
+                const auto event = events_.top();
+                events_.pop();
+                if (event.time > environment_.duration) {
+                    break;
+                }
+                now_ = event.time;
+                switch (event.kind) {
+                    case Event::Kind::Arrival: {
+                        ++servers_[event.server].arrived;
+                        ScheduleArrival(event.server);
+                        if (IsWindowed()) {
+                            Hold(event.server);
+                        } else {
+                            OpenSession(event.server);
+                        }
+                    } break;
+
+                    case Event::Kind::PhaseEnd: {
+                        EndPhase(event);
+                    } break;
+
+                    case Event::Kind::WindowEnd: {
+                        auto& server = servers_[event.server];
+                        if (
+                            server.holding
+                            && (event.window == server.window)
+                        ) {
+                            Dispatch(event.server);
+                        }
+                    } break;
+                }
+            }
+        }
+
+        const AdaptiveTimeouts& GetTimeouts() const {
+            return timeouts_;
+        }
+
+        // Private methods
+    private:
+        void Schedule(Event event) {
+            event.sequence = nextSequence_++;
+            events_.push(event);
+        }
+
+        void ScheduleArrival(size_t server) {
+            Event event;
+            event.kind = Event::Kind::Arrival;
+            event.time = now_ + arrivals_.Exponential(1.0 / servers_[server].rate);
+            event.server = server;
+            Schedule(event);
+        }
+
+        /**
+         * Return an indication of whether or not e-mails are held
+         * in a window and sent back to back over shared sessions,
+         * rather than each being sent over its own session.
+         */
+        bool IsWindowed() const {
+            return (environment_.window.maxDelay.count() > 0);
+        }
+
+        void OpenSession(size_t server) {
+            if (HandshakeSlotAvailable()) {
+                ++handshakes_;
+                StartPhase(server, 0);
+            } else {
+                waitingForHandshake_.push_back(server);
+            }
+        }
+
+        /**
+         * Return how long it typically takes to set up a session
+         * with the given server, or zero if that isn't known yet.
+         */
+        std::chrono::microseconds GetSetupTime(const Server& server) const {
+            const auto& connect = server.latencies[static_cast< size_t >(Phase::Connect)];
+            const auto& ready = server.latencies[static_cast< size_t >(Phase::Ready)];
+            if (
+                (connect.GetCount() == 0)
+                || (ready.GetCount() == 0)
+            ) {
+                return std::chrono::microseconds(0);
+            }
+            return std::chrono::microseconds(
+                (std::chrono::microseconds::rep)(
+                    connect.GetPercentile(50.0) + ready.GetPercentile(50.0)
+                )
+            );
+        }
+
+        /**
+         * Add an e-mail which just arrived to those waiting for
+         * a session to the given server, and decide whether to open
+         * a session now or hold the e-mails a while longer.
+         */
+        void Hold(size_t serverIndex) {
+            auto& server = servers_[serverIndex];
+            window_.RecordArrival(
+                server.name,
+                std::chrono::microseconds((std::chrono::microseconds::rep)(now_ * 1000000.0))
+            );
+            server.waiting.push_back(now_);
+            const auto full = window_.IsFull(server.waiting.size());
+            if (
+                (server.activeSessions > 0)
+                && !full
+            ) {
+                // A session already open (or opening) will send it.
+                return;
+            }
+            if (server.holding) {
+                if (full) {
+                    Dispatch(serverIndex);
+                }
+                return;
+            }
+            const auto delay = window_.GetDelay(server.name, GetSetupTime(server));
+            if (
+                full
+                || (delay.count() == 0)
+            ) {
+                Dispatch(serverIndex);
+                return;
+            }
+            server.holding = true;
+            Event event;
+            event.kind = Event::Kind::WindowEnd;
+            event.time = now_ + (double)delay.count() / 1000000.0;
+            event.server = serverIndex;
+            event.window = server.window;
+            Schedule(event);
+        }
+
+        /**
+         * Open a session to send the e-mails waiting for the given server.
+         */
+        void Dispatch(size_t serverIndex) {
+            auto& server = servers_[serverIndex];
+            server.holding = false;
+            ++server.window;
+            ++server.activeSessions;
+            OpenSession(serverIndex);
+        }
+
+        /**
+         * Send the next e-mail waiting for the given server over a session
+         * which is ready, or close the session if there are none.
+         */
+        void SendNext(size_t serverIndex) {
+            auto& server = servers_[serverIndex];
+            if (server.waiting.empty()) {
+                --server.connections;
+                EndSession(serverIndex);
+                return;
+            }
+            server.waits.Record((uint64_t)((now_ - server.waiting.front()) * 1000000.0));
+            server.waiting.pop_front();
+            StartPhase(serverIndex, static_cast< size_t >(Phase::Send));
+        }
+
+        /**
+         * Note that a session to send waiting e-mails ended, and open
+         * another if e-mails are left waiting with no session to send them.
+         */
+        void EndSession(size_t serverIndex) {
+            auto& server = servers_[serverIndex];
+            --server.activeSessions;
+            if (
+                !server.waiting.empty()
+                && (server.activeSessions == 0)
+                && !server.holding
+            ) {
+                Dispatch(serverIndex);
+            }
+        }
+
+        bool HandshakeSlotAvailable() const {
+            return (
+                (environment_.maxHandshakes == 0)
+                || (handshakes_ < environment_.maxHandshakes)
+            );
+        }
+
+        void ReleaseHandshakeSlot() {
+            --handshakes_;
+            if (!waitingForHandshake_.empty()) {
+                const auto server = waitingForHandshake_.front();
+                waitingForHandshake_.pop_front();
+                ++handshakes_;
+                StartPhase(server, 0);
+            }
+        }
+
+        /**
+         * Return how long the given phase would take with the given
+         * server if Newman waited forever, or infinity if the server
+         * isn't responding.
+         */
+        double SampleDuration(const Server& server, size_t phase) {
+            auto duration = random_.LogNormal(server.median[phase], server.sigma[phase]) / 1000.0;
+            for (const auto& disruption: server.disruptions) {
+                if (
+                    (now_ >= disruption.start)
+                    && (now_ < disruption.end)
+                ) {
+                    duration *= disruption.factor;
+                }
+            }
+            return duration;
+        }
+
+        void StartPhase(size_t serverIndex, size_t phase) {
+            auto& server = servers_[serverIndex];
+            Event event;
+            event.kind = Event::Kind::PhaseEnd;
+            event.server = serverIndex;
+            event.phase = phase;
+            if (phase == static_cast< size_t >(Phase::Connect)) {
+                if (
+                    (server.maxConnections > 0)
+                    && (server.connections >= server.maxConnections)
+                ) {
+                    // The server refuses the connection right away.
+                    event.failed = true;
+                    event.completed = true;
+                    event.time = now_ + server.median[phase] / 1000.0;
+                    ++server.refused;
+                    Schedule(event);
+                    return;
+                }
+                ++server.connections;
+                ++server.sessions;
+            }
+            const auto duration = SampleDuration(server, phase);
+            const auto timeout = (
+                (double)timeouts_.GetTimeout(server.name, static_cast< Phase >(phase)).count()
+                / 1000.0
+            );
+            if (duration <= timeout) {
+                event.completed = true;
+                event.elapsed = duration;
+                event.failed = (
+                    (phase == static_cast< size_t >(Phase::Send))
+                    && random_.Chance(server.tempfail)
+                );
+            } else {
+                event.completed = false;
+                event.elapsed = timeout;
+                if (std::isinf(duration)) {
+                    server.stuckDetection.Record((uint64_t)(timeout * 1000000.0));
+                } else {
+                    ++server.falseTimeouts[phase];
+                }
+            }
+            event.time = now_ + event.elapsed;
+            Schedule(event);
+        }
+
+        void EndPhase(const Event& event) {
+            auto& server = servers_[event.server];
+            const auto phase = event.phase;
+            const auto refused = (
+                (phase == static_cast< size_t >(Phase::Connect))
+                && event.failed
+            );
+            if (refused) {
+                ++server.sessions;
+                ReleaseHandshakeSlot();
+                if (IsWindowed()) {
+                    EndSession(event.server);
+                }
+                return;
+            }
+            timeouts_.Record(
+                server.name,
+                static_cast< Phase >(phase),
+                (uint64_t)(event.elapsed * 1000000.0)
+            );
+            if (event.completed) {
+                server.latencies[phase].Record((uint64_t)(event.elapsed * 1000000.0));
+            } else {
+                ++server.timeouts[phase];
+            }
+            const auto done = (
+                !event.completed
+                || event.failed
+                || (phase + 1 == NUM_PHASES)
+            );
+            if (phase <= static_cast< size_t >(Phase::Ready)) {
+                if (
+                    done
+                    || (phase == static_cast< size_t >(Phase::Ready))
+                ) {
+                    ReleaseHandshakeSlot();
+                }
+            }
+            if (IsWindowed()) {
+                // A session carries on to the next waiting e-mail after
+                // being set up or sending one, unless it timed out.
+                if (phase == static_cast< size_t >(Phase::Send)) {
+                    if (
+                        event.completed
+                        && !event.failed
+                    ) {
+                        ++server.sent;
+                    } else if (event.completed) {
+                        ++server.tempfailed;
+                    }
+                }
+                if (event.completed) {
+                    if (phase == static_cast< size_t >(Phase::Connect)) {
+                        StartPhase(event.server, phase + 1);
+                    } else {
+                        SendNext(event.server);
+                    }
+                } else {
+                    --server.connections;
+                    EndSession(event.server);
+                }
+                return;
+            }
+            if (done) {
+                --server.connections;
+                if (
+                    event.completed
+                    && !event.failed
+                ) {
+                    ++server.sent;
+                } else if (event.completed) {
+                    ++server.tempfailed;
+                }
+            } else {
+                StartPhase(event.server, phase + 1);
+            }
+        }
+
+        // Private properties
+    private:
+        const Environment& environment_;
+        std::vector< Server >& servers_;
+
+        /**
+         * This is used only to decide when e-mails arrive, so that
+         * the same seed gives the same arrivals whatever else the
+         * options change.
+         */
+        Random arrivals_;
+
+        /**
+         * This is used to decide everything else left to chance.
+         */
+        Random random_;
+
+        AdaptiveTimeouts timeouts_;
+        DispatchWindow window_;
+        std::priority_queue< Event, std::vector< Event >, std::greater< Event > > events_;
+        uint64_t nextSequence_ = 0;
+        double now_ = 0.0;
+        size_t handshakes_ = 0;
+        std::deque< size_t > waitingForHandshake_;
+    };
+
+    /**
+     * Load the descriptions of the modeled SMTP servers.
+     */
+    bool LoadModel(
+        const std::string& fileName,
+        std::vector< Server >& servers
+    ) {
+        std::ifstream file(fileName);
+        if (!file.is_open()) {
+            fprintf(stderr, "error: unable to open '%s'\n", fileName.c_str());
+            return false;
+        }
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            std::istringstream fields(line);
+            std::string kind;
+            if (
+                !(fields >> kind)
+                || (kind[0] == '#')
+            ) {
+                continue;
+            }
+            std::string name;
+            (void)(fields >> name);
+            bool valid = false;
+            if (kind == "server") {
+                Server server;
+                server.name = name;
+                valid = (bool)(fields >> server.rate >> server.maxConnections >> server.tempfail);
+                for (size_t phase = 0; phase < NUM_PHASES; ++phase) {
+                    valid = valid && (bool)(fields >> server.median[phase] >> server.sigma[phase]);
+                }
+                valid = valid && (server.rate > 0.0);
+                servers.push_back(server);
+            } else if (
+                (kind == "outage")
+                || (kind == "slowdown")
+            ) {
+                Disruption disruption;
+                double duration = 0.0;
+                valid = (bool)(fields >> disruption.start >> duration);
+                if (kind == "outage") {
+                    disruption.factor = std::numeric_limits< double >::infinity();
+                } else {
+                    valid = valid && (bool)(fields >> disruption.factor);
+                }
+                // Like every other time in the model, these are given
+                // in milliseconds, but the clock counts seconds.
+                disruption.start /= 1000.0;
+                disruption.end = disruption.start + duration / 1000.0;
+                bool found = false;
+                for (auto& server: servers) {
+                    if (server.name == name) {
+                        server.disruptions.push_back(disruption);
+                        found = true;
+                    }
+                }
+                valid = valid && found;
+            }
+            if (!valid) {
+                fprintf(
+                    stderr,
+                    "error: '%s' line %zu is not valid\n",
+                    fileName.c_str(),
+                    lineNumber
+                );
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[in,out] environment
+     *     This is the environment to update.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(
+        int argc,
+        char* argv[],
+        Environment& environment
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            if (arg.substr(0, 2) != "--") {
+                if (!environment.modelFileName.empty()) {
+                    fprintf(stderr, "error: extra arguments given\n");
+                    return false;
+                }
+                environment.modelFileName = arg;
+                continue;
+            }
+            const auto delimiter = arg.find('=');
+            if (delimiter == std::string::npos) {
+                fprintf(stderr, "error: no value given for option '%s'\n", arg.c_str());
+                return false;
+            }
+            const auto name = arg.substr(2, delimiter - 2);
+            const auto value = arg.substr(delimiter + 1);
+            const auto number = strtod(value.c_str(), NULL);
+            if (name == "seed") {
+                environment.seed = strtoull(value.c_str(), NULL, 10);
+            } else if (name == "duration") {
+                environment.duration = number;
+            } else if (name == "timeout-percentile") {
+                environment.timeouts.percentile = number;
+            } else if (name == "timeout-multiplier") {
+                environment.timeouts.multiplier = number;
+            } else if (name == "timeout-floor") {
+                environment.timeouts.floor = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+            } else if (name == "timeout-ceiling") {
+                environment.timeouts.ceiling = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+            } else if (name == "timeout-initial") {
+                environment.timeouts.initial = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+            } else if (name == "max-handshakes") {
+                environment.maxHandshakes = (size_t)number;
+            } else if (name == "window-max-delay") {
+                environment.window.maxDelay = std::chrono::milliseconds((std::chrono::milliseconds::rep)number);
+            } else if (name == "window-max-messages") {
+                environment.window.maxMessages = (size_t)number;
+            } else {
+                fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                return false;
+            }
+        }
+        if (environment.modelFileName.empty()) {
+            fprintf(stderr, "error: no MODEL given\n");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Print the statistics gathered by the simulation.
+     */
+    void Report(
+        const std::vector< Server >& servers,
+        const AdaptiveTimeouts& timeouts
+    ) {
+        static const char* phaseNames[] = {"connect", "ready", "send"};
+        for (const auto& server: servers) {
+            printf(
+                (
+                    "%s: arrived=%" PRIu64 " sent=%" PRIu64 " tempfailed=%" PRIu64
+                    " refused=%" PRIu64 " sessions=%" PRIu64 "\n"
+                ),
+                server.name.c_str(),
+                server.arrived,
+                server.sent,
+                server.tempfailed,
+                server.refused,
+                server.sessions
+            );
+            for (size_t phase = 0; phase < NUM_PHASES; ++phase) {
+                printf(
+                    (
+                        "  %-7s (us): %s timeouts=%" PRIu64 " false-timeouts=%" PRIu64
+                        " final-timeout=%" PRId64 "ms\n"
+                    ),
+                    phaseNames[phase],
+                    server.latencies[phase].Summarize().c_str(),
+                    server.timeouts[phase],
+                    server.falseTimeouts[phase],
+                    (int64_t)timeouts.GetTimeout(server.name, static_cast< Phase >(phase)).count()
+                );
+            }
+            if (server.waits.GetCount() > 0) {
+                printf(
+                    "  waited for a session (us): %s\n",
+                    server.waits.Summarize().c_str()
+                );
+            }
+            if (server.stuckDetection.GetCount() > 0) {
+                printf(
+                    "  stuck sessions detected after (us): %s\n",
+                    server.stuckDetection.Summarize().c_str()
+                );
+            }
+        }
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ * It loads the model, runs the simulation, and reports the results.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Environment environment;
+    if (!ProcessCommandLineArguments(argc, argv, environment)) {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+    std::vector< Server > servers;
+    if (!LoadModel(environment.modelFileName, servers)) {
+        return EXIT_FAILURE;
+    }
+    Simulation simulation(environment, servers);
+    simulation.Run();
+    Report(servers, simulation.GetTimeouts());
+    return EXIT_SUCCESS;
+}
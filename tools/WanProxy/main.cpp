@@ -0,0 +1,713 @@
+/**
+ * @file main.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the program which relays connections to an SMTP server while
+ * emulating the delays, limited bandwidth, stalls, and resets of
+ * a wide-area network, for benchmarking Newman on one machine.
+ *
+ * © 2019 by Richard Walters
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <inttypes.h>
+#include <memory>
+#include <mutex>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <SystemAbstractions/DiagnosticsStreamReporter.hpp>
+#include <SystemAbstractions/NetworkConnection.hpp>
+#include <SystemAbstractions/NetworkEndpoint.hpp>
+#include <thread>
+#include <vector>
+
+#include "Random.hpp"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * This is the largest number of bytes relayed as one packet.
+     * Data received is divided into packets of at most this size,
+     * so that stalls and resets happen at packet boundaries, as they
+     * would on a real network.
+     */
+    constexpr size_t PACKET_SIZE = 1460;
+
+    /**
+     * This function prints to the standard error stream information
+     * about how to use this program.
+     */
+    void PrintUsageInformation() {
+        fprintf(
+            stderr,
+            (
+                "Usage: NewmanWanProxy [OPTIONS] HOST:PORT\n"
+                "\n"
+                "Accept connections and relay them to the server at HOST:PORT,\n"
+                "emulating the conditions of a wide-area network in each\n"
+                "direction.  The same seed and options give the same delays,\n"
+                "stalls, and resets for the same traffic.\n"
+                "\n"
+                "Options:\n"
+                "\n"
+                "--port=N                 (default: 2526)\n"
+                        "Port on which to accept connections.\n"
+                "--seed=N                 (default: 1)\n"
+                "--latency=MS             (default: 0)\n"
+                        "One-way delay added to every packet.\n"
+                "--jitter=MS              (default: 0)\n"
+                        "Average extra delay (exponentially distributed) added\n"
+                        "to each packet.  Packets are never reordered.\n"
+                "--bandwidth=KBPS         (default: 0, or no limit)\n"
+                        "Rate, in kilobits per second, at which packets\n"
+                        "are sent.\n"
+                "--stall-probability=P    (default: 0)\n"
+                "--stall=MS               (default: 0)\n"
+                        "Chance that the link stops sending for MS before\n"
+                        "each packet.\n"
+                "--reset-probability=P    (default: 0)\n"
+                        "Chance that the connection is reset instead of\n"
+                        "sending each packet.\n"
+                "\n"
+                "Each of the link options may be prefixed with 'up-' to apply\n"
+                "only from client to server, or 'down-' to apply only from\n"
+                "server to client (for example, --down-bandwidth=512).\n"
+                "\n"
+                "Send SIGINT to stop.\n"
+            )
+        );
+    }
+
+    /**
+     * This flag indicates whether or not the application should shut down.
+     */
+    std::atomic< bool > shutDown(false);
+
+    /**
+     * This function is set up to be called when the SIGINT signal is
+     * received by the program.  It just sets the "shutDown" flag
+     * and relies on the program to be polling the flag to detect
+     * when it's been set.
+     *
+     * @param[in] sig
+     *     This is the signal for which this function was called.
+     */
+    void InterruptHandler(int) {
+        shutDown = true;
+    }
+
+    /**
+     * This holds the conditions emulated in one direction.
+     */
+    struct LinkSettings {
+        /**
+         * This is the delay, in milliseconds, added to every packet.
+         */
+        double latency = 0.0;
+
+        /**
+         * This is the average extra delay, in milliseconds,
+         * added to each packet.
+         */
+        double jitter = 0.0;
+
+        /**
+         * This is the rate, in kilobits per second, at which packets
+         * are sent, or zero for no limit.
+         */
+        double bandwidth = 0.0;
+
+        /**
+         * This is the chance that the link stops sending
+         * before each packet.
+         */
+        double stallProbability = 0.0;
+
+        /**
+         * This is how long, in milliseconds, the link stops sending
+         * when it stalls.
+         */
+        double stall = 0.0;
+
+        /**
+         * This is the chance that the connection is reset
+         * instead of sending each packet.
+         */
+        double resetProbability = 0.0;
+    };
+
+    /**
+     * This contains variables set through the operating system environment
+     * or the command-line arguments.
+     */
+    struct Environment {
+        /**
+         * This is the host name or address of the server
+         * to which to relay connections.
+         */
+        std::string targetHost;
+
+        /**
+         * This is the port number of the server to which
+         * to relay connections.
+         */
+        uint16_t targetPort = 0;
+
+        /**
+         * This is the port on which to accept connections.
+         */
+        uint16_t port = 2526;
+
+        /**
+         * This is used to seed the generators of delays,
+         * stalls, and resets.
+         */
+        uint64_t seed = 1;
+
+        /**
+         * These are the conditions emulated from client to server.
+         */
+        LinkSettings up;
+
+        /**
+         * These are the conditions emulated from server to client.
+         */
+        LinkSettings down;
+    };
+
+    /**
+     * Set the given link setting.
+     *
+     * @param[in] name
+     *     This is the name of the setting, without any direction prefix.
+     *
+     * @param[in] value
+     *     This is the value to give the setting.
+     *
+     * @param[in,out] settings
+     *     These are the settings to update.
+     *
+     * @return
+     *     An indication of whether or not the setting was recognized
+     *     is returned.
+     */
+    bool SetLinkSetting(
+        const std::string& name,
+        double value,
+        LinkSettings& settings
+    ) {
+        if (name == "latency") {
+            settings.latency = value;
+        } else if (name == "jitter") {
+            settings.jitter = value;
+        } else if (name == "bandwidth") {
+            settings.bandwidth = value;
+        } else if (name == "stall-probability") {
+            settings.stallProbability = value;
+        } else if (name == "stall") {
+            settings.stall = value;
+        } else if (name == "reset-probability") {
+            settings.resetProbability = value;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[in,out] environment
+     *     This is the environment to update.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(
+        int argc,
+        char* argv[],
+        Environment& environment
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            if (arg.substr(0, 2) != "--") {
+                if (!environment.targetHost.empty()) {
+                    fprintf(stderr, "error: extra arguments given\n");
+                    return false;
+                }
+                const auto delimiter = arg.rfind(':');
+                if (
+                    (delimiter == std::string::npos)
+                    || (delimiter == 0)
+                ) {
+                    fprintf(stderr, "error: invalid server '%s'\n", arg.c_str());
+                    return false;
+                }
+                environment.targetHost = arg.substr(0, delimiter);
+                environment.targetPort = (uint16_t)strtoul(arg.c_str() + delimiter + 1, NULL, 10);
+                continue;
+            }
+            const auto delimiter = arg.find('=');
+            if (delimiter == std::string::npos) {
+                fprintf(stderr, "error: no value given for option '%s'\n", arg.c_str());
+                return false;
+            }
+            const auto name = arg.substr(2, delimiter - 2);
+            const auto value = arg.substr(delimiter + 1);
+            const auto number = strtod(value.c_str(), NULL);
+            if (name == "port") {
+                environment.port = (uint16_t)number;
+            } else if (name == "seed") {
+                environment.seed = strtoull(value.c_str(), NULL, 10);
+            } else if (name.substr(0, 3) == "up-") {
+                if (!SetLinkSetting(name.substr(3), number, environment.up)) {
+                    fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                    return false;
+                }
+            } else if (name.substr(0, 5) == "down-") {
+                if (!SetLinkSetting(name.substr(5), number, environment.down)) {
+                    fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                    return false;
+                }
+            } else if (
+                !SetLinkSetting(name, number, environment.up)
+                || !SetLinkSetting(name, number, environment.down)
+            ) {
+                fprintf(stderr, "error: unknown option '%s'\n", name.c_str());
+                return false;
+            }
+        }
+        if (environment.targetHost.empty()) {
+            fprintf(stderr, "error: no HOST:PORT given\n");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Convert the given number of milliseconds to a clock duration.
+     */
+    Clock::duration Milliseconds(double milliseconds) {
+        return std::chrono::duration_cast< Clock::duration >(
+            std::chrono::duration< double, std::milli >(milliseconds)
+        );
+    }
+
+    /**
+     * This carries data in one direction of a relayed connection,
+     * emulating the conditions of a wide-area network.
+     */
+    struct Link {
+        /**
+         * This is one packet waiting to be sent.
+         */
+        struct Packet {
+            /**
+             * This is when the packet should be sent.
+             */
+            Clock::time_point due;
+
+            /**
+             * These are the bytes of the packet.
+             */
+            std::vector< uint8_t > data;
+        };
+
+        /**
+         * These are the conditions emulated by the link.
+         */
+        LinkSettings settings;
+
+        /**
+         * This is used to generate delays, stalls, and resets.
+         */
+        Random random;
+
+        /**
+         * These are the packets waiting to be sent, in order.
+         */
+        std::deque< Packet > packets;
+
+        /**
+         * This is when the link finishes sending the last packet
+         * given to it, considering its bandwidth.
+         */
+        Clock::time_point busyUntil;
+
+        /**
+         * This is when the last packet given to the link is due,
+         * used to keep packets from being reordered.
+         */
+        Clock::time_point lastDue;
+
+        /**
+         * This indicates whether or not the sending side has
+         * closed its end, so that the link should close the
+         * receiving side once all packets are sent.
+         */
+        bool finishing = false;
+
+        /**
+         * This indicates whether or not the link should stop.
+         */
+        bool stopping = false;
+
+        /**
+         * This is where the link sends packets.
+         */
+        std::shared_ptr< SystemAbstractions::INetworkConnection > sink;
+
+        /**
+         * This is called if the link decides to reset the connection.
+         */
+        std::function< void() > resetDelegate;
+
+        /**
+         * This is the thread which sends packets when they're due.
+         */
+        std::thread sender;
+
+        /**
+         * This is used to synchronize access to the link.
+         */
+        std::mutex mutex;
+
+        /**
+         * This is used to wake the sender when a packet is
+         * added or the link should stop.
+         */
+        std::condition_variable wakeCondition;
+
+        Link(const LinkSettings& newSettings, uint64_t seed)
+            : settings(newSettings)
+            , random(seed)
+        {
+        }
+
+        /**
+         * Divide the given data into packets and schedule them
+         * to be sent.
+         */
+        void Push(const std::vector< uint8_t >& data) {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            for (size_t offset = 0; offset < data.size(); offset += PACKET_SIZE) {
+                const auto size = std::min(PACKET_SIZE, data.size() - offset);
+                Packet packet;
+                packet.data.assign(
+                    data.begin() + offset,
+                    data.begin() + offset + size
+                );
+                const auto now = Clock::now();
+                auto start = std::max(now, busyUntil);
+                if (random.Chance(settings.stallProbability)) {
+                    start += Milliseconds(settings.stall);
+                }
+                busyUntil = start;
+                if (settings.bandwidth > 0.0) {
+                    busyUntil += Milliseconds(
+                        (double)(size * 8) / settings.bandwidth
+                    );
+                }
+                auto delay = settings.latency;
+                if (settings.jitter > 0.0) {
+                    delay += random.Exponential(settings.jitter);
+                }
+                packet.due = std::max(lastDue, busyUntil + Milliseconds(delay));
+                lastDue = packet.due;
+                if (random.Chance(settings.resetProbability)) {
+                    // An empty packet marks where the connection is reset.
+                    packet.data.clear();
+                }
+                packets.push_back(std::move(packet));
+            }
+            wakeCondition.notify_all();
+        }
+
+        /**
+         * Close the receiving side once all packets are sent.
+         */
+        void Finish() {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            finishing = true;
+            wakeCondition.notify_all();
+        }
+
+        /**
+         * Stop the link, dropping any packets not yet sent.
+         */
+        void Stop() {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            stopping = true;
+            wakeCondition.notify_all();
+        }
+
+        /**
+         * Send packets when they're due, until the link is stopped
+         * or finished.
+         */
+        void Run() {
+            std::unique_lock< decltype(mutex) > lock(mutex);
+            for (;;) {
+                if (stopping) {
+                    return;
+                }
+                if (packets.empty()) {
+                    if (finishing) {
+                        lock.unlock();
+                        sink->Close(true);
+                        return;
+                    }
+                    wakeCondition.wait(lock);
+                    continue;
+                }
+                const auto due = packets.front().due;
+                if (Clock::now() < due) {
+                    (void)wakeCondition.wait_until(lock, due);
+                    continue;
+                }
+                auto packet = std::move(packets.front());
+                packets.pop_front();
+                lock.unlock();
+                if (packet.data.empty()) {
+                    resetDelegate();
+                    return;
+                }
+                sink->SendMessage(packet.data);
+                lock.lock();
+            }
+        }
+    };
+
+    /**
+     * This is one connection being relayed between a client
+     * and the server.
+     */
+    struct Relay {
+        /**
+         * This identifies the relay in reports.
+         */
+        size_t id = 0;
+
+        /**
+         * This carries data from the client to the server.
+         */
+        std::unique_ptr< Link > up;
+
+        /**
+         * This carries data from the server to the client.
+         */
+        std::unique_ptr< Link > down;
+
+        /**
+         * This is the connection to the client.
+         */
+        std::shared_ptr< SystemAbstractions::INetworkConnection > client;
+
+        /**
+         * This is the connection to the server.
+         */
+        std::shared_ptr< SystemAbstractions::INetworkConnection > server;
+
+        /**
+         * This indicates whether or not the connection was reset.
+         */
+        std::atomic< bool > reset{false};
+
+        ~Relay() noexcept {
+            // Release the connections before the links, since the
+            // connections' delegates refer to the links.
+            if (up != nullptr) {
+                up->sink = nullptr;
+            }
+            if (down != nullptr) {
+                down->sink = nullptr;
+            }
+            client = nullptr;
+            server = nullptr;
+        }
+
+        /**
+         * Stop both links, dropping any data not yet relayed.
+         */
+        void Stop() {
+            up->Stop();
+            down->Stop();
+        }
+
+        /**
+         * Abruptly close both connections, dropping any data
+         * not yet relayed.
+         */
+        void Reset() {
+            if (reset.exchange(true)) {
+                return;
+            }
+            printf("connection %zu: reset\n", id);
+            Stop();
+            client->Close(false);
+            server->Close(false);
+        }
+
+        /**
+         * Wait for both links to stop.
+         */
+        void Join() {
+            for (auto link: {up.get(), down.get()}) {
+                if (link->sender.joinable()) {
+                    if (link->sender.get_id() == std::this_thread::get_id()) {
+                        link->sender.detach();
+                    } else {
+                        link->sender.join();
+                    }
+                }
+            }
+        }
+    };
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ * It accepts connections and relays each one to the server, emulating
+ * a wide-area network, until the SIGINT signal is caught.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Environment environment;
+    if (!ProcessCommandLineArguments(argc, argv, environment)) {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+    const auto targetAddress = SystemAbstractions::NetworkConnection::GetAddressOfHost(
+        environment.targetHost
+    );
+    if (targetAddress == 0) {
+        fprintf(stderr, "error: unable to resolve '%s'\n", environment.targetHost.c_str());
+        return EXIT_FAILURE;
+    }
+    const auto previousInterruptHandler = signal(SIGINT, InterruptHandler);
+    (void)setbuf(stdout, NULL);
+    const auto diagnosticsPublisher = SystemAbstractions::DiagnosticsStreamReporter(stdout, stderr);
+    std::mutex relaysMutex;
+    std::vector< std::shared_ptr< Relay > > relays;
+    size_t nextRelayId = 1;
+    SystemAbstractions::NetworkEndpoint endpoint;
+    (void)endpoint.SubscribeToDiagnostics(diagnosticsPublisher);
+    const auto newConnectionDelegate = [&](
+        std::shared_ptr< SystemAbstractions::NetworkConnection > newConnection
+    ){
+        const auto relay = std::make_shared< Relay >();
+        {
+            std::lock_guard< decltype(relaysMutex) > lock(relaysMutex);
+            relay->id = nextRelayId++;
+        }
+        relay->client = newConnection;
+        const auto server = std::make_shared< SystemAbstractions::NetworkConnection >();
+        relay->server = server;
+        if (!server->Connect(targetAddress, environment.targetPort)) {
+            printf("connection %zu: unable to connect to server\n", relay->id);
+            newConnection->Close(false);
+            return;
+        }
+        relay->up.reset(new Link(environment.up, environment.seed + 2 * relay->id));
+        relay->down.reset(new Link(environment.down, environment.seed + 2 * relay->id + 1));
+        relay->up->sink = server;
+        relay->down->sink = newConnection;
+        const auto relayRaw = relay.get();
+        relay->up->resetDelegate = [relayRaw]{ relayRaw->Reset(); };
+        relay->down->resetDelegate = [relayRaw]{ relayRaw->Reset(); };
+        const auto up = relay->up.get();
+        const auto down = relay->down.get();
+        up->sender = std::thread([up]{ up->Run(); });
+        down->sender = std::thread([down]{ down->Run(); });
+        if (
+            !newConnection->Process(
+                [up](const std::vector< uint8_t >& message){ up->Push(message); },
+                [up](bool){ up->Finish(); }
+            )
+            || !server->Process(
+                [down](const std::vector< uint8_t >& message){ down->Push(message); },
+                [down](bool){ down->Finish(); }
+            )
+        ) {
+            relay->Reset();
+        }
+        printf("connection %zu: relaying\n", relay->id);
+        std::lock_guard< decltype(relaysMutex) > lock(relaysMutex);
+        relays.push_back(relay);
+    };
+    if (
+        !endpoint.Open(
+            newConnectionDelegate,
+            nullptr,
+            SystemAbstractions::NetworkEndpoint::Mode::Connection,
+            0,
+            0,
+            environment.port
+        )
+    ) {
+        fprintf(stderr, "error: unable to listen on port %" PRIu16 "\n", environment.port);
+        (void)signal(SIGINT, previousInterruptHandler);
+        return EXIT_FAILURE;
+    }
+    printf(
+        "Relaying port %" PRIu16 " to %s:%" PRIu16 "...\n",
+        environment.port,
+        environment.targetHost.c_str(),
+        environment.targetPort
+    );
+    while (!shutDown) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard< decltype(relaysMutex) > lock(relaysMutex);
+        for (auto it = relays.begin(); it != relays.end();) {
+            const auto& relay = *it;
+            if (
+                relay->reset
+                || (
+                    !relay->client->IsConnected()
+                    && !relay->server->IsConnected()
+                )
+            ) {
+                relay->Stop();
+                relay->Join();
+                printf("connection %zu: closed\n", relay->id);
+                it = relays.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    endpoint.Close();
+    {
+        std::lock_guard< decltype(relaysMutex) > lock(relaysMutex);
+        for (const auto& relay: relays) {
+            relay->Reset();
+            relay->Join();
+        }
+        relays.clear();
+    }
+    (void)signal(SIGINT, previousInterruptHandler);
+    return EXIT_SUCCESS;
+}